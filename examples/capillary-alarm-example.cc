@@ -0,0 +1,143 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include <ns3/core-module.h>
+#include <ns3/mobility-module.h>
+#include <ns3/spectrum-module.h>
+#include <ns3/energy-module.h>
+#include <ns3/network-module.h>
+#include <ns3/capillary-network-module.h>
+#include <ns3/capillary-aloha-module.h>
+#include <ns3/applications-module.h>
+
+#include <iostream>
+
+using namespace ns3;
+
+/*
+ * Alarm traffic in a loaded cell.
+ *
+ * The end devices of a cell send their routine readings; from time to
+ * time one of them raises an alarm, a DATA tagged with the ALARM
+ * priority. The alarms go ahead of the routine packets of the device
+ * and, with --alarm-slots, contend only in the first slots of the frame.
+ *
+ * ./waf --run "capillary-alarm-example --devices=40 --alarm-slots=2"
+ *
+ * The mean and maximum access delay of each class are printed at the end.
+ */
+
+static const uint16_t ALARM_PROTOCOL = 0x88b6;
+
+static void
+AccessDelay (CapillaryRunningStats *stats, Time delay, uint8_t priority)
+{
+  stats[priority].Add (delay.GetSeconds ());
+}
+
+static void
+RaiseAlarm (Ptr<NetDevice> device, Address coordinator, uint32_t size)
+{
+  Ptr<Packet> alarm = Create<Packet> (size);
+  alarm->AddPacketTag (CapillaryPriorityTag (CapillaryPriorityTag::ALARM));
+
+  device->Send (alarm, coordinator, ALARM_PROTOCOL);
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t nDevices = 40;
+  uint32_t nAlarms = 20;
+  uint32_t alarmSize = 20;
+  uint16_t alarmSlots = 2;
+  double radius = 10;
+  double stopAt = 600;
+
+  CommandLine cmd;
+  cmd.AddValue ("devices", "The number of end devices", nDevices);
+  cmd.AddValue ("alarms", "The number of alarms raised", nAlarms);
+  cmd.AddValue ("alarm-size", "The payload of an alarm (bytes)", alarmSize);
+  cmd.AddValue ("alarm-slots", "The slots left to the alarms, 0 for none", alarmSlots);
+  cmd.AddValue ("radius", "The radius of the cell (m)", radius);
+  cmd.AddValue ("stop", "The simulated time (s)", stopAt);
+  cmd.Parse (argc, argv);
+
+  SpectrumChannelHelper channelHelper = SpectrumChannelHelper::Default ();
+
+  const double k = 1.381e-23;               //Boltzmann's constant
+  const double T = 290;               // temperature in Kelvin
+
+  WifiSpectrumValue5MhzFactory sf;
+  CapillaryNetDeviceHelper deviceHelper = CapillaryNetDeviceHelper ();
+  deviceHelper.SetChannel (channelHelper.Create ());
+  deviceHelper.SetTxPowerSpectralDensity (sf.CreateTxPowerSpectralDensity (0.1, 1));
+  deviceHelper.SetNoisePowerSpectralDensity (sf.CreateConstant (k * T));
+  deviceHelper.SetControllerTypeId ("ns3::BasicController");
+  deviceHelper.SetMacAttribute ("AlarmSlots", UintegerValue (alarmSlots));
+
+  CapillaryCellHelper cells;
+  cells.SetDeviceHelper (deviceHelper);
+  cells.SetEndDevices (nDevices);
+  cells.SetCellRadius (radius);
+  NetDeviceContainer capillaryDevices = cells.Install (1);
+
+  NodeContainer nodes = cells.GetAllNodes ();
+
+  BasicEnergySourceHelper basicSourceHelper;
+  EnergySourceContainer sources = basicSourceHelper.Install (nodes);
+
+  CapillaryEnergyModelHelper capillaryEnergyModelHelper = CapillaryEnergyModelHelper ();
+  capillaryEnergyModelHelper.Install (capillaryDevices, sources);
+
+  /* routine readings from every end device, alarms from random ones */
+  CapillaryRunningStats delay[2];
+  NodeContainer cellNodes = cells.GetNodes (0);
+  SensorApplicationHelper sensor = SensorApplicationHelper ();
+  for (uint32_t i = 1; i < cellNodes.GetN (); i++)
+    {
+      ApplicationContainer sensors = sensor.Install (cellNodes.Get (i));
+      sensors.Start (Seconds (0));
+      sensors.Stop (Seconds (stopAt));
+
+      Ptr<CapillaryNetDevice> device = DynamicCast<CapillaryNetDevice> (cellNodes.Get (i)->GetDevice (0));
+      device->GetMac ()->TraceConnectWithoutContext ("AccessDelay", MakeBoundCallback (&AccessDelay, delay));
+    }
+
+  Ptr<UniformRandomVariable> random = CreateObject<UniformRandomVariable> ();
+  for (uint32_t a = 0; a < nAlarms; a++)
+    {
+      Ptr<Node> node = cellNodes.Get (random->GetInteger (1, cellNodes.GetN () - 1));
+      Simulator::Schedule (Seconds (random->GetValue (0, stopAt * 0.9)), &RaiseAlarm, node->GetDevice (0), cells.GetCoordinator (0)->GetAddress (), alarmSize);
+    }
+
+  Simulator::Stop (Seconds (stopAt));
+  Simulator::Run ();
+
+  const char *names[2] = { "routine", "alarm" };
+  for (uint32_t c = 0; c < 2; c++)
+    {
+      std::cout << names[c] << ": " << delay[c].GetCount () << " packets, access delay mean "
+                << delay[c].GetMean () << "s, max " << delay[c].GetMax () << "s" << std::endl;
+    }
+
+  Simulator::Destroy ();
+
+  return 0;
+}
@@ -84,6 +84,15 @@ int main (int argc, char *argv[])
 
   bool debug = false;
   bool defaultConfig = false;
+  bool binary = false;
+  bool async = false;
+  bool stats = false;
+  double energyInterval = 0;
+  bool compress = false;
+  bool tracepoints = false;
+  double metricsInterval = 0;
+  double telemetryInterval = 0;
+  uint32_t channels = 1;
 
   CapillaryLogHelper logger = CapillaryLogHelper ();
 
@@ -92,8 +101,23 @@ int main (int argc, char *argv[])
   cmd.AddValue ("config", "The configuration file name to use", configFile);
   cmd.AddValue ("save_path", "The output path to save log", savePath);
   cmd.AddValue ("default", "To save the config file", defaultConfig);
+  cmd.AddValue ("binary", "Write the Energy and DCR traces in binary format", binary);
+  cmd.AddValue ("async", "Write the binary traces from a background thread", async);
+  cmd.AddValue ("stats", "Write a statistics summary instead of the DCR traces", stats);
+  cmd.AddValue ("channels", "The number of FSA channels of a frame (up to 3)", channels);
+  cmd.AddValue ("telemetry_interval", "Report the simulation speed every telemetry_interval simulated seconds", telemetryInterval);
+  cmd.AddValue ("metrics_interval", "Write a JSON-lines metrics snapshot every metrics_interval seconds", metricsInterval);
+  cmd.AddValue ("tracepoints", "Write the MAC/PHY tracepoints to a binary trace", tracepoints);
+  cmd.AddValue ("compress", "Write gzip compressed ascii traces", compress);
+  cmd.AddValue ("energy_interval", "Downsample the energy traces to one line per node every energy_interval seconds", energyInterval);
   cmd.Parse (argc, argv);
 
+  if (telemetryInterval > 0)
+    {
+      // must be selected before the simulator is used
+      CapillarySimulationTelemetry::EnableProfiling ();
+    }
+
   if (debug)
     {
       logger.EnableLogComponents (LOG_LEVEL_DEBUG);
@@ -165,6 +189,20 @@ int main (int argc, char *argv[])
   uint32_t coordinatorIndex = (myConfig->nDevices / 2) + 1;
   Ptr<CapillaryNetDevice> coordinator = deviceHelper.SetCoordinator (capillaryDevices.Get (coordinatorIndex));
 
+  if (channels > 1)
+    {
+      // 20 MHz wide channels, 5 channel numbers apart do not overlap
+      NS_ASSERT_MSG (myConfig->channelNumber + 5 * (channels - 1) <= 13, "Too many channels");
+
+      CapillaryMultiChannelHelper channelsHelper;
+      channelsHelper.SetNoisePowerSpectralDensity (noisePsd);
+      for (uint32_t c = 1; c < channels; c++)
+        {
+          channelsHelper.AddChannel (sf.CreateTxPowerSpectralDensity (myConfig->txPower, myConfig->channelNumber + 5 * c));
+        }
+      channelsHelper.Install (capillaryDevices);
+    }
+
   /* energy source */
   BasicEnergySourceHelper basicSourceHelper;
   EnergySourceContainer sources = basicSourceHelper.Install (devices);
@@ -191,9 +229,56 @@ int main (int argc, char *argv[])
   outputSuffix << "-" << myConfig->nDevices << "_Devs-" << mac->GetNSlots () << "_Slots-" << myConfig->stopAt.GetSeconds () << "_sec";
 
   AsciiTraceHelper ascii;
-  logger.EnableAsciiAll (ascii.CreateFileStream (savePath + "Packets" + outputSuffix.str ()));
-  logger.EnableEnergyAscii (ascii.CreateFileStream (savePath + "Energy" + outputSuffix.str ()), energyModels);
-  logger.EnableDCRAscii (ascii.CreateFileStream (savePath + "DCR" + outputSuffix.str ()), capillaryDevices);
+
+  if (telemetryInterval > 0)
+    {
+      Ptr<CapillarySimulationTelemetry> telemetry = CreateObject<CapillarySimulationTelemetry> ();
+      telemetry->SetAttribute ("Interval", TimeValue (Seconds (telemetryInterval)));
+      telemetry->Start (ascii.CreateFileStream (savePath + "Telemetry" + outputSuffix.str ()));
+    }
+
+  if (metricsInterval > 0)
+    {
+      Ptr<CapillaryMetricsExporter> exporter = CreateObject<CapillaryMetricsExporter> ();
+      exporter->SetAttribute ("Interval", TimeValue (Seconds (metricsInterval)));
+      exporter->AddCell (0, capillaryDevices);
+      exporter->Start (savePath + "Metrics" + outputSuffix.str () + ".jsonl");
+    }
+
+  if (tracepoints)
+    {
+      logger.EnableTracepoints (Create<CapillaryBinaryTraceWriter> (savePath + "Tracepoints" + outputSuffix.str () + ".bin"));
+    }
+
+  if (energyInterval > 0)
+    {
+      logger.EnableEnergyDownsampling (Seconds (energyInterval));
+    }
+
+  std::string packetsFile = savePath + "Packets" + outputSuffix.str ();
+  logger.EnableAsciiAll (compress ? logger.CreateCompressedFileStream (packetsFile) : ascii.CreateFileStream (packetsFile));
+  if (stats)
+    {
+      Ptr<CapillaryStatsCollector> collector = CreateObject<CapillaryStatsCollector> ();
+      collector->Install (capillaryDevices);
+      collector->EnableSummary (ascii.CreateFileStream (savePath + "Stats" + outputSuffix.str ()));
+    }
+  else if (binary)
+    {
+      if (async)
+        {
+          logger.EnableAsyncWriter ();
+        }
+      logger.EnableEnergyBinary (Create<CapillaryBinaryTraceWriter> (savePath + "Energy" + outputSuffix.str () + ".bin"), energyModels);
+      logger.EnableDCRBinary (Create<CapillaryBinaryTraceWriter> (savePath + "DCR" + outputSuffix.str () + ".bin"), capillaryDevices);
+    }
+  else
+    {
+      std::string energyFile = savePath + "Energy" + outputSuffix.str ();
+      std::string dcrFile = savePath + "DCR" + outputSuffix.str ();
+      logger.EnableEnergyAscii (compress ? logger.CreateCompressedFileStream (energyFile) : ascii.CreateFileStream (energyFile), energyModels);
+      logger.EnableDCRAscii (compress ? logger.CreateCompressedFileStream (dcrFile) : ascii.CreateFileStream (dcrFile), capillaryDevices);
+    }
 
   Simulator::Stop (myConfig->stopAt);
 
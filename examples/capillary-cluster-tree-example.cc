@@ -0,0 +1,195 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include <ns3/core-module.h>
+#include <ns3/mobility-module.h>
+#include <ns3/spectrum-module.h>
+#include <ns3/energy-module.h>
+#include <ns3/network-module.h>
+#include <ns3/capillary-network-module.h>
+#include <ns3/capillary-aloha-module.h>
+#include <ns3/applications-module.h>
+
+#include <iostream>
+
+using namespace ns3;
+
+/*
+ * Two-tier cluster-tree: the coordinators of the lower cells relay the
+ * data of their cells to a sink, as end devices of an upper-tier cell
+ * on another, non overlapping, channel.
+ *
+ * ./waf --run "capillary-cluster-tree-example --relays=4 --devices=10"
+ *
+ * At the end, the number of packets reaching the sink and their delay
+ * from the first coordinator are printed.
+ */
+
+static void
+SinkRx (CapillaryRunningStats *delay, Ptr<const Packet> packet, Mac64Address source, Time elapsed)
+{
+  delay->Add (elapsed.GetSeconds ());
+}
+
+static void
+RelayDrop (uint32_t *drops, Ptr<const Packet> packet)
+{
+  (*drops)++;
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t nRelays = 4;
+  uint32_t nDevices = 10;
+  double spacing = 20;
+  double radius = 10;
+  double stopAt = 600;
+
+  CommandLine cmd;
+  cmd.AddValue ("relays", "The number of lower cells, each one with its relay", nRelays);
+  cmd.AddValue ("devices", "The number of end devices of each lower cell", nDevices);
+  cmd.AddValue ("spacing", "The distance between two neighbour relays (m)", spacing);
+  cmd.AddValue ("radius", "The radius of a lower cell (m)", radius);
+  cmd.AddValue ("stop", "The simulated time (s)", stopAt);
+  cmd.Parse (argc, argv);
+
+  SpectrumChannelHelper channelHelper = SpectrumChannelHelper::Default ();
+  Ptr<SpectrumChannel> channel = channelHelper.Create ();
+
+  const double k = 1.381e-23;               //Boltzmann's constant
+  const double T = 290;               // temperature in Kelvin
+
+  WifiSpectrumValue5MhzFactory sf;
+  Ptr<SpectrumValue> noisePsd = sf.CreateConstant (k * T);
+
+  /* lower tier, channel 1 */
+  CapillaryNetDeviceHelper lowerHelper = CapillaryNetDeviceHelper ();
+  lowerHelper.SetChannel (channel);
+  lowerHelper.SetTxPowerSpectralDensity (sf.CreateTxPowerSpectralDensity (0.1, 1));
+  lowerHelper.SetNoisePowerSpectralDensity (noisePsd);
+  lowerHelper.SetControllerTypeId ("ns3::BasicController");
+
+  uint32_t width = 1;
+  while (width * width < nRelays)
+    {
+      width++;
+    }
+
+  Ptr<GridPositionAllocator> layout = CreateObject<GridPositionAllocator> ();
+  layout->SetAttribute ("DeltaX", DoubleValue (spacing));
+  layout->SetAttribute ("DeltaY", DoubleValue (spacing));
+  layout->SetAttribute ("GridWidth", UintegerValue (width));
+
+  CapillaryCellHelper cells;
+  cells.SetDeviceHelper (lowerHelper);
+  cells.SetLayout (layout);
+  cells.SetEndDevices (nDevices);
+  cells.SetCellRadius (radius);
+  NetDeviceContainer lowerDevices = cells.Install (nRelays);
+
+  /* upper tier, channel 6: the sink and the lower coordinators */
+  NodeContainer sink;
+  sink.Create (1);
+
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (sink);
+  sink.Get (0)->GetObject<MobilityModel> ()->SetPosition (Vector (spacing * (width - 1) / 2, spacing * (width - 1) / 2, 0));
+
+  NodeContainer upperNodes;
+  upperNodes.Add (sink);
+  for (uint32_t i = 0; i < nRelays; i++)
+    {
+      upperNodes.Add (cells.GetNodes (i).Get (0));
+    }
+
+  CapillaryNetDeviceHelper upperHelper = CapillaryNetDeviceHelper ();
+  upperHelper.SetChannel (channel);
+  upperHelper.SetTxPowerSpectralDensity (sf.CreateTxPowerSpectralDensity (0.1, 6));
+  upperHelper.SetNoisePowerSpectralDensity (noisePsd);
+  upperHelper.SetControllerTypeId ("ns3::BasicController");
+  NetDeviceContainer upperDevices = upperHelper.Install (upperNodes);
+  Ptr<CapillaryNetDevice> sinkDevice = upperHelper.SetCoordinator (upperDevices.Get (0));
+
+  for (uint32_t i = 0; i < upperDevices.GetN (); i++)
+    {
+      DynamicCast<CapillaryNetDevice> (upperDevices.Get (i))->GetMac ()->SetAttribute ("CellId", UintegerValue (nRelays));
+    }
+
+  /* relays */
+  CapillaryRunningStats delay;
+  uint32_t drops = 0;
+
+  for (uint32_t i = 0; i < nRelays; i++)
+    {
+      Ptr<CapillaryRelay> relay = CreateObject<CapillaryRelay> ();
+      relay->Install (cells.GetCoordinator (i), DynamicCast<CapillaryNetDevice> (upperDevices.Get (i + 1)));
+      relay->TraceConnectWithoutContext ("Drop", MakeBoundCallback (&RelayDrop, &drops));
+      cells.GetCoordinator (i)->GetNode ()->AggregateObject (relay);
+    }
+
+  Ptr<CapillaryRelay> sinkRelay = CreateObject<CapillaryRelay> ();
+  sinkRelay->Install (sinkDevice, 0);
+  sinkRelay->TraceConnectWithoutContext ("Rx", MakeBoundCallback (&SinkRx, &delay));
+  sink.Get (0)->AggregateObject (sinkRelay);
+
+  /* energy */
+  NodeContainer nodes = cells.GetAllNodes ();
+  nodes.Add (sink);
+
+  NetDeviceContainer capillaryDevices;
+  capillaryDevices.Add (lowerDevices);
+  capillaryDevices.Add (upperDevices);
+
+  BasicEnergySourceHelper basicSourceHelper;
+  EnergySourceContainer sources = basicSourceHelper.Install (nodes);
+
+  CapillaryEnergyModelHelper capillaryEnergyModelHelper = CapillaryEnergyModelHelper ();
+  capillaryEnergyModelHelper.Install (capillaryDevices, sources);
+
+  /* sensors on the end devices of the lower cells */
+  SensorApplicationHelper sensor = SensorApplicationHelper ();
+  for (uint32_t c = 0; c < cells.GetNCells (); c++)
+    {
+      NodeContainer cellNodes = cells.GetNodes (c);
+      for (uint32_t i = 1; i < cellNodes.GetN (); i++)
+        {
+          ApplicationContainer sensors = sensor.Install (cellNodes.Get (i));
+          sensors.Start (Seconds (0));
+          sensors.Stop (Seconds (stopAt));
+        }
+    }
+
+  Simulator::Stop (Seconds (stopAt));
+  Simulator::Run ();
+
+  std::cout << "packets at the sink: " << delay.GetCount () << std::endl;
+  std::cout << "relay drops: " << drops << std::endl;
+  if (delay.GetCount () > 0)
+    {
+      std::cout << "delay (s): mean " << delay.GetMean ()
+                << " min " << delay.GetMin ()
+                << " max " << delay.GetMax () << std::endl;
+    }
+
+  Simulator::Destroy ();
+
+  return 0;
+}
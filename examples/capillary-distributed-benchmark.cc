@@ -0,0 +1,241 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include <ns3/core-module.h>
+#include <ns3/mobility-module.h>
+#include <ns3/spectrum-module.h>
+#include <ns3/energy-module.h>
+#include <ns3/network-module.h>
+#include <ns3/internet-module.h>
+#include <ns3/point-to-point-module.h>
+#include <ns3/mpi-interface.h>
+#include <ns3/capillary-network-module.h>
+#include <ns3/capillary-aloha-module.h>
+#include <ns3/applications-module.h>
+
+#include <algorithm>
+#include <iostream>
+
+using namespace ns3;
+
+/*
+ * Distributed multi-cell benchmark.
+ *
+ * Every group of --group consecutive cells shares a spectrum channel,
+ * the cells of distinct groups do not interfere. The groups depend only
+ * on the scenario, not on the number of ranks, so the runs of a scaling
+ * study simulate the same network. The groups are split in contiguous
+ * blocks among the MPI ranks, a group never straddling two of them.
+ *
+ * The coordinators deliver the received data over point-to-point
+ * backhaul links to a collector on rank 0. These links are the only
+ * cross-rank traffic and their delay is the lookahead of the
+ * distributed simulator: a spectrum channel shared by cells of
+ * different ranks is not handled, which is why the groups stay whole.
+ * With fewer groups than ranks some ranks are left idle.
+ *
+ * mpirun -np 4 ./waf --run "capillary-distributed-benchmark --cells=16 --group=4"
+ *
+ * or see capillary-distributed-scaling.sh. Rank 0 prints one line:
+ *
+ *   <ranks> <cells> <nodes> <simSeconds> <wallSeconds> <simRate> <backhaulPackets>
+ */
+
+static void
+Backhaul (Ptr<Socket> socket, Ptr<const Packet> packet, Mac64Address source, Time delay)
+{
+  socket->Send (packet->Copy ());
+}
+
+static void
+CollectorRx (uint64_t *packets, Ptr<const Packet> packet, const Address &from)
+{
+  (*packets)++;
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t nCells = 16;
+  uint32_t nDevices = 10;
+  uint32_t group = 4;
+  double spacing = 20;
+  double radius = 10;
+  double stopAt = 60;
+  double backhaulDelay = 5;
+
+  MpiInterface::Enable (&argc, &argv);
+  GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::DistributedSimulatorImpl"));
+
+  CommandLine cmd;
+  cmd.AddValue ("cells", "The number of cells", nCells);
+  cmd.AddValue ("devices", "The number of end devices of each cell", nDevices);
+  cmd.AddValue ("group", "The number of consecutive cells sharing a channel", group);
+  cmd.AddValue ("spacing", "The distance between two neighbour coordinators (m)", spacing);
+  cmd.AddValue ("radius", "The radius of a cell (m)", radius);
+  cmd.AddValue ("backhaul", "The delay of the backhaul links, i.e. the lookahead (ms)", backhaulDelay);
+  cmd.AddValue ("stop", "The simulated time (s)", stopAt);
+  cmd.Parse (argc, argv);
+
+  uint32_t rank = MpiInterface::GetSystemId ();
+  uint32_t nRanks = MpiInterface::GetSize ();
+
+  /* the collector is created first, so that the node ids agree on every rank */
+  NodeContainer collector;
+  collector.Create (1, 0);
+
+  /* the cells, each rank installing the devices of its own ones, one channel per group */
+  SpectrumChannelHelper channelHelper = SpectrumChannelHelper::Default ();
+
+  const double k = 1.381e-23;               //Boltzmann's constant
+  const double T = 290;               // temperature in Kelvin
+
+  WifiSpectrumValue5MhzFactory sf;
+  CapillaryNetDeviceHelper deviceHelper = CapillaryNetDeviceHelper ();
+  deviceHelper.SetTxPowerSpectralDensity (sf.CreateTxPowerSpectralDensity (0.1, 1));
+  deviceHelper.SetNoisePowerSpectralDensity (sf.CreateConstant (k * T));
+  deviceHelper.SetControllerTypeId ("ns3::BasicController");
+
+  uint32_t width = 1;
+  while (width * width < nCells)
+    {
+      width++;
+    }
+
+  Ptr<GridPositionAllocator> layout = CreateObject<GridPositionAllocator> ();
+  layout->SetAttribute ("DeltaX", DoubleValue (spacing));
+  layout->SetAttribute ("DeltaY", DoubleValue (spacing));
+  layout->SetAttribute ("GridWidth", UintegerValue (width));
+
+  CapillaryCellHelper cells;
+  cells.SetDeviceHelper (deviceHelper);
+  cells.SetLayout (layout);
+  cells.SetEndDevices (nDevices);
+  cells.SetCellRadius (radius);
+  cells.SetSystem (nRanks, rank);
+  cells.SetChannelGroups (std::max<uint32_t> (group, 1), channelHelper);
+  NetDeviceContainer capillaryDevices = cells.Install (nCells);
+
+  /* backhaul: one link from every coordinator to the collector */
+  NodeContainer backhaulNodes;
+  backhaulNodes.Add (collector);
+  for (uint32_t c = 0; c < nCells; c++)
+    {
+      backhaulNodes.Add (cells.GetNodes (c).Get (0));
+    }
+
+  InternetStackHelper internet;
+  internet.Install (backhaulNodes);
+
+  PointToPointHelper p2p;
+  p2p.SetDeviceAttribute ("DataRate", StringValue ("10Mbps"));
+  p2p.SetChannelAttribute ("Delay", TimeValue (Seconds (backhaulDelay / 1000)));
+
+  Ipv4AddressHelper address;
+  address.SetBase ("10.1.0.0", "255.255.255.252");
+
+  const uint16_t port = 9;
+  uint64_t backhaulPackets = 0;
+
+  for (uint32_t c = 0; c < nCells; c++)
+    {
+      Ptr<Node> coordinator = cells.GetNodes (c).Get (0);
+      Ipv4InterfaceContainer interfaces = address.Assign (p2p.Install (coordinator, collector.Get (0)));
+      address.NewNetwork ();
+
+      if (!cells.IsLocal (c))
+        {
+          continue;
+        }
+
+      Ptr<Socket> socket = Socket::CreateSocket (coordinator, UdpSocketFactory::GetTypeId ());
+      socket->Connect (InetSocketAddress (interfaces.GetAddress (1), port));
+
+      Ptr<CapillaryRelay> relay = CreateObject<CapillaryRelay> ();
+      relay->Install (cells.GetCoordinator (c), 0);
+      relay->TraceConnectWithoutContext ("Rx", MakeBoundCallback (&Backhaul, socket));
+      coordinator->AggregateObject (relay);
+    }
+
+  if (rank == 0)
+    {
+      PacketSinkHelper sinkHelper ("ns3::UdpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
+      ApplicationContainer sinks = sinkHelper.Install (collector.Get (0));
+      sinks.Get (0)->TraceConnectWithoutContext ("Rx", MakeBoundCallback (&CollectorRx, &backhaulPackets));
+    }
+
+  /* energy and sensors of the local cells */
+  NodeContainer localNodes;
+  for (uint32_t c = 0; c < nCells; c++)
+    {
+      if (cells.IsLocal (c))
+        {
+          localNodes.Add (cells.GetNodes (c));
+        }
+    }
+
+  BasicEnergySourceHelper basicSourceHelper;
+  EnergySourceContainer sources = basicSourceHelper.Install (localNodes);
+
+  CapillaryEnergyModelHelper capillaryEnergyModelHelper = CapillaryEnergyModelHelper ();
+  capillaryEnergyModelHelper.Install (capillaryDevices, sources);
+
+  SensorApplicationHelper sensor = SensorApplicationHelper ();
+  for (uint32_t c = 0; c < nCells; c++)
+    {
+      if (!cells.IsLocal (c))
+        {
+          continue;
+        }
+
+      // the first node of a cell is its coordinator
+      NodeContainer cellNodes = cells.GetNodes (c);
+      for (uint32_t i = 1; i < cellNodes.GetN (); i++)
+        {
+          ApplicationContainer sensors = sensor.Install (cellNodes.Get (i));
+          sensors.Start (Seconds (0));
+          sensors.Stop (Seconds (stopAt));
+        }
+    }
+
+  SystemWallClockMs clock;
+  clock.Start ();
+
+  Simulator::Stop (Seconds (stopAt));
+  Simulator::Run ();
+
+  double wall = clock.End () / 1000.0;
+
+  if (rank == 0)
+    {
+      std::cout << "# ranks cells nodes simSeconds wallSeconds simRate backhaulPackets" << std::endl;
+      std::cout << nRanks << " "
+                << nCells << " "
+                << cells.GetAllNodes ().GetN () << " "
+                << stopAt << " "
+                << wall << " "
+                << ((wall > 0) ? stopAt / wall : 0) << " "
+                << backhaulPackets << std::endl;
+    }
+
+  Simulator::Destroy ();
+  MpiInterface::Disable ();
+
+  return 0;
+}
@@ -0,0 +1,24 @@
+#!/bin/sh
+#
+# Scaling of capillary-distributed-benchmark over 1 to 16 local ranks.
+#
+# Run from the ns-3 root directory, with MPI enabled:
+#
+#   ./waf configure --enable-mpi --enable-examples
+#   src/capillary-aloha/examples/capillary-distributed-scaling.sh [benchmark arguments]
+#
+# e.g. "--cells=64 --group=4 --devices=10 --stop=60". The channel groups
+# do not depend on the ranks, so every run simulates the same network;
+# with fewer than 16 groups the largest runs leave ranks idle. Set MPIRUN
+# to change the launcher, e.g. MPIRUN="mpirun --oversubscribe" on fewer
+# than 16 cores.
+
+MPIRUN=${MPIRUN:-mpirun}
+
+./waf build || exit 1
+
+echo "# ranks cells nodes simSeconds wallSeconds simRate backhaulPackets"
+for ranks in 1 2 4 8 16
+do
+  ./waf --command-template="$MPIRUN -np $ranks %s $*" --run capillary-distributed-benchmark | grep -v "^#" | tail -n 1
+done
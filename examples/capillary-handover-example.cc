@@ -0,0 +1,181 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include <ns3/core-module.h>
+#include <ns3/mobility-module.h>
+#include <ns3/spectrum-module.h>
+#include <ns3/energy-module.h>
+#include <ns3/network-module.h>
+#include <ns3/capillary-network-module.h>
+#include <ns3/capillary-aloha-module.h>
+#include <ns3/applications-module.h>
+
+#include <iostream>
+#include <vector>
+
+using namespace ns3;
+
+/*
+ * End-device handover between two cells.
+ *
+ * Two cells are placed side by side; a few movers start close to the
+ * coordinator of cell 0 and walk toward the one of cell 1. With
+ * --handover the movers track the quality of the RFD and FBP they hear
+ * and join the cell whose link is better by the hysteresis margin.
+ *
+ * ./waf --run "capillary-handover-example --movers=2 --speed=0.5 --handover=1"
+ *
+ * The handovers are printed as they happen, then the packets delivered
+ * by each coordinator.
+ */
+
+static void
+CellChange (uint32_t mover, uint16_t oldCell, uint16_t newCell)
+{
+  std::cout << Simulator::Now ().GetSeconds () << "s mover " << mover
+            << ": cell " << oldCell << " -> " << newCell << std::endl;
+}
+
+static void
+CoordinatorRx (uint32_t *received, Ptr<const Packet> packet, Mac64Address source, Time delay)
+{
+  (*received)++;
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t nDevices = 5;
+  uint32_t nMovers = 2;
+  double spacing = 60;
+  double radius = 10;
+  double speed = 0.5;
+  bool handover = true;
+  double hysteresis = 3;
+  double stopAt = 150;
+
+  CommandLine cmd;
+  cmd.AddValue ("devices", "The number of static end devices of each cell", nDevices);
+  cmd.AddValue ("movers", "The number of moving end devices", nMovers);
+  cmd.AddValue ("spacing", "The distance between the two coordinators (m)", spacing);
+  cmd.AddValue ("radius", "The radius of a cell (m)", radius);
+  cmd.AddValue ("speed", "The speed of the movers (m/s)", speed);
+  cmd.AddValue ("handover", "Enable the handover of the end devices", handover);
+  cmd.AddValue ("hysteresis", "The handover hysteresis (dB)", hysteresis);
+  cmd.AddValue ("stop", "The simulated time (s)", stopAt);
+  cmd.Parse (argc, argv);
+
+  SpectrumChannelHelper channelHelper = SpectrumChannelHelper::Default ();
+
+  const double k = 1.381e-23;               //Boltzmann's constant
+  const double T = 290;               // temperature in Kelvin
+
+  WifiSpectrumValue5MhzFactory sf;
+  CapillaryNetDeviceHelper deviceHelper = CapillaryNetDeviceHelper ();
+  deviceHelper.SetChannel (channelHelper.Create ());
+  deviceHelper.SetTxPowerSpectralDensity (sf.CreateTxPowerSpectralDensity (0.1, 1));
+  deviceHelper.SetNoisePowerSpectralDensity (sf.CreateConstant (k * T));
+  deviceHelper.SetControllerTypeId ("ns3::BasicController");
+  deviceHelper.SetMacAttribute ("Handover", BooleanValue (handover));
+  deviceHelper.SetMacAttribute ("HandoverHysteresis", DoubleValue (hysteresis));
+
+  Ptr<ListPositionAllocator> layout = CreateObject<ListPositionAllocator> ();
+  layout->Add (Vector (0, 0, 0));
+  layout->Add (Vector (spacing, 0, 0));
+
+  CapillaryCellHelper cells;
+  cells.SetDeviceHelper (deviceHelper);
+  cells.SetLayout (layout);
+  cells.SetEndDevices (nDevices);
+  cells.SetCellRadius (radius);
+  NetDeviceContainer capillaryDevices = cells.Install (2);
+
+  /* the movers, starting in cell 0 */
+  NodeContainer movers;
+  movers.Create (nMovers);
+
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantVelocityMobilityModel");
+  mobility.Install (movers);
+
+  for (uint32_t i = 0; i < nMovers; i++)
+    {
+      Ptr<ConstantVelocityMobilityModel> model = movers.Get (i)->GetObject<ConstantVelocityMobilityModel> ();
+      model->SetPosition (Vector (radius / 2, i * radius / nMovers, 0));
+      model->SetVelocity (Vector (speed, 0, 0));
+    }
+
+  NetDeviceContainer moverDevices = deviceHelper.Install (movers);
+  for (uint32_t i = 0; i < moverDevices.GetN (); i++)
+    {
+      Ptr<CapillaryMac> mac = DynamicCast<CapillaryNetDevice> (moverDevices.Get (i))->GetMac ();
+      mac->SetAttribute ("CellId", UintegerValue (0));
+      mac->TraceConnectWithoutContext ("CellChange", MakeBoundCallback (&CellChange, i));
+    }
+  capillaryDevices.Add (moverDevices);
+
+  /* the coordinators deliver the data */
+  std::vector<uint32_t> received (cells.GetNCells (), 0);
+  for (uint32_t c = 0; c < cells.GetNCells (); c++)
+    {
+      Ptr<CapillaryRelay> relay = CreateObject<CapillaryRelay> ();
+      relay->Install (cells.GetCoordinator (c), 0);
+      relay->TraceConnectWithoutContext ("Rx", MakeBoundCallback (&CoordinatorRx, &received[c]));
+      cells.GetCoordinator (c)->GetNode ()->AggregateObject (relay);
+    }
+
+  NodeContainer nodes = cells.GetAllNodes ();
+  nodes.Add (movers);
+
+  BasicEnergySourceHelper basicSourceHelper;
+  EnergySourceContainer sources = basicSourceHelper.Install (nodes);
+
+  CapillaryEnergyModelHelper capillaryEnergyModelHelper = CapillaryEnergyModelHelper ();
+  capillaryEnergyModelHelper.Install (capillaryDevices, sources);
+
+  SensorApplicationHelper sensor = SensorApplicationHelper ();
+  for (uint32_t c = 0; c < cells.GetNCells (); c++)
+    {
+      NodeContainer cellNodes = cells.GetNodes (c);
+      for (uint32_t i = 1; i < cellNodes.GetN (); i++)
+        {
+          ApplicationContainer sensors = sensor.Install (cellNodes.Get (i));
+          sensors.Start (Seconds (0));
+          sensors.Stop (Seconds (stopAt));
+        }
+    }
+  for (uint32_t i = 0; i < movers.GetN (); i++)
+    {
+      ApplicationContainer sensors = sensor.Install (movers.Get (i));
+      sensors.Start (Seconds (0));
+      sensors.Stop (Seconds (stopAt));
+    }
+
+  Simulator::Stop (Seconds (stopAt));
+  Simulator::Run ();
+
+  for (uint32_t c = 0; c < cells.GetNCells (); c++)
+    {
+      std::cout << "cell " << c << ": " << received[c] << " packets delivered" << std::endl;
+    }
+
+  Simulator::Destroy ();
+
+  return 0;
+}
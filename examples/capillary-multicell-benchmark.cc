@@ -0,0 +1,231 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include <ns3/core-module.h>
+#include <ns3/mobility-module.h>
+#include <ns3/spectrum-module.h>
+#include <ns3/energy-module.h>
+#include <ns3/network-module.h>
+#include <ns3/capillary-network-module.h>
+#include <ns3/capillary-aloha-module.h>
+#include <ns3/applications-module.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+/*
+ * Multi-cell benchmark: the wall clock time needed to simulate an
+ * increasing number of overlapping cells on one shared channel.
+ *
+ * ./waf --run "capillary-multicell-benchmark --cells=1,2,4,8,16 --devices=10"
+ *
+ * With --range the CapillaryGridSpectrumChannel only delivers the
+ * signals to the receivers within that distance of the transmitter.
+ *
+ * Each run prints one line:
+ *
+ *   <cells> <nodes> <simSeconds> <wallSeconds> <simRate> <dcrSeconds> <energyJ>
+ *
+ * with the mean DCR duration and the mean energy consumed by an end
+ * device. Comparing a run with --ack=1 to one without gives the latency
+ * and energy of the immediate ACKs against the FBP alone; --backoff
+ * shows the same for the end devices backing off after a collision.
+ */
+
+/** The DCR duration of the end devices */
+static CapillaryRunningStats g_dcrDuration;
+static std::vector<Time> g_dcrStart;
+
+static void
+DcrStatusSink (uint32_t index, CapillaryMac::DcrStatus previous, CapillaryMac::DcrStatus current)
+{
+  if (current == CapillaryMac::ACTIVE_START)
+    {
+      g_dcrStart[index] = Simulator::Now ();
+    }
+  else if (previous == CapillaryMac::ACTIVE_START && current == CapillaryMac::ACTIVE_STOP)
+    {
+      g_dcrDuration.Add ((Simulator::Now () - g_dcrStart[index]).GetSeconds ());
+    }
+}
+
+static NetDeviceContainer
+BuildScenario (uint32_t nCells, uint32_t nDevices, double spacing, double radius, double range, Time stopAt, EnergySourceContainer &sources)
+{
+  SpectrumChannelHelper channelHelper = SpectrumChannelHelper::Default ();
+  if (range > 0)
+    {
+      channelHelper.SetChannel ("ns3::CapillaryGridSpectrumChannel", "MaxDistance", DoubleValue (range));
+    }
+  Ptr<SpectrumChannel> channel = channelHelper.Create ();
+
+  const double k = 1.381e-23;               //Boltzmann's constant
+  const double T = 290;               // temperature in Kelvin
+
+  WifiSpectrumValue5MhzFactory sf;
+  CapillaryNetDeviceHelper deviceHelper = CapillaryNetDeviceHelper ();
+  deviceHelper.SetChannel (channel);
+  deviceHelper.SetTxPowerSpectralDensity (sf.CreateTxPowerSpectralDensity (0.1, 1));
+  deviceHelper.SetNoisePowerSpectralDensity (sf.CreateConstant (k * T));
+  deviceHelper.SetControllerTypeId ("ns3::BasicController");
+
+  // square grid of coordinators
+  uint32_t width = 1;
+  while (width * width < nCells)
+    {
+      width++;
+    }
+
+  Ptr<GridPositionAllocator> layout = CreateObject<GridPositionAllocator> ();
+  layout->SetAttribute ("DeltaX", DoubleValue (spacing));
+  layout->SetAttribute ("DeltaY", DoubleValue (spacing));
+  layout->SetAttribute ("GridWidth", UintegerValue (width));
+
+  CapillaryCellHelper cells;
+  cells.SetDeviceHelper (deviceHelper);
+  cells.SetLayout (layout);
+  cells.SetEndDevices (nDevices);
+  cells.SetCellRadius (radius);
+  NetDeviceContainer capillaryDevices = cells.Install (nCells);
+
+  NodeContainer nodes = cells.GetAllNodes ();
+
+  BasicEnergySourceHelper basicSourceHelper;
+  sources = basicSourceHelper.Install (nodes);
+
+  CapillaryEnergyModelHelper capillaryEnergyModelHelper = CapillaryEnergyModelHelper ();
+  capillaryEnergyModelHelper.Install (capillaryDevices, sources);
+
+  SensorApplicationHelper sensor = SensorApplicationHelper ();
+  for (uint32_t c = 0; c < cells.GetNCells (); c++)
+    {
+      NodeContainer cellNodes = cells.GetNodes (c);
+
+      // the first node of a cell is its coordinator
+      for (uint32_t i = 1; i < cellNodes.GetN (); i++)
+        {
+          ApplicationContainer sensors = sensor.Install (cellNodes.Get (i));
+          sensors.Start (Seconds (0));
+          sensors.Stop (stopAt);
+        }
+    }
+
+  g_dcrDuration = CapillaryRunningStats ();
+  g_dcrStart.assign (capillaryDevices.GetN (), Seconds (0));
+  for (uint32_t i = 0; i < capillaryDevices.GetN (); i++)
+    {
+      Ptr<CapillaryNetDevice> device = DynamicCast<CapillaryNetDevice> (capillaryDevices.Get (i));
+      if (device->GetType () == CapillaryNetDevice::END_DEVICE)
+        {
+          device->GetMac ()->TraceConnectWithoutContext ("DcrStatus", MakeBoundCallback (&DcrStatusSink, i));
+        }
+    }
+
+  return capillaryDevices;
+}
+
+int main (int argc, char *argv[])
+{
+  std::string cellCounts = "1,2,4,8";
+  uint32_t nDevices = 10;
+  double spacing = 20;
+  double radius = 10;
+  double range = 0;
+  uint16_t splitting = 0;
+  bool ack = false;
+  uint16_t replicas = 1;
+  std::string backoff = "None";
+  uint32_t retryLimit = 0;
+  double stopAt = 60;
+
+  CommandLine cmd;
+  cmd.AddValue ("cells", "Comma separated list of the cell counts to simulate", cellCounts);
+  cmd.AddValue ("devices", "The number of end devices of each cell", nDevices);
+  cmd.AddValue ("spacing", "The distance between two neighbour coordinators (m)", spacing);
+  cmd.AddValue ("radius", "The radius of a cell (m)", radius);
+  cmd.AddValue ("range", "The distance beyond which the signals are not delivered, 0 for no limit (m)", range);
+  cmd.AddValue ("splitting", "The sub-slots of a collided slot, 0 to retry in a full frame", splitting);
+  cmd.AddValue ("ack", "Acknowledge the DATA within their slot", ack);
+  cmd.AddValue ("replicas", "The copies of a DATA in a frame, recovered by interference cancellation", replicas);
+  cmd.AddValue ("backoff", "The backoff after a collision: None, FrameSkip or Persistence", backoff);
+  cmd.AddValue ("retry-limit", "The collisions after which a packet is dropped, 0 for no limit", retryLimit);
+  cmd.AddValue ("stop", "The simulated time of each run (s)", stopAt);
+  cmd.Parse (argc, argv);
+
+  Config::SetDefault ("ns3::FsalohaMac::SplittingFactor", UintegerValue (splitting));
+  Config::SetDefault ("ns3::FsalohaMac::ImmediateAck", BooleanValue (ack));
+  Config::SetDefault ("ns3::FsalohaMac::Replicas", UintegerValue (replicas));
+  Config::SetDefault ("ns3::FsalohaMac::Backoff", StringValue (backoff));
+  Config::SetDefault ("ns3::FsalohaMac::RetryLimit", UintegerValue (retryLimit));
+
+  std::vector<uint32_t> counts;
+  std::istringstream list (cellCounts);
+  std::string item;
+  while (std::getline (list, item, ','))
+    {
+      counts.push_back (std::atoi (item.c_str ()));
+    }
+
+  std::cout << "# cells nodes simSeconds wallSeconds simRate dcrSeconds energyJ" << std::endl;
+
+  for (uint32_t i = 0; i < counts.size (); i++)
+    {
+      EnergySourceContainer sources;
+      NetDeviceContainer devices = BuildScenario (counts[i], nDevices, spacing, radius, range, Seconds (stopAt), sources);
+
+      SystemWallClockMs clock;
+      clock.Start ();
+
+      Simulator::Stop (Seconds (stopAt));
+      Simulator::Run ();
+
+      double wall = clock.End () / 1000.0;
+
+      // the first source of a cell is its coordinator
+      double energy = 0;
+      uint32_t nEndDevices = 0;
+      for (uint32_t j = 0; j < sources.GetN (); j++)
+        {
+          if (j % (nDevices + 1) != 0)
+            {
+              Ptr<EnergySource> source = sources.Get (j);
+              energy += source->GetInitialEnergy () - source->GetRemainingEnergy ();
+              nEndDevices++;
+            }
+        }
+
+      std::cout << counts[i] << " "
+                << devices.GetN () << " "
+                << stopAt << " "
+                << wall << " "
+                << ((wall > 0) ? stopAt / wall : 0) << " "
+                << g_dcrDuration.GetMean () << " "
+                << ((nEndDevices > 0) ? energy / nEndDevices : 0) << std::endl;
+
+      Simulator::Destroy ();
+    }
+
+  return 0;
+}
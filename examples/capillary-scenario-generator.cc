@@ -0,0 +1,254 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include <ns3/core-module.h>
+#include <ns3/mobility-module.h>
+#include <ns3/spectrum-module.h>
+#include <ns3/energy-module.h>
+#include <ns3/network-module.h>
+#include <ns3/capillary-network-module.h>
+#include <ns3/capillary-aloha-module.h>
+#include <ns3/applications-module.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace ns3;
+
+/*
+ * Scenario generator for large deployments.
+ *
+ * The scenario is given by a compact spec of comma separated key=value
+ * pairs:
+ *
+ *   cells     the number of cells
+ *   devices   the number of end devices of each cell
+ *   slots     the FSA slots of a frame
+ *   spacing   the distance between two neighbour coordinators (m)
+ *   radius    the radius of a cell (m)
+ *
+ * ./waf --run "capillary-scenario-generator --spec=cells=1000,devices=100,slots=16"
+ *
+ * Cells, positions, energy sources and sensors are built in bulk and the
+ * memory footprint of every phase is reported, per node and in total.
+ * With --reference the footprint is checked against a reference written
+ * by an earlier run with --save_reference, and the program fails if it
+ * grew more than --tolerance.
+ */
+
+struct ScenarioSpec
+{
+  ScenarioSpec ()
+    : cells (10),
+    devices (100),
+    slots (16),
+    spacing (25),
+    radius (10)
+  {
+  }
+
+  uint32_t cells;
+  uint32_t devices;
+  uint32_t slots;
+  double spacing;
+  double radius;
+};
+
+static bool
+ParseSpec (std::string spec, ScenarioSpec &scenario)
+{
+  std::istringstream list (spec);
+  std::string item;
+  while (std::getline (list, item, ','))
+    {
+      std::string::size_type eq = item.find ('=');
+      if (eq == std::string::npos)
+        {
+          std::cerr << "Malformed spec item: " << item << std::endl;
+          return false;
+        }
+
+      std::string key = item.substr (0, eq);
+      const char *value = item.c_str () + eq + 1;
+
+      if (key == "cells")
+        {
+          scenario.cells = std::atoi (value);
+        }
+      else if (key == "devices")
+        {
+          scenario.devices = std::atoi (value);
+        }
+      else if (key == "slots")
+        {
+          scenario.slots = std::atoi (value);
+        }
+      else if (key == "spacing")
+        {
+          scenario.spacing = std::atof (value);
+        }
+      else if (key == "radius")
+        {
+          scenario.radius = std::atof (value);
+        }
+      else
+        {
+          std::cerr << "Unknown spec key: " << key << std::endl;
+          return false;
+        }
+    }
+
+  return true;
+}
+
+int main (int argc, char *argv[])
+{
+  std::string spec = "";
+  bool traces = false;
+  double stopAt = 0;
+  std::string reference = "";
+  std::string saveReference = "";
+  double tolerance = 0.1;
+
+  CommandLine cmd;
+  cmd.AddValue ("spec", "The scenario spec, e.g. cells=1000,devices=100,slots=16", spec);
+  cmd.AddValue ("traces", "Hook the statistics collector to every device", traces);
+  cmd.AddValue ("stop", "Run the scenario for stop seconds after building it", stopAt);
+  cmd.AddValue ("reference", "Check the footprint against this reference file", reference);
+  cmd.AddValue ("save_reference", "Save the footprint as a reference file", saveReference);
+  cmd.AddValue ("tolerance", "The accepted relative growth over the reference", tolerance);
+  cmd.Parse (argc, argv);
+
+  ScenarioSpec scenario;
+  if (!ParseSpec (spec, scenario))
+    {
+      return 1;
+    }
+
+  uint32_t nNodes = scenario.cells * (scenario.devices + 1);
+  std::cout << "# " << scenario.cells << " cells, " << scenario.devices << " devices per cell, "
+            << scenario.slots << " slots: " << nNodes << " nodes" << std::endl;
+
+  CapillaryMemoryReport memory;
+  memory.Start ();
+
+  /* cells */
+  SpectrumChannelHelper channelHelper = SpectrumChannelHelper::Default ();
+  Ptr<SpectrumChannel> channel = channelHelper.Create ();
+
+  const double k = 1.381e-23;               //Boltzmann's constant
+  const double T = 290;               // temperature in Kelvin
+
+  WifiSpectrumValue5MhzFactory sf;
+  CapillaryNetDeviceHelper deviceHelper = CapillaryNetDeviceHelper ();
+  deviceHelper.SetChannel (channel);
+  deviceHelper.SetTxPowerSpectralDensity (sf.CreateTxPowerSpectralDensity (0.1, 1));
+  deviceHelper.SetNoisePowerSpectralDensity (sf.CreateConstant (k * T));
+  deviceHelper.SetControllerTypeId ("ns3::BasicController");
+  deviceHelper.SetMacAttribute ("slots", UintegerValue (scenario.slots));
+
+  uint32_t width = 1;
+  while (width * width < scenario.cells)
+    {
+      width++;
+    }
+
+  Ptr<GridPositionAllocator> layout = CreateObject<GridPositionAllocator> ();
+  layout->SetAttribute ("DeltaX", DoubleValue (scenario.spacing));
+  layout->SetAttribute ("DeltaY", DoubleValue (scenario.spacing));
+  layout->SetAttribute ("GridWidth", UintegerValue (width));
+
+  CapillaryCellHelper cells;
+  cells.SetDeviceHelper (deviceHelper);
+  cells.SetLayout (layout);
+  cells.SetEndDevices (scenario.devices);
+  cells.SetCellRadius (scenario.radius);
+  NetDeviceContainer capillaryDevices = cells.Install (scenario.cells);
+  NodeContainer nodes = cells.GetAllNodes ();
+
+  memory.Mark ("cells");
+  memory.Account (capillaryDevices);
+
+  /* energy */
+  BasicEnergySourceHelper basicSourceHelper;
+  EnergySourceContainer sources = basicSourceHelper.Install (nodes);
+
+  CapillaryEnergyModelHelper capillaryEnergyModelHelper = CapillaryEnergyModelHelper ();
+  capillaryEnergyModelHelper.Install (capillaryDevices, sources);
+
+  memory.Mark ("energy");
+
+  /* sensors */
+  SensorApplicationHelper sensor = SensorApplicationHelper ();
+  for (uint32_t c = 0; c < cells.GetNCells (); c++)
+    {
+      NodeContainer cellNodes = cells.GetNodes (c);
+      for (uint32_t i = 1; i < cellNodes.GetN (); i++)
+        {
+          ApplicationContainer sensors = sensor.Install (cellNodes.Get (i));
+          sensors.Start (Seconds (0));
+          if (stopAt > 0)
+            {
+              sensors.Stop (Seconds (stopAt));
+            }
+        }
+    }
+
+  memory.Mark ("sensors");
+
+  /* trace hooks */
+  if (traces)
+    {
+      Ptr<CapillaryStatsCollector> collector = CreateObject<CapillaryStatsCollector> ();
+      collector->Install (capillaryDevices);
+      memory.Mark ("trace-hooks");
+    }
+
+  memory.Print (std::cout, nNodes);
+
+  int status = 0;
+  if (!saveReference.empty ())
+    {
+      memory.Save (saveReference, nNodes);
+    }
+  if (!reference.empty () && !memory.Check (reference, nNodes, tolerance, std::cerr))
+    {
+      std::cerr << "Memory footprint over the reference" << std::endl;
+      status = 1;
+    }
+
+  if (stopAt > 0)
+    {
+      SystemWallClockMs clock;
+      clock.Start ();
+
+      Simulator::Stop (Seconds (stopAt));
+      Simulator::Run ();
+
+      std::cout << "# wall " << clock.End () / 1000.0 << " s, rss "
+                << CapillarySimulationTelemetry::GetResidentSetSize () / (1024.0 * 1024.0) << " MB" << std::endl;
+    }
+
+  Simulator::Destroy ();
+
+  return status;
+}
@@ -0,0 +1,64 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include <ns3/core-module.h>
+#include <ns3/capillary-aloha-module.h>
+
+#include <fstream>
+#include <iostream>
+
+using namespace ns3;
+
+/*
+ * Convert a binary trace written by CapillaryBinaryTraceWriter to CSV.
+ *
+ * ./waf --run "capillary-trace-to-csv --input=DCR.bin --output=DCR.csv"
+ */
+int main (int argc, char *argv[])
+{
+  std::string input;
+  std::string output;
+
+  CommandLine cmd;
+  cmd.AddValue ("input", "The binary trace file to convert", input);
+  cmd.AddValue ("output", "The CSV file to write (default: standard output)", output);
+  cmd.Parse (argc, argv);
+
+  CapillaryBinaryTraceReader reader (input);
+  if (!reader.IsValid ())
+    {
+      std::cerr << "Invalid trace file: " << input << std::endl;
+      return 1;
+    }
+
+  uint64_t records = 0;
+  if (output.empty ())
+    {
+      records = reader.ConvertToCsv (std::cout);
+    }
+  else
+    {
+      std::ofstream csv (output.c_str ());
+      records = reader.ConvertToCsv (csv);
+    }
+
+  std::cerr << records << " records converted." << std::endl;
+  return 0;
+}
@@ -0,0 +1,243 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include "capillary-cell-helper.h"
+
+#include <ns3/assert.h>
+#include <ns3/capillary-mac.h>
+#include <ns3/log.h>
+#include <ns3/mobility-model.h>
+#include <ns3/node.h>
+#include <ns3/object-factory.h>
+#include <ns3/uinteger.h>
+#include <ns3/vector.h>
+#include <cmath>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("CapillaryCellHelper");
+
+CapillaryCellHelper::CapillaryCellHelper ()
+  : m_nDevices (1),
+  m_radius (10),
+  m_nSystems (1),
+  m_systemId (0),
+  m_cellsPerChannel (0)
+{
+  NS_LOG_FUNCTION (this);
+  m_random = CreateObject<UniformRandomVariable> ();
+}
+
+CapillaryCellHelper::~CapillaryCellHelper ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+CapillaryCellHelper::SetDeviceHelper (const CapillaryNetDeviceHelper &helper)
+{
+  NS_LOG_FUNCTION (this);
+  m_deviceHelper = helper;
+}
+
+void
+CapillaryCellHelper::SetLayout (Ptr<PositionAllocator> layout)
+{
+  NS_LOG_FUNCTION (this << layout);
+  m_layout = layout;
+}
+
+void
+CapillaryCellHelper::SetEndDevices (uint32_t nDevices)
+{
+  NS_LOG_FUNCTION (this << nDevices);
+  m_nDevices = nDevices;
+}
+
+void
+CapillaryCellHelper::SetCellRadius (double radius)
+{
+  NS_LOG_FUNCTION (this << radius);
+  NS_ASSERT (radius >= 0);
+  m_radius = radius;
+}
+
+void
+CapillaryCellHelper::SetSystem (uint32_t nSystems, uint32_t systemId)
+{
+  NS_LOG_FUNCTION (this << nSystems << systemId);
+  NS_ASSERT (nSystems > 0 && systemId < nSystems);
+  m_nSystems = nSystems;
+  m_systemId = systemId;
+}
+
+void
+CapillaryCellHelper::SetChannelGroups (uint32_t cellsPerChannel, const SpectrumChannelHelper &channelHelper)
+{
+  NS_LOG_FUNCTION (this << cellsPerChannel);
+  m_cellsPerChannel = cellsPerChannel;
+  m_channelHelper = channelHelper;
+}
+
+NetDeviceContainer
+CapillaryCellHelper::Install (uint32_t nCells)
+{
+  NS_LOG_FUNCTION (this << nCells);
+  NS_ASSERT_MSG (m_layout, "No cell layout set");
+  NS_ASSERT_MSG (nCells <= 0xffff, "Too many cells");
+
+  ObjectFactory mobility;
+  mobility.SetTypeId ("ns3::ConstantPositionMobilityModel");
+
+  NetDeviceContainer all;
+
+  uint32_t groupSize = (m_cellsPerChannel > 0) ? m_cellsPerChannel : nCells;
+  uint32_t nGroups = (nCells + groupSize - 1) / groupSize;
+  if (m_cellsPerChannel > 0 && nGroups < m_nSystems)
+    {
+      NS_LOG_WARN ("Idle ranks: " << nGroups << " channel groups for " << m_nSystems << " ranks");
+    }
+
+  for (uint32_t cell = 0; cell < nCells; cell++)
+    {
+      uint32_t cellId = m_nodes.size ();
+
+      // contiguous blocks of cells, so that neighbours share a rank;
+      // the blocks are made of whole channel groups
+      uint32_t group = cell / groupSize;
+      uint32_t systemId = (m_cellsPerChannel > 0) ? (uint64_t) group * m_nSystems / nGroups : (uint64_t) cell * m_nSystems / nCells;
+
+      if (m_cellsPerChannel > 0 && cell % groupSize == 0)
+        {
+          // created on every rank, so that the channel ids agree
+          m_deviceHelper.SetChannel (m_channelHelper.Create ());
+        }
+
+      NodeContainer nodes;
+      nodes.Create (m_nDevices + 1, systemId);
+
+      Vector center = m_layout->GetNext ();
+      for (uint32_t i = 0; i < nodes.GetN (); i++)
+        {
+          Vector position = center;
+          if (i > 0)
+            {
+              // uniform over the disc
+              double rho = m_radius * std::sqrt (m_random->GetValue ());
+              double theta = 2 * M_PI * m_random->GetValue ();
+              position.x += rho * std::cos (theta);
+              position.y += rho * std::sin (theta);
+            }
+
+          Ptr<MobilityModel> model = mobility.Create<MobilityModel> ();
+          model->SetPosition (position);
+          nodes.Get (i)->AggregateObject (model);
+        }
+
+      m_nodes.push_back (nodes);
+      m_systemIds.push_back (systemId);
+
+      if (systemId != m_systemId)
+        {
+          NS_LOG_DEBUG ("Cell " << cellId << " at " << center << ": rank " << systemId);
+          m_devices.push_back (NetDeviceContainer ());
+          continue;
+        }
+
+      NetDeviceContainer devices = m_deviceHelper.Install (nodes);
+      m_deviceHelper.SetCoordinator (devices.Get (0));
+
+      for (uint32_t i = 0; i < devices.GetN (); i++)
+        {
+          Ptr<CapillaryNetDevice> device = DynamicCast<CapillaryNetDevice> (devices.Get (i));
+          NS_ASSERT (device);
+          device->GetMac ()->SetAttribute ("CellId", UintegerValue (cellId));
+        }
+
+      NS_LOG_DEBUG ("Cell " << cellId << " at " << center << ": " << devices.GetN () << " devices");
+
+      m_devices.push_back (devices);
+      all.Add (devices);
+    }
+
+  return all;
+}
+
+uint32_t
+CapillaryCellHelper::GetNCells (void) const
+{
+  return m_nodes.size ();
+}
+
+uint32_t
+CapillaryCellHelper::GetSystemId (uint32_t cellId) const
+{
+  NS_ASSERT (cellId < m_systemIds.size ());
+  return m_systemIds[cellId];
+}
+
+bool
+CapillaryCellHelper::IsLocal (uint32_t cellId) const
+{
+  return GetSystemId (cellId) == m_systemId;
+}
+
+NodeContainer
+CapillaryCellHelper::GetNodes (uint32_t cellId) const
+{
+  NS_ASSERT (cellId < m_nodes.size ());
+  return m_nodes[cellId];
+}
+
+NetDeviceContainer
+CapillaryCellHelper::GetDevices (uint32_t cellId) const
+{
+  NS_ASSERT (cellId < m_devices.size ());
+  return m_devices[cellId];
+}
+
+Ptr<CapillaryNetDevice>
+CapillaryCellHelper::GetCoordinator (uint32_t cellId) const
+{
+  NS_ASSERT (cellId < m_devices.size ());
+  NS_ASSERT_MSG (m_devices[cellId].GetN () > 0, "Cell " << cellId << " is not local");
+  return DynamicCast<CapillaryNetDevice> (m_devices[cellId].Get (0));
+}
+
+NodeContainer
+CapillaryCellHelper::GetAllNodes (void) const
+{
+  NodeContainer all;
+  for (uint32_t i = 0; i < m_nodes.size (); i++)
+    {
+      all.Add (m_nodes[i]);
+    }
+  return all;
+}
+
+int64_t
+CapillaryCellHelper::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+  m_random->SetStream (stream);
+  return 1;
+}
+
+} /* namespace ns3 */
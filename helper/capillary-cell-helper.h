@@ -0,0 +1,174 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+#ifndef HELPER_CAPILLARY_CELL_HELPER_H_
+#define HELPER_CAPILLARY_CELL_HELPER_H_
+
+#include <ns3/capillary-net-device.h>
+#include <ns3/capillary-net-device-helper.h>
+#include <ns3/net-device-container.h>
+#include <ns3/node-container.h>
+#include <ns3/position-allocator.h>
+#include <ns3/ptr.h>
+#include <ns3/random-variable-stream.h>
+#include <ns3/spectrum-helper.h>
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+
+/*
+ * Builds multi-cell deployments.
+ *
+ * Each cell gets a coordinator, placed at the next position of the
+ * layout, and a number of end devices uniformly spread over a disc of
+ * the given radius around it. All the devices are installed with the
+ * same CapillaryNetDeviceHelper, so the cells share the channel and
+ * interfere with each other, unless SetChannelGroups gives each group
+ * of consecutive cells its own channel; the FsalohaMac CellId of every
+ * device is set to the index of its cell.
+ *
+ * For a distributed simulation the cells are split in contiguous
+ * blocks among the ranks (see SetSystem), whole channel groups when
+ * they are set. Every rank creates the nodes
+ * of all the cells, so that node ids and positions agree, but installs
+ * the devices only on its own cells; the devices of the other cells
+ * are left empty.
+ */
+class CapillaryCellHelper
+{
+public:
+  CapillaryCellHelper ();
+  ~CapillaryCellHelper ();
+
+  /**
+   * @param helper the helper used to install the devices, with the
+   *        channel already configured
+   */
+  void SetDeviceHelper (const CapillaryNetDeviceHelper &helper);
+
+  /**
+   * @param layout the positions of the coordinators
+   */
+  void SetLayout (Ptr<PositionAllocator> layout);
+
+  /**
+   * @param nDevices the number of end devices of each cell
+   */
+  void SetEndDevices (uint32_t nDevices);
+
+  /**
+   * @param radius the radius of the cells, in meters
+   */
+  void SetCellRadius (double radius);
+
+  /**
+   * @param nSystems the number of ranks of the distributed simulation
+   * @param systemId the local rank
+   */
+  void SetSystem (uint32_t nSystems, uint32_t systemId);
+
+  /**
+   * Give every group of cellsPerChannel consecutive cells a channel of
+   * its own, so that the cells of distinct groups do not interfere.
+   * The groups are never split among ranks: a channel is local to a
+   * single rank.
+   *
+   * @param cellsPerChannel the cells of a group, 0 for a single channel
+   *        shared by all the cells (the default)
+   * @param channelHelper the helper creating the channels
+   */
+  void SetChannelGroups (uint32_t cellsPerChannel, const SpectrumChannelHelper &channelHelper);
+
+  /**
+   * Create the nodes of nCells cells and install the devices.
+   *
+   * @param nCells the number of cells
+   * @return all the installed devices
+   */
+  NetDeviceContainer Install (uint32_t nCells);
+
+  uint32_t GetNCells (void) const;
+
+  /**
+   * @param cellId the cell index
+   * @return the rank simulating the cell
+   */
+  uint32_t GetSystemId (uint32_t cellId) const;
+
+  /**
+   * @param cellId the cell index
+   * @return true if the cell is simulated by the local rank
+   */
+  bool IsLocal (uint32_t cellId) const;
+
+  /**
+   * @param cellId the cell index
+   * @return the nodes of the cell, the coordinator first
+   */
+  NodeContainer GetNodes (uint32_t cellId) const;
+
+  /**
+   * @param cellId the cell index
+   * @return the devices of the cell, the coordinator first; empty
+   *         for the cells of the other ranks
+   */
+  NetDeviceContainer GetDevices (uint32_t cellId) const;
+
+  /**
+   * @param cellId the cell index
+   * @return the coordinator of the cell, which must be local
+   */
+  Ptr<CapillaryNetDevice> GetCoordinator (uint32_t cellId) const;
+
+  /**
+   * @return the nodes of all the cells
+   */
+  NodeContainer GetAllNodes (void) const;
+
+  /**
+   * Assign a fixed random variable stream number to the placement of
+   * the end devices.
+   *
+   * @param stream the first stream index to use
+   * @return the number of stream indices assigned
+   */
+  int64_t AssignStreams (int64_t stream);
+
+private:
+  CapillaryNetDeviceHelper m_deviceHelper;
+  Ptr<PositionAllocator> m_layout;
+  uint32_t m_nDevices;
+  double m_radius;
+  uint32_t m_nSystems;
+  uint32_t m_systemId;
+
+  uint32_t m_cellsPerChannel;
+  SpectrumChannelHelper m_channelHelper;
+
+  Ptr<UniformRandomVariable> m_random;
+
+  std::vector<NodeContainer> m_nodes;
+  std::vector<NetDeviceContainer> m_devices;
+  std::vector<uint32_t> m_systemIds;
+};
+
+} /* namespace ns3 */
+
+#endif /* HELPER_CAPILLARY_CELL_HELPER_H_ */
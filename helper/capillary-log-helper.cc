@@ -30,6 +30,7 @@
 #include <ns3/simulator.h>
 #include <ns3/fsaloha-mac.h>
 #include <sstream>
+#include <vector>
 
 namespace ns3 {
 
@@ -46,6 +47,24 @@ PcapSniffCapillary (Ptr<PcapFileWrapper> file, Ptr<const Packet> packet)
   file->Write (Simulator::Now (), packet);
 }
 
+/**
+ * @brief Output an ascii line representing a packet event
+ * @param stream the output stream
+ * @param event the event prefix
+ * @param context the config path or the CapillaryTraceContext
+ * @param p the packet
+ */
+template <typename Context>
+static void
+AsciiCapillaryMacPacketLine (
+  Ptr<OutputStreamWrapper> stream,
+  const char *event,
+  const Context &context,
+  Ptr<const Packet> p)
+{
+  *stream->GetStream () << event << Simulator::Now ().GetSeconds () << " " << context << " " << *p << std::endl;
+}
+
 /**
  * @brief Output an ascii line representing the Transmit event (with context)
  * @param stream the output stream
@@ -58,7 +77,42 @@ AsciiCapillaryMacTransmitSinkWithContext (
   std::string context,
   Ptr<const Packet> p)
 {
-  *stream->GetStream () << "t " << Simulator::Now ().GetSeconds () << " " << context << " " << *p << std::endl;
+  AsciiCapillaryMacPacketLine (stream, "t ", context, p);
+}
+
+/**
+ * @brief Output an ascii line representing a packet event (numeric context)
+ * @param stream the output stream
+ * @param context the trace source
+ * @param p the packet
+ */
+static void
+AsciiCapillaryMacPacketSink (
+  Ptr<OutputStreamWrapper> stream,
+  CapillaryTraceContext context,
+  Ptr<const Packet> p)
+{
+  const char *event;
+  switch (context.source)
+    {
+    case CapillaryTraceContext::MAC_RX:
+      event = "r ";
+      break;
+    case CapillaryTraceContext::MAC_TX:
+      event = "t ";
+      break;
+    case CapillaryTraceContext::MAC_TX_ENQUEUE:
+      event = "+ ";
+      break;
+    case CapillaryTraceContext::MAC_TX_DEQUEUE:
+      event = "- ";
+      break;
+    default:
+      event = "d ";
+      break;
+    }
+
+  AsciiCapillaryMacPacketLine (stream, event, context, p);
 }
 
 
@@ -90,6 +144,65 @@ void CapillaryLogHelper::EnableLogComponents (enum LogLevel level)
   Packet::EnableChecking ();
 }
 
+void CapillaryLogHelper::EnableTracepoints (Ptr<CapillaryTraceWriter> writer)
+{
+  NS_LOG_FUNCTION (this);
+
+  CapillaryTracepoints::Enable (PrepareWriter (writer));
+  Simulator::ScheduleDestroy (&CapillaryTracepoints::Disable);
+}
+
+Ptr<OutputStreamWrapper> CapillaryLogHelper::CreateCompressedFileStream (std::string filename, uint32_t blockSize)
+{
+  NS_LOG_FUNCTION (this << filename << blockSize);
+
+  if (CapillaryCompressedStream::IsCompressionEnabled ())
+    {
+      filename += ".gz";
+    }
+
+  Ptr<CapillaryCompressedStream> file = Create<CapillaryCompressedStream> (filename, blockSize);
+
+  //
+  // The sinks only hold the wrapper, which does not own the stream: the
+  // helper keeps the file alive, so that late writes (e.g. from objects
+  // disposed after the file is closed) are safely discarded.
+  //
+  m_compressedFiles.push_back (file);
+
+  Simulator::ScheduleDestroy (&CapillaryLogHelper::CloseLast, file);
+  return file->GetStream ();
+}
+
+void CapillaryLogHelper::CloseLast (Ptr<CapillaryCompressedStream> file)
+{
+  //
+  // The destroy events run in order and the stream is usually created
+  // before the sinks scheduling their final flush (downsamplers, dumps):
+  // the close goes after every destroy event queued so far.
+  //
+  Simulator::ScheduleDestroy (&CapillaryCompressedStream::Close, file);
+}
+
+void CapillaryLogHelper::SetNumericContext (bool enable)
+{
+  NS_LOG_FUNCTION (this << enable);
+  m_numericContext = enable;
+}
+
+void CapillaryLogHelper::EnableAsyncWriter (uint32_t capacity)
+{
+  NS_LOG_FUNCTION (this << capacity);
+  NS_ASSERT (capacity > 1);
+  m_asyncCapacity = capacity;
+}
+
+void CapillaryLogHelper::DisableAsyncWriter (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_asyncCapacity = 0;
+}
+
 void CapillaryLogHelper::EnablePcapInternal (std::string prefix, Ptr<NetDevice> nd, bool promiscuous, bool explicitFilename)
 {
   NS_LOG_FUNCTION (this << prefix << nd << promiscuous << explicitFilename);
@@ -215,6 +328,20 @@ void CapillaryLogHelper::EnableAsciiInternal (Ptr<OutputStreamWrapper> stream, s
   // but the default trace sinks are actually publicly available static
   // functions that are always there waiting for just such a case.
   //
+  // In numeric mode the sinks get a CapillaryTraceContext and the path is
+  // only written out when an event is printed.
+  //
+
+  if (m_numericContext)
+    {
+      Ptr<CapillaryMac> mac = device->GetMac ();
+      mac->TraceConnectWithoutContext ("MacRx", MakeBoundCallback (&AsciiCapillaryMacPacketSink, stream, CapillaryTraceContext (nodeid, deviceid, CapillaryTraceContext::MAC_RX)));
+      mac->TraceConnectWithoutContext ("MacTx", MakeBoundCallback (&AsciiCapillaryMacPacketSink, stream, CapillaryTraceContext (nodeid, deviceid, CapillaryTraceContext::MAC_TX)));
+      mac->TraceConnectWithoutContext ("MacTxEnqueue", MakeBoundCallback (&AsciiCapillaryMacPacketSink, stream, CapillaryTraceContext (nodeid, deviceid, CapillaryTraceContext::MAC_TX_ENQUEUE)));
+      mac->TraceConnectWithoutContext ("MacTxDequeue", MakeBoundCallback (&AsciiCapillaryMacPacketSink, stream, CapillaryTraceContext (nodeid, deviceid, CapillaryTraceContext::MAC_TX_DEQUEUE)));
+      mac->TraceConnectWithoutContext ("MacTxDrop", MakeBoundCallback (&AsciiCapillaryMacPacketSink, stream, CapillaryTraceContext (nodeid, deviceid, CapillaryTraceContext::MAC_TX_DROP)));
+      return;
+    }
 
 
   oss.str ("");
@@ -247,6 +374,21 @@ void CapillaryLogHelper::EnableAsciiInternal (Ptr<OutputStreamWrapper> stream, P
   NS_ASSERT_MSG (device, "CapillaryLogHelper::EnableAsciiInternal(): Device " << device << " not of type ns3::CapillaryEnergyModel");
 
   uint32_t nodeid = device->GetNode ()->GetId ();
+
+  if (m_energyInterval > Seconds (0))
+    {
+      CapillaryTraceContext context (nodeid, CapillaryTraceContext::NO_DEVICE, CapillaryTraceContext::TOTAL_ENERGY_CONSUMPTION);
+      device->TraceConnectWithoutContext ("TotalEnergyConsumption", MakeBoundCallback (&CapillaryEnergyDownsampler::Sink, CreateDownsampler (stream, context)));
+      return;
+    }
+
+  if (m_numericContext)
+    {
+      CapillaryTraceContext context (nodeid, CapillaryTraceContext::NO_DEVICE, CapillaryTraceContext::TOTAL_ENERGY_CONSUMPTION);
+      device->TraceConnectWithoutContext ("TotalEnergyConsumption", MakeBoundCallback (&CapillaryTracer::NumericEnergyConsumptionSink, stream, context));
+      return;
+    }
+
   std::ostringstream oss;
 
   oss.str ("");
@@ -264,14 +406,24 @@ void CapillaryLogHelper::EnableAsciiInternal (Ptr<OutputStreamWrapper> stream, P
 
   uint32_t nodeid = device->GetNode ()->GetId ();
   uint32_t deviceid = device->GetIfIndex ();
+  Ptr<FsalohaMac> mac = DynamicCast<FsalohaMac> (device->GetMac ());
+
+  if (m_numericContext)
+    {
+      device->GetMac ()->TraceConnectWithoutContext ("DcrStatus", MakeBoundCallback (&CapillaryTracer::NumericDataCollectionRoundSink, stream, CapillaryTraceContext (nodeid, deviceid, CapillaryTraceContext::DCR_STATUS)));
+      if (mac)
+        {
+          mac->TraceConnectWithoutContext ("Frames", MakeBoundCallback (&CapillaryTracer::NumericFramesSink, stream, CapillaryTraceContext (nodeid, deviceid, CapillaryTraceContext::FRAMES)));
+        }
+      return;
+    }
+
   std::ostringstream oss;
 
   oss.str ("");
   oss << "/NodeList/" << nodeid << "/DeviceList/" << deviceid << "/$ns3::CapillaryNetDevice/Mac/DcrStatus";
   device->GetMac ()->TraceConnect ("DcrStatus", oss.str (), MakeBoundCallback (&CapillaryTracer::DefaultDataCollectionRoundSinkWithContext, stream));
 
-
-  Ptr<FsalohaMac> mac = DynamicCast<FsalohaMac> (device->GetMac ());
   if (mac)
     {
       oss.str ("");
@@ -289,6 +441,21 @@ void CapillaryLogHelper::EnableAsciiInternal (Ptr<OutputStreamWrapper> stream, P
   NS_ASSERT (nd);
 
   uint32_t nodeid = nd->GetNode ()->GetId ();
+
+  if (m_energyInterval > Seconds (0))
+    {
+      CapillaryTraceContext context (nodeid, CapillaryTraceContext::NO_DEVICE, CapillaryTraceContext::REMAINING_ENERGY);
+      nd->TraceConnectWithoutContext ("RemainingEnergy", MakeBoundCallback (&CapillaryEnergyDownsampler::Sink, CreateDownsampler (stream, context)));
+      return;
+    }
+
+  if (m_numericContext)
+    {
+      CapillaryTraceContext context (nodeid, CapillaryTraceContext::NO_DEVICE, CapillaryTraceContext::REMAINING_ENERGY);
+      nd->TraceConnectWithoutContext ("RemainingEnergy", MakeBoundCallback (&CapillaryTracer::NumericEnergySourceSink, stream, context));
+      return;
+    }
+
   std::ostringstream oss;
 
   oss.str ("");
@@ -296,6 +463,59 @@ void CapillaryLogHelper::EnableAsciiInternal (Ptr<OutputStreamWrapper> stream, P
   nd->TraceConnect ("RemainingEnergy", oss.str (), MakeBoundCallback (&CapillaryTracer::DefaultEnergySourceSinkWithContext, stream));
 }
 
+Ptr<CapillaryEnergyDownsampler> CapillaryLogHelper::CreateDownsampler (Ptr<OutputStreamWrapper> stream, CapillaryTraceContext context)
+{
+  NS_LOG_FUNCTION (this);
+
+  Ptr<CapillaryEnergyDownsampler> downsampler = Create<CapillaryEnergyDownsampler> (stream, context, m_energyInterval, m_energyThreshold);
+
+  // the last bucket of every node is written when the simulation ends
+  Simulator::ScheduleDestroy (&CapillaryEnergyDownsampler::Flush, downsampler);
+  return downsampler;
+}
+
+void CapillaryLogHelper::EnableBinaryInternal (Ptr<CapillaryTraceWriter> writer, Ptr<CapillaryNetDevice> device)
+{
+  NS_LOG_FUNCTION (this);
+
+  NS_ASSERT (writer);
+  NS_ASSERT_MSG (device, "CapillaryLogHelper::EnableBinaryInternal(): Device " << device << " not of type ns3::CapillaryNetDevice");
+
+  uint32_t nodeid = device->GetNode ()->GetId ();
+
+  device->GetMac ()->TraceConnectWithoutContext ("DcrStatus", MakeBoundCallback (&CapillaryTracer::BinaryDataCollectionRoundSink, writer, nodeid));
+
+  Ptr<FsalohaMac> mac = DynamicCast<FsalohaMac> (device->GetMac ());
+  if (mac)
+    {
+      mac->TraceConnectWithoutContext ("Frames", MakeBoundCallback (&CapillaryTracer::BinaryFramesSink, writer, nodeid));
+    }
+}
+
+void CapillaryLogHelper::EnableBinaryInternal (Ptr<CapillaryTraceWriter> writer, Ptr<CapillaryEnergyModel> device)
+{
+  NS_LOG_FUNCTION (this);
+
+  NS_ASSERT (writer);
+  NS_ASSERT_MSG (device, "CapillaryLogHelper::EnableBinaryInternal(): Device " << device << " not of type ns3::CapillaryEnergyModel");
+
+  uint32_t nodeid = device->GetNode ()->GetId ();
+
+  device->TraceConnectWithoutContext ("TotalEnergyConsumption", MakeBoundCallback (&CapillaryTracer::BinaryEnergyConsumptionSink, writer, nodeid));
+}
+
+void CapillaryLogHelper::EnableBinaryInternal (Ptr<CapillaryTraceWriter> writer, Ptr<EnergySource> nd)
+{
+  NS_LOG_FUNCTION (this);
+
+  NS_ASSERT (writer);
+  NS_ASSERT (nd);
+
+  uint32_t nodeid = nd->GetNode ()->GetId ();
+
+  nd->TraceConnectWithoutContext ("RemainingEnergy", MakeBoundCallback (&CapillaryTracer::BinaryEnergySourceSink, writer, nodeid));
+}
+
 
 } /* namespace ns3 */
 
@@ -23,10 +23,15 @@
 #include <ns3/capillary-net-device.h>
 #include <ns3/capillary-energy-model.h>
 #include <ns3/capillary-tracer.h>
+#include <ns3/capillary-async-trace-writer.h>
+#include <ns3/capillary-compressed-stream.h>
+#include <ns3/capillary-energy-downsampler.h>
+#include <ns3/capillary-tracepoints.h>
 #include <ns3/output-stream-wrapper.h>
 #include <ns3/ptr.h>
 #include <ns3/trace-helper.h>
 #include <string>
+#include <vector>
 #include <ns3/log.h>
 
 namespace ns3 {
@@ -50,12 +55,67 @@ public:
    */
   void EnableLogComponents (enum LogLevel level);
 
+  /**
+   * Enable the MAC and PHY static tracepoints (see capillary-tracepoints.h)
+   * until the simulator is destroyed. Unlike the log components they
+   * do not format anything: each hit is a binary record.
+   *
+   * @param writer the writer receiving the tracepoint records
+   */
+  void EnableTracepoints (Ptr<CapillaryTraceWriter> writer);
+
+  /**
+   * Create a gzip compressed output stream, a drop-in replacement for
+   * AsciiTraceHelper::CreateFileStream. The ".gz" suffix is appended to
+   * the file name when the module is built with zlib. The file is
+   * terminated when the simulator is destroyed, after the final flushes
+   * of the sinks.
+   *
+   * @param filename the output file name
+   * @param blockSize the size in bytes of the blocks handed to the compressor
+   * @return the stream to pass to the Enable*Ascii methods
+   */
+  Ptr<OutputStreamWrapper> CreateCompressedFileStream (std::string filename, uint32_t blockSize = CapillaryCompressedStream::DEFAULT_BLOCK_SIZE);
+
+  /**
+   * Select how the ascii trace sinks enabled from now on receive their
+   * context: a compact CapillaryTraceContext (default) or the config path
+   * string. The text written is the same.
+   *
+   * @param enable true to bind a CapillaryTraceContext
+   */
+  void SetNumericContext (bool enable);
+
+  /**
+   * Bind the binary trace sinks enabled from now on to asynchronous
+   * writers: records are queued in a ring of the given capacity and
+   * written by a background thread.
+   *
+   * @param capacity the ring capacity in records
+   */
+  void EnableAsyncWriter (uint32_t capacity = CapillaryAsyncTraceWriter::DEFAULT_CAPACITY);
+
+  /**
+   * Bind the binary trace sinks enabled from now on directly to their writers.
+   */
+  void DisableAsyncWriter (void);
+
   virtual void EnablePcapInternal (std::string prefix, Ptr<NetDevice> nd, bool promiscuous, bool explicitFilename);
   virtual void EnableAsciiInternal (Ptr<OutputStreamWrapper> stream, std::string prefix, Ptr<NetDevice> nd, bool explicitFilename);
   virtual void EnableAsciiInternal (Ptr<OutputStreamWrapper> stream, Ptr<CapillaryEnergyModel> nd);
   virtual void EnableAsciiInternal (Ptr<OutputStreamWrapper> stream, Ptr<CapillaryNetDevice> nd);
   virtual void EnableAsciiInternal (Ptr<OutputStreamWrapper> stream, Ptr<EnergySource> nd);
 
+  virtual void EnableBinaryInternal (Ptr<CapillaryTraceWriter> writer, Ptr<CapillaryNetDevice> nd);
+  virtual void EnableBinaryInternal (Ptr<CapillaryTraceWriter> writer, Ptr<CapillaryEnergyModel> nd);
+  virtual void EnableBinaryInternal (Ptr<CapillaryTraceWriter> writer, Ptr<EnergySource> nd);
+
+private:
+  Ptr<CapillaryEnergyDownsampler> CreateDownsampler (Ptr<OutputStreamWrapper> stream, CapillaryTraceContext context);
+  static void CloseLast (Ptr<CapillaryCompressedStream> file);
+
+  /** The compressed files of the helper, closed when the simulator is destroyed */
+  std::vector<Ptr<CapillaryCompressedStream> > m_compressedFiles;
 
 };
 
@@ -0,0 +1,243 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include "capillary-memory-report.h"
+
+#include <ns3/assert.h>
+#include <ns3/capillary-net-device.h>
+#include <ns3/capillary-phy-ideal.h>
+#include <ns3/capillary-simulation-telemetry.h>
+#include <ns3/drop-tail-queue.h>
+#include <ns3/fsaloha-mac.h>
+#include <ns3/log.h>
+#include <ns3/pointer.h>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("CapillaryMemoryReport");
+
+/** What the estimated entries leave out, stated with the report */
+static const char *g_excluded = "estimated entries exclude the energy source and model objects, the trace sinks and the packets held outside the MAC queues";
+
+CapillaryMemoryReport::CapillaryMemoryReport ()
+  : m_start (0),
+  m_last (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+CapillaryMemoryReport::~CapillaryMemoryReport ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+CapillaryMemoryReport::Start (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_start = CapillarySimulationTelemetry::GetResidentSetSize ();
+  m_last = m_start;
+}
+
+void
+CapillaryMemoryReport::Mark (std::string phase)
+{
+  NS_LOG_FUNCTION (this << phase);
+
+  uint64_t rss = CapillarySimulationTelemetry::GetResidentSetSize ();
+  Add (phase, (rss > m_last) ? rss - m_last : 0, true);
+  m_last = rss;
+}
+
+void
+CapillaryMemoryReport::Account (NetDeviceContainer devices)
+{
+  NS_LOG_FUNCTION (this);
+
+  uint64_t macs = 0;
+  uint64_t slotStatus = 0;
+  uint64_t coordinators = 0;
+  uint64_t queues = 0;
+  uint64_t queued = 0;
+  uint64_t phys = 0;
+
+  for (uint32_t i = 0; i < devices.GetN (); i++)
+    {
+      Ptr<CapillaryNetDevice> device = DynamicCast<CapillaryNetDevice> (devices.Get (i));
+      NS_ASSERT (device);
+
+      Ptr<FsalohaMac> mac = DynamicCast<FsalohaMac> (device->GetMac ());
+      if (mac)
+        {
+          macs += sizeof (FsalohaMac);
+          slotStatus += mac->GetSlotStatusSize ();
+          coordinators += mac->GetCoordinatorStateSize ();
+          // the data, the transmission and the alarm queues
+          const char *names[] = { "Queue", "TxQueue", "AlarmQueue" };
+          for (uint32_t q = 0; q < 3; q++)
+            {
+              PointerValue value;
+              mac->GetAttribute (names[q], value);
+              Ptr<Queue> queue = value.Get<Queue> ();
+              if (queue)
+                {
+                  queues += sizeof (DropTailQueue);
+                  queued += queue->GetNBytes ();
+                }
+            }
+          // the list nodes of the downlink queue of a coordinator; the
+          // preempted packet is a pointer of the MAC
+          queues += mac->GetDownlinkQueueLength () * (sizeof (Ptr<Packet>) + 2 * sizeof (void *));
+        }
+
+      Ptr<CapillaryPhyIdeal> phy = DynamicCast<CapillaryPhyIdeal> (device->GetPhy ());
+      if (phy)
+        {
+          // the PSD and the peak band of each channel
+          phys += sizeof (CapillaryPhyIdeal) + phy->GetNChannels () * (sizeof (Ptr<SpectrumValue>) + sizeof (uint32_t));
+        }
+    }
+
+  Add ("mac", macs, false);
+  Add ("mac-slot-status", slotStatus, false);
+  Add ("mac-coordinator", coordinators, false);
+  Add ("mac-queues", queues, false);
+  Add ("mac-queued", queued, false);
+  Add ("phy", phys, false);
+}
+
+void
+CapillaryMemoryReport::Add (std::string name, uint64_t bytes, bool measured)
+{
+  for (uint32_t i = 0; i < m_entries.size (); i++)
+    {
+      if (m_entries[i].name == name)
+        {
+          m_entries[i].bytes += bytes;
+          return;
+        }
+    }
+
+  Entry entry;
+  entry.name = name;
+  entry.bytes = bytes;
+  entry.measured = measured;
+  m_entries.push_back (entry);
+}
+
+uint64_t
+CapillaryMemoryReport::GetMeasuredTotal (void) const
+{
+  return m_last - m_start;
+}
+
+uint64_t
+CapillaryMemoryReport::Get (std::string name) const
+{
+  for (uint32_t i = 0; i < m_entries.size (); i++)
+    {
+      if (m_entries[i].name == name)
+        {
+          return m_entries[i].bytes;
+        }
+    }
+  return 0;
+}
+
+void
+CapillaryMemoryReport::Print (std::ostream &os, uint32_t nNodes) const
+{
+  NS_ASSERT (nNodes > 0);
+
+  for (uint32_t i = 0; i < m_entries.size (); i++)
+    {
+      os << (m_entries[i].measured ? "measured " : "estimated ")
+         << m_entries[i].name << " "
+         << m_entries[i].bytes << " "
+         << (double) m_entries[i].bytes / nNodes << std::endl;
+    }
+  os << "measured total " << GetMeasuredTotal () << " " << (double) GetMeasuredTotal () / nNodes << std::endl;
+  os << "# " << g_excluded << std::endl;
+}
+
+void
+CapillaryMemoryReport::Save (std::string fileName, uint32_t nNodes) const
+{
+  NS_ASSERT (nNodes > 0);
+
+  std::ofstream file (fileName.c_str ());
+  NS_ASSERT_MSG (file.is_open (), "Cannot open " << fileName);
+
+  file << "# name bytesPerNode" << std::endl;
+  file << "# " << g_excluded << std::endl;
+  for (uint32_t i = 0; i < m_entries.size (); i++)
+    {
+      file << m_entries[i].name << " " << (double) m_entries[i].bytes / nNodes << std::endl;
+    }
+  file << "total " << (double) GetMeasuredTotal () / nNodes << std::endl;
+}
+
+bool
+CapillaryMemoryReport::Check (std::string fileName, uint32_t nNodes, double tolerance, std::ostream &os) const
+{
+  NS_ASSERT (nNodes > 0);
+
+  std::ifstream file (fileName.c_str ());
+  NS_ASSERT_MSG (file.is_open (), "Cannot open " << fileName);
+
+  std::map<std::string, double> current;
+  for (uint32_t i = 0; i < m_entries.size (); i++)
+    {
+      current[m_entries[i].name] = (double) m_entries[i].bytes / nNodes;
+    }
+  current["total"] = (double) GetMeasuredTotal () / nNodes;
+
+  bool ok = true;
+  std::string line;
+  while (std::getline (file, line))
+    {
+      if (line.empty () || line[0] == '#')
+        {
+          continue;
+        }
+
+      std::istringstream iss (line);
+      std::string name;
+      double reference;
+      if (!(iss >> name >> reference))
+        {
+          continue;
+        }
+
+      std::map<std::string, double>::const_iterator it = current.find (name);
+      if (it != current.end () && it->second > reference * (1 + tolerance))
+        {
+          os << name << ": " << it->second << " bytes per node, reference " << reference << std::endl;
+          ok = false;
+        }
+    }
+
+  return ok;
+}
+
+} /* namespace ns3 */
@@ -0,0 +1,130 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+#ifndef HELPER_CAPILLARY_MEMORY_REPORT_H_
+#define HELPER_CAPILLARY_MEMORY_REPORT_H_
+
+#include <ns3/net-device-container.h>
+#include <stdint.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/*
+ * Memory footprint of a scenario.
+ *
+ * The measured entries are the growth of the resident set size across
+ * the phases of the scenario construction (Mark), the estimated ones
+ * the size of the MAC and PHY objects of the devices (Account). Both
+ * are reported in total and per node. The estimated entries cover the
+ * MAC and PHY objects, their slot status and channel vectors and the
+ * bytes waiting in the MAC queues; the energy objects and the trace
+ * sinks are left to the measured entries, as stated in the output.
+ *
+ * Save writes the per node sizes as a reference; Check compares the
+ * current sizes with a reference, so that memory regressions are
+ * caught.
+ */
+class CapillaryMemoryReport
+{
+public:
+  CapillaryMemoryReport ();
+  ~CapillaryMemoryReport ();
+
+  /**
+   * Take the baseline of the first phase.
+   */
+  void Start (void);
+
+  /**
+   * Charge to a phase the growth of the resident set size since the
+   * previous mark.
+   *
+   * @param phase the phase name
+   */
+  void Mark (std::string phase);
+
+  /**
+   * Add the estimated size of the MAC and PHY state of the devices,
+   * with the bytes waiting in their queues.
+   *
+   * @param devices the devices
+   */
+  void Account (NetDeviceContainer devices);
+
+  /**
+   * @return the resident set size grown since Start
+   */
+  uint64_t GetMeasuredTotal (void) const;
+
+  /**
+   * @param name a phase or an estimated component
+   * @return the bytes of the entry, 0 if unknown
+   */
+  uint64_t Get (std::string name) const;
+
+  /**
+   * Print one line per entry:
+   *
+   *   <measured|estimated> <name> <bytes> <bytesPerNode>
+   *
+   * followed by a comment line on what the estimates exclude.
+   *
+   * @param os the output stream
+   * @param nNodes the number of nodes of the scenario
+   */
+  void Print (std::ostream &os, uint32_t nNodes) const;
+
+  /**
+   * @param fileName the reference file to write
+   * @param nNodes the number of nodes of the scenario
+   */
+  void Save (std::string fileName, uint32_t nNodes) const;
+
+  /**
+   * Compare the per node sizes with a reference.
+   *
+   * @param fileName the reference file
+   * @param nNodes the number of nodes of the scenario
+   * @param tolerance the accepted relative growth
+   * @param os where the entries over the reference are reported
+   * @return false if some entry grew more than tolerance
+   */
+  bool Check (std::string fileName, uint32_t nNodes, double tolerance, std::ostream &os) const;
+
+private:
+  struct Entry
+  {
+    std::string name;
+    uint64_t bytes;
+    bool measured;
+  };
+
+  void Add (std::string name, uint64_t bytes, bool measured);
+
+  std::vector<Entry> m_entries;
+  uint64_t m_start;
+  uint64_t m_last;
+};
+
+} /* namespace ns3 */
+
+#endif /* HELPER_CAPILLARY_MEMORY_REPORT_H_ */
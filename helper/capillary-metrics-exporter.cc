@@ -0,0 +1,338 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include "capillary-metrics-exporter.h"
+
+#include <ns3/assert.h>
+#include <ns3/capillary-net-device.h>
+#include <ns3/energy-source-container.h>
+#include <ns3/enum.h>
+#include <ns3/log.h>
+#include <ns3/simulator.h>
+#include <cstdio>
+#include <sstream>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("CapillaryMetricsExporter");
+
+NS_OBJECT_ENSURE_REGISTERED (CapillaryMetricsExporter);
+
+/** The gauges of a cell, sampled when the snapshot is written */
+struct CellSample
+{
+  uint32_t queue;
+  uint32_t txQueue;
+  double remainingEnergy;
+  double consumedEnergy;
+};
+
+CapillaryMetricsExporter::CellCounters::CellCounters ()
+  : m_dcr (0),
+  m_dcrAborted (0),
+  m_frames (0),
+  m_drops (0)
+{
+  m_slots[FsalohaMac::EMPTY] = 0;
+  m_slots[FsalohaMac::OK] = 0;
+  m_slots[FsalohaMac::ERROR] = 0;
+}
+
+TypeId
+CapillaryMetricsExporter::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CapillaryMetricsExporter")
+    .SetParent<Object> ()
+    .AddConstructor<CapillaryMetricsExporter> ()
+    .AddAttribute ("Interval",
+                   "The simulated time between two snapshots.",
+                   TimeValue (Seconds (60)),
+                   MakeTimeAccessor (&CapillaryMetricsExporter::m_interval),
+                   MakeTimeChecker ())
+    .AddAttribute ("Format",
+                   "The output format.",
+                   EnumValue (CapillaryMetricsExporter::JSON_LINES),
+                   MakeEnumAccessor (&CapillaryMetricsExporter::m_format),
+                   MakeEnumChecker (CapillaryMetricsExporter::JSON_LINES, "JsonLines",
+                                    CapillaryMetricsExporter::PROMETHEUS, "Prometheus"))
+  ;
+  return tid;
+}
+
+CapillaryMetricsExporter::CapillaryMetricsExporter ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+CapillaryMetricsExporter::~CapillaryMetricsExporter ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+CapillaryMetricsExporter::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_snapshotEvent.Cancel ();
+  m_cells.clear ();
+  if (m_file.is_open ())
+    {
+      m_file.close ();
+    }
+  Object::DoDispose ();
+}
+
+void
+CapillaryMetricsExporter::AddCell (uint32_t cellId, NetDeviceContainer devices)
+{
+  NS_LOG_FUNCTION (this << cellId);
+
+  Cell cell;
+  cell.id = cellId;
+  cell.counters = Create<CellCounters> ();
+
+  for (NetDeviceContainer::Iterator i = devices.Begin (); i != devices.End (); ++i)
+    {
+      Ptr<CapillaryNetDevice> device = DynamicCast<CapillaryNetDevice> (*i);
+      NS_ASSERT_MSG (device, "CapillaryMetricsExporter::AddCell(): Device " << *i << " not of type ns3::CapillaryNetDevice");
+
+      bool coordinator = (device->GetType () == CapillaryNetDevice::COORDINATOR);
+
+      device->GetMac ()->TraceConnectWithoutContext ("DcrStatus", MakeBoundCallback (&CapillaryMetricsExporter::DcrStatusSink, cell.counters, coordinator));
+      device->GetMac ()->TraceConnectWithoutContext ("MacTxDrop", MakeBoundCallback (&CapillaryMetricsExporter::DropSink, cell.counters));
+
+      Ptr<FsalohaMac> mac = DynamicCast<FsalohaMac> (device->GetMac ());
+      if (mac)
+        {
+          mac->TraceConnectWithoutContext ("SlotStatus", MakeBoundCallback (&CapillaryMetricsExporter::SlotStatusSink, cell.counters));
+          cell.macs.push_back (mac);
+        }
+
+      cell.nodes.push_back (device->GetNode ());
+    }
+
+  m_cells.push_back (cell);
+}
+
+void
+CapillaryMetricsExporter::Start (std::string fileName)
+{
+  NS_LOG_FUNCTION (this << fileName);
+  NS_ASSERT (m_interval > Seconds (0));
+
+  m_fileName = fileName;
+  if (m_format == JSON_LINES)
+    {
+      m_file.open (m_fileName.c_str (), std::ios::out | std::ios::trunc);
+      NS_ASSERT_MSG (m_file.is_open (), "CapillaryMetricsExporter: unable to open " << m_fileName);
+    }
+
+  // the event keeps the exporter alive
+  m_snapshotEvent = Simulator::Schedule (m_interval, &CapillaryMetricsExporter::PeriodicSnapshot, Ptr<CapillaryMetricsExporter> (this));
+}
+
+void
+CapillaryMetricsExporter::Stop (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_snapshotEvent.Cancel ();
+}
+
+void
+CapillaryMetricsExporter::PeriodicSnapshot (void)
+{
+  Snapshot ();
+  m_snapshotEvent = Simulator::Schedule (m_interval, &CapillaryMetricsExporter::PeriodicSnapshot, Ptr<CapillaryMetricsExporter> (this));
+}
+
+void
+CapillaryMetricsExporter::Snapshot (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  switch (m_format)
+    {
+    case JSON_LINES:
+      WriteJson (m_file);
+      m_file.flush ();
+      break;
+
+    case PROMETHEUS:
+      {
+        // write aside and rename, so that readers never see a partial file
+        std::string tmpName = m_fileName + ".tmp";
+        std::ofstream tmp (tmpName.c_str (), std::ios::out | std::ios::trunc);
+        WritePrometheus (tmp);
+        tmp.close ();
+        if (std::rename (tmpName.c_str (), m_fileName.c_str ()) != 0)
+          {
+            NS_LOG_ERROR ("CapillaryMetricsExporter: unable to write " << m_fileName);
+          }
+      }
+      break;
+    }
+}
+
+static CellSample
+SampleCell (const std::vector<Ptr<FsalohaMac> > &macs, const std::vector<Ptr<Node> > &nodes)
+{
+  CellSample sample;
+  sample.queue = 0;
+  sample.txQueue = 0;
+  sample.remainingEnergy = 0;
+  sample.consumedEnergy = 0;
+
+  for (std::vector<Ptr<FsalohaMac> >::const_iterator it = macs.begin (); it != macs.end (); ++it)
+    {
+      sample.queue += (*it)->GetQueueLength ();
+      sample.txQueue += (*it)->GetTxQueueLength ();
+    }
+
+  for (std::vector<Ptr<Node> >::const_iterator it = nodes.begin (); it != nodes.end (); ++it)
+    {
+      Ptr<EnergySourceContainer> sources = (*it)->GetObject<EnergySourceContainer> ();
+      if (sources == 0)
+        {
+          continue;
+        }
+
+      for (EnergySourceContainer::Iterator s = sources->Begin (); s != sources->End (); ++s)
+        {
+          double remaining = (*s)->GetRemainingEnergy ();
+          sample.remainingEnergy += remaining;
+          sample.consumedEnergy += (*s)->GetInitialEnergy () - remaining;
+        }
+    }
+
+  return sample;
+}
+
+void
+CapillaryMetricsExporter::WriteJson (std::ostream &os) const
+{
+  double now = Simulator::Now ().GetSeconds ();
+
+  for (std::vector<Cell>::const_iterator it = m_cells.begin (); it != m_cells.end (); ++it)
+    {
+      Ptr<CellCounters> c = it->counters;
+      CellSample sample = SampleCell (it->macs, it->nodes);
+
+      os << "{\"time\":" << now
+         << ",\"cell\":" << it->id
+         << ",\"nodes\":" << it->nodes.size ()
+         << ",\"dcr\":" << c->m_dcr
+         << ",\"dcrAborted\":" << c->m_dcrAborted
+         << ",\"frames\":" << c->m_frames
+         << ",\"slotsEmpty\":" << c->m_slots[FsalohaMac::EMPTY]
+         << ",\"slotsOk\":" << c->m_slots[FsalohaMac::OK]
+         << ",\"slotsError\":" << c->m_slots[FsalohaMac::ERROR]
+         << ",\"drops\":" << c->m_drops
+         << ",\"queue\":" << sample.queue
+         << ",\"txQueue\":" << sample.txQueue
+         << ",\"remainingEnergy\":" << sample.remainingEnergy
+         << ",\"consumedEnergy\":" << sample.consumedEnergy
+         << "}\n";
+    }
+}
+
+static void
+WritePrometheusMetric (std::ostream &os, std::string name, std::string type, const std::vector<uint32_t> &cells, const std::vector<double> &values)
+{
+  os << "# TYPE capillary_" << name << " " << type << "\n";
+  for (size_t i = 0; i < cells.size (); i++)
+    {
+      os << "capillary_" << name << "{cell=\"" << cells[i] << "\"} " << values[i] << "\n";
+    }
+}
+
+void
+CapillaryMetricsExporter::WritePrometheus (std::ostream &os) const
+{
+  size_t n = m_cells.size ();
+  std::vector<uint32_t> cells (n);
+  std::vector<double> dcr (n), dcrAborted (n), frames (n), empty (n), ok (n), error (n), drops (n);
+  std::vector<double> queue (n), txQueue (n), remaining (n), consumed (n);
+
+  for (size_t i = 0; i < n; i++)
+    {
+      Ptr<CellCounters> c = m_cells[i].counters;
+      CellSample sample = SampleCell (m_cells[i].macs, m_cells[i].nodes);
+
+      cells[i] = m_cells[i].id;
+      dcr[i] = c->m_dcr;
+      dcrAborted[i] = c->m_dcrAborted;
+      frames[i] = c->m_frames;
+      empty[i] = c->m_slots[FsalohaMac::EMPTY];
+      ok[i] = c->m_slots[FsalohaMac::OK];
+      error[i] = c->m_slots[FsalohaMac::ERROR];
+      drops[i] = c->m_drops;
+      queue[i] = sample.queue;
+      txQueue[i] = sample.txQueue;
+      remaining[i] = sample.remainingEnergy;
+      consumed[i] = sample.consumedEnergy;
+    }
+
+  os << "# TYPE capillary_sim_time_seconds gauge\n";
+  os << "capillary_sim_time_seconds " << Simulator::Now ().GetSeconds () << "\n";
+
+  WritePrometheusMetric (os, "dcr_total", "counter", cells, dcr);
+  WritePrometheusMetric (os, "dcr_aborted_total", "counter", cells, dcrAborted);
+  WritePrometheusMetric (os, "frames_total", "counter", cells, frames);
+  WritePrometheusMetric (os, "slots_empty_total", "counter", cells, empty);
+  WritePrometheusMetric (os, "slots_ok_total", "counter", cells, ok);
+  WritePrometheusMetric (os, "slots_error_total", "counter", cells, error);
+  WritePrometheusMetric (os, "drops_total", "counter", cells, drops);
+  WritePrometheusMetric (os, "queue_packets", "gauge", cells, queue);
+  WritePrometheusMetric (os, "tx_queue_packets", "gauge", cells, txQueue);
+  WritePrometheusMetric (os, "remaining_energy_joules", "gauge", cells, remaining);
+  WritePrometheusMetric (os, "consumed_energy_joules", "gauge", cells, consumed);
+}
+
+void
+CapillaryMetricsExporter::DcrStatusSink (Ptr<CellCounters> counters, bool coordinator, CapillaryMac::DcrStatus previous, CapillaryMac::DcrStatus current)
+{
+  // DCRs are counted once per cell, by the coordinator; aborts happen on end devices
+  if (coordinator && current == CapillaryMac::ACTIVE_STOP)
+    {
+      counters->m_dcr++;
+    }
+  else if (current == CapillaryMac::ACTIVE_ABORT)
+    {
+      counters->m_dcrAborted++;
+    }
+}
+
+void
+CapillaryMetricsExporter::SlotStatusSink (Ptr<CellCounters> counters, const std::vector<FsalohaMac::SlotState> &status)
+{
+  counters->m_frames++;
+  for (std::vector<FsalohaMac::SlotState>::const_iterator it = status.begin (); it != status.end (); ++it)
+    {
+      counters->m_slots[*it]++;
+    }
+}
+
+void
+CapillaryMetricsExporter::DropSink (Ptr<CellCounters> counters, Ptr<const Packet> packet)
+{
+  counters->m_drops++;
+}
+
+} /* namespace ns3 */
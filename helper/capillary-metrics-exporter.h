@@ -0,0 +1,137 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+#ifndef HELPER_CAPILLARY_METRICS_EXPORTER_H_
+#define HELPER_CAPILLARY_METRICS_EXPORTER_H_
+
+#include <ns3/capillary-mac.h>
+#include <ns3/event-id.h>
+#include <ns3/fsaloha-mac.h>
+#include <ns3/net-device-container.h>
+#include <ns3/node.h>
+#include <ns3/nstime.h>
+#include <ns3/object.h>
+#include <ns3/packet.h>
+#include <ns3/ptr.h>
+#include <ns3/simple-ref-count.h>
+#include <stdint.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/*
+ * Periodic metrics snapshots.
+ *
+ * Every Interval of simulated time the exporter writes one snapshot of
+ * the cumulative counters of each cell: DCRs, frames, slot outcomes,
+ * MAC drops, plus the current queue depths and the energy of the
+ * nodes. The snapshots are either appended as JSON lines or written as
+ * a Prometheus text exposition, atomically replacing the previous one,
+ * so that the file can be followed while the simulation runs.
+ */
+class CapillaryMetricsExporter : public Object
+{
+public:
+  typedef enum
+  {
+    JSON_LINES,
+    PROMETHEUS
+  } Format;
+
+  static TypeId GetTypeId (void);
+
+  CapillaryMetricsExporter ();
+  virtual ~CapillaryMetricsExporter ();
+
+  /**
+   * Monitor a cell.
+   *
+   * @param cellId the cell identifier used in the output
+   * @param devices the coordinator and the end devices of the cell
+   */
+  void AddCell (uint32_t cellId, NetDeviceContainer devices);
+
+  /**
+   * Start writing a snapshot every Interval. Call Snapshot () for an
+   * extra one, e.g. right before the simulation stops.
+   *
+   * @param fileName the output file name
+   */
+  void Start (std::string fileName);
+
+  /**
+   * Stop the periodic snapshots, so that a simulation without a stop
+   * time can end.
+   */
+  void Stop (void);
+
+  /**
+   * Write a snapshot now.
+   */
+  void Snapshot (void);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  class CellCounters : public SimpleRefCount<CellCounters>
+  {
+public:
+    CellCounters ();
+
+    uint64_t m_dcr;
+    uint64_t m_dcrAborted;
+    uint64_t m_frames;
+    uint64_t m_slots[3];
+    uint64_t m_drops;
+  };
+
+  struct Cell
+  {
+    uint32_t id;
+    Ptr<CellCounters> counters;
+    std::vector<Ptr<FsalohaMac> > macs;
+    std::vector<Ptr<Node> > nodes;
+  };
+
+  static void DcrStatusSink (Ptr<CellCounters> counters, bool coordinator, CapillaryMac::DcrStatus previous, CapillaryMac::DcrStatus current);
+  static void SlotStatusSink (Ptr<CellCounters> counters, const std::vector<FsalohaMac::SlotState> &status);
+  static void DropSink (Ptr<CellCounters> counters, Ptr<const Packet> packet);
+
+  void PeriodicSnapshot (void);
+
+  void WriteJson (std::ostream &os) const;
+  void WritePrometheus (std::ostream &os) const;
+
+  Time m_interval;
+  Format m_format;
+
+  std::string m_fileName;
+  std::ofstream m_file;
+
+  std::vector<Cell> m_cells;
+
+  EventId m_snapshotEvent;
+};
+
+} /* namespace ns3 */
+
+#endif /* HELPER_CAPILLARY_METRICS_EXPORTER_H_ */
@@ -0,0 +1,114 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include "capillary-multi-channel-helper.h"
+
+#include <ns3/assert.h>
+#include <ns3/capillary-net-device.h>
+#include <ns3/capillary-phy-ideal.h>
+#include <ns3/fsaloha-mac.h>
+#include <ns3/log.h>
+#include <ns3/spectrum-channel.h>
+#include <ns3/uinteger.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("CapillaryMultiChannelHelper");
+
+CapillaryMultiChannelHelper::CapillaryMultiChannelHelper ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+CapillaryMultiChannelHelper::~CapillaryMultiChannelHelper ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+CapillaryMultiChannelHelper::AddChannel (Ptr<SpectrumValue> txPsd)
+{
+  NS_LOG_FUNCTION (this << txPsd);
+  NS_ASSERT (txPsd);
+  m_channels.push_back (txPsd);
+}
+
+void
+CapillaryMultiChannelHelper::SetNoisePowerSpectralDensity (Ptr<SpectrumValue> noisePsd)
+{
+  NS_LOG_FUNCTION (this << noisePsd);
+  m_noisePsd = noisePsd;
+}
+
+uint16_t
+CapillaryMultiChannelHelper::GetNChannels (void) const
+{
+  return m_channels.size () + 1;
+}
+
+void
+CapillaryMultiChannelHelper::Install (NetDeviceContainer devices) const
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT_MSG (m_channels.empty () || m_noisePsd, "No noise PSD set");
+
+  for (uint32_t i = 0; i < devices.GetN (); i++)
+    {
+      Ptr<CapillaryNetDevice> device = DynamicCast<CapillaryNetDevice> (devices.Get (i));
+      NS_ASSERT (device);
+
+      Ptr<CapillaryPhyIdeal> phy = DynamicCast<CapillaryPhyIdeal> (device->GetPhy ());
+      NS_ASSERT_MSG (phy, "Multiple channels need a CapillaryPhyIdeal");
+
+      Ptr<FsalohaMac> mac = DynamicCast<FsalohaMac> (device->GetMac ());
+      NS_ASSERT_MSG (mac, "Multiple channels need a FsalohaMac");
+
+      for (uint32_t c = 0; c < m_channels.size (); c++)
+        {
+          phy->AddChannel (m_channels[c]);
+        }
+      mac->SetAttribute ("Channels", UintegerValue (GetNChannels ()));
+
+      if (device->GetType () != CapillaryNetDevice::COORDINATOR)
+        {
+          continue;
+        }
+
+      // one receiver per added channel, co-located with the device
+      for (uint32_t c = 0; c < m_channels.size (); c++)
+        {
+          Ptr<CapillaryPhyIdeal> receiver = CreateObject<CapillaryPhyIdeal> ();
+          receiver->SetRate (phy->GetRate ());
+          receiver->SetDevice (device);
+          receiver->SetMobility (phy->GetMobility ());
+          receiver->SetAntenna (phy->GetRxAntenna ());
+          receiver->SetChannel (phy->GetChannel ());
+          receiver->SetTxPowerSpectralDensity (m_channels[c]);
+          receiver->SetNoisePowerSpectralDensity (m_noisePsd);
+          phy->GetChannel ()->AddRx (receiver);
+
+          mac->AddReceiver (receiver);
+        }
+
+      NS_LOG_DEBUG ("Coordinator " << device->GetAddress () << ": " << GetNChannels () << " channels");
+    }
+}
+
+} /* namespace ns3 */
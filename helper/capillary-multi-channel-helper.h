@@ -0,0 +1,76 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+#ifndef HELPER_CAPILLARY_MULTI_CHANNEL_HELPER_H_
+#define HELPER_CAPILLARY_MULTI_CHANNEL_HELPER_H_
+
+#include <ns3/net-device-container.h>
+#include <ns3/ptr.h>
+#include <ns3/spectrum-value.h>
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+
+/*
+ * Multi-channel frame slotted ALOHA.
+ *
+ * Applied to the devices installed by CapillaryNetDeviceHelper, it adds
+ * the channels 1..K-1 to their CapillaryPhyIdeal (the channel 0, set
+ * through CapillaryNetDeviceHelper::SetTxPowerSpectralDensity, carries
+ * the RFD and the FBP), sets the FsalohaMac Channels attribute and gives
+ * each coordinator one more receiver for each added channel.
+ *
+ * The channels should not overlap: a PHY synchronizes only on signals
+ * of its band.
+ */
+class CapillaryMultiChannelHelper
+{
+public:
+  CapillaryMultiChannelHelper ();
+  ~CapillaryMultiChannelHelper ();
+
+  /**
+   * @param txPsd the transmission PSD of the next channel
+   */
+  void AddChannel (Ptr<SpectrumValue> txPsd);
+
+  /**
+   * @param noisePsd the noise PSD of the coordinator receivers
+   */
+  void SetNoisePowerSpectralDensity (Ptr<SpectrumValue> noisePsd);
+
+  /**
+   * @return the number of channels, the channel 0 included
+   */
+  uint16_t GetNChannels (void) const;
+
+  /**
+   * @param devices the devices of the cell, the coordinator included
+   */
+  void Install (NetDeviceContainer devices) const;
+
+private:
+  std::vector<Ptr<SpectrumValue> > m_channels;
+  Ptr<SpectrumValue> m_noisePsd;
+};
+
+} /* namespace ns3 */
+
+#endif /* HELPER_CAPILLARY_MULTI_CHANNEL_HELPER_H_ */
@@ -0,0 +1,162 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include "capillary-simulation-telemetry.h"
+
+#include <ns3/assert.h>
+#include <ns3/global-value.h>
+#include <ns3/log.h>
+#include <ns3/simulator.h>
+#include <ns3/string.h>
+#include <fstream>
+#include <unistd.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("CapillarySimulationTelemetry");
+
+NS_OBJECT_ENSURE_REGISTERED (CapillarySimulationTelemetry);
+
+TypeId
+CapillarySimulationTelemetry::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CapillarySimulationTelemetry")
+    .SetParent<Object> ()
+    .AddConstructor<CapillarySimulationTelemetry> ()
+    .AddAttribute ("Interval",
+                   "The simulated time between two reports.",
+                   TimeValue (Seconds (60)),
+                   MakeTimeAccessor (&CapillarySimulationTelemetry::m_interval),
+                   MakeTimeChecker ())
+  ;
+  return tid;
+}
+
+CapillarySimulationTelemetry::CapillarySimulationTelemetry ()
+  : m_lastWall (0),
+  m_lastNow (Seconds (0)),
+  m_lastEvents (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+CapillarySimulationTelemetry::~CapillarySimulationTelemetry ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+CapillarySimulationTelemetry::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_reportEvent.Cancel ();
+  m_stream = 0;
+  m_profiler = 0;
+  Object::DoDispose ();
+}
+
+void
+CapillarySimulationTelemetry::EnableProfiling (void)
+{
+  GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::CapillaryProfilingSimulatorImpl"));
+}
+
+void
+CapillarySimulationTelemetry::Start (Ptr<OutputStreamWrapper> stream)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (stream);
+  NS_ASSERT (m_interval > Seconds (0));
+
+  m_stream = stream;
+  m_profiler = DynamicCast<CapillaryProfilingSimulatorImpl> (Simulator::GetImplementation ());
+
+  m_clock.Start ();
+  m_lastWall = 0;
+  m_lastNow = Simulator::Now ();
+  m_lastEvents = m_profiler ? m_profiler->GetExecutedEvents () : 0;
+
+  *m_stream->GetStream () << "# wall now simRate rssMB events eventsPerSec pending pendingMac pendingPhy pendingEnergy pendingOther" << std::endl;
+
+  // the event keeps the telemetry alive
+  m_reportEvent = Simulator::Schedule (m_interval, &CapillarySimulationTelemetry::Report, Ptr<CapillarySimulationTelemetry> (this));
+}
+
+void
+CapillarySimulationTelemetry::Stop (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_reportEvent.Cancel ();
+}
+
+void
+CapillarySimulationTelemetry::Report (void)
+{
+  int64_t wall = m_clock.End ();
+  double wallDelta = (wall - m_lastWall) / 1000.0;
+  Time now = Simulator::Now ();
+
+  std::ostream &os = *m_stream->GetStream ();
+
+  os << wall / 1000.0 << " "
+     << now.GetSeconds () << " "
+     << ((wallDelta > 0) ? (now - m_lastNow).GetSeconds () / wallDelta : 0) << " "
+     << GetResidentSetSize () / (1024.0 * 1024.0) << " ";
+
+  if (m_profiler)
+    {
+      uint64_t events = m_profiler->GetExecutedEvents ();
+      os << events << " "
+         << ((wallDelta > 0) ? (events - m_lastEvents) / wallDelta : 0) << " "
+         << m_profiler->GetPendingEvents () << " "
+         << m_profiler->GetPendingEvents (CapillaryProfilingSimulatorImpl::FSALOHA_MAC) << " "
+         << m_profiler->GetPendingEvents (CapillaryProfilingSimulatorImpl::PHY) << " "
+         << m_profiler->GetPendingEvents (CapillaryProfilingSimulatorImpl::ENERGY_SOURCE) << " "
+         << m_profiler->GetPendingEvents (CapillaryProfilingSimulatorImpl::OTHER);
+      m_lastEvents = events;
+    }
+  else
+    {
+      os << "- - - - - - -";
+    }
+  os << std::endl;
+
+  m_lastWall = wall;
+  m_lastNow = now;
+
+  m_reportEvent = Simulator::Schedule (m_interval, &CapillarySimulationTelemetry::Report, Ptr<CapillarySimulationTelemetry> (this));
+}
+
+uint64_t
+CapillarySimulationTelemetry::GetResidentSetSize (void)
+{
+  // second field of statm: resident pages
+  std::ifstream statm ("/proc/self/statm");
+  uint64_t size = 0;
+  uint64_t resident = 0;
+  if (!(statm >> size >> resident))
+    {
+      return 0;
+    }
+
+  return resident * sysconf (_SC_PAGESIZE);
+}
+
+} /* namespace ns3 */
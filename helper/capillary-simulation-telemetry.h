@@ -0,0 +1,97 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+#ifndef HELPER_CAPILLARY_SIMULATION_TELEMETRY_H_
+#define HELPER_CAPILLARY_SIMULATION_TELEMETRY_H_
+
+#include <ns3/capillary-profiling-simulator-impl.h>
+#include <ns3/event-id.h>
+#include <ns3/nstime.h>
+#include <ns3/object.h>
+#include <ns3/output-stream-wrapper.h>
+#include <ns3/ptr.h>
+#include <ns3/system-wall-clock-ms.h>
+#include <stdint.h>
+
+namespace ns3 {
+
+/*
+ * Simulation speed telemetry.
+ *
+ * Every Interval of simulated time a line is written with the elapsed
+ * wall time, the simulated seconds per wall second and the resident set
+ * size of the process:
+ *
+ *   <wall> <now> <simRate> <rssMB> <events> <eventsPerSec> <pending> <pendingMac> <pendingPhy> <pendingEnergy> <pendingOther>
+ *
+ * The event columns need the CapillaryProfilingSimulatorImpl (see
+ * EnableProfiling) and are "-" otherwise.
+ */
+class CapillarySimulationTelemetry : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  CapillarySimulationTelemetry ();
+  virtual ~CapillarySimulationTelemetry ();
+
+  /**
+   * Select the CapillaryProfilingSimulatorImpl; it must be called
+   * before the simulator is used.
+   */
+  static void EnableProfiling (void);
+
+  /**
+   * Start reporting.
+   *
+   * @param stream the output stream
+   */
+  void Start (Ptr<OutputStreamWrapper> stream);
+
+  /**
+   * Stop reporting, so that a simulation without a stop time can end.
+   */
+  void Stop (void);
+
+  /**
+   * @return the resident set size of the process in bytes, 0 if unknown
+   */
+  static uint64_t GetResidentSetSize (void);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  void Report (void);
+
+  Time m_interval;
+  Ptr<OutputStreamWrapper> m_stream;
+  Ptr<CapillaryProfilingSimulatorImpl> m_profiler;
+
+  SystemWallClockMs m_clock;
+  int64_t m_lastWall;
+  Time m_lastNow;
+  uint64_t m_lastEvents;
+
+  EventId m_reportEvent;
+};
+
+} /* namespace ns3 */
+
+#endif /* HELPER_CAPILLARY_SIMULATION_TELEMETRY_H_ */
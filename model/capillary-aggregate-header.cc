@@ -0,0 +1,113 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include "capillary-aggregate-header.h"
+
+#include <ns3/address-utils.h>
+#include <ns3/log.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("CapillaryAggregateHeader");
+
+NS_OBJECT_ENSURE_REGISTERED (CapillaryAggregateHeader);
+
+CapillaryAggregateHeader::CapillaryAggregateHeader ()
+  : m_timestamp (Seconds (0)),
+  m_length (0)
+{
+}
+
+CapillaryAggregateHeader::CapillaryAggregateHeader (Mac64Address source, Time timestamp, uint16_t length)
+  : m_source (source),
+  m_timestamp (timestamp),
+  m_length (length)
+{
+}
+
+CapillaryAggregateHeader::~CapillaryAggregateHeader ()
+{
+}
+
+TypeId
+CapillaryAggregateHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CapillaryAggregateHeader")
+    .SetParent<Header> ()
+    .SetGroupName ("m2m-capillary")
+    .AddConstructor<CapillaryAggregateHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+CapillaryAggregateHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+Mac64Address
+CapillaryAggregateHeader::GetSource (void) const
+{
+  return m_source;
+}
+
+Time
+CapillaryAggregateHeader::GetTimestamp (void) const
+{
+  return m_timestamp;
+}
+
+uint16_t
+CapillaryAggregateHeader::GetLength (void) const
+{
+  return m_length;
+}
+
+void
+CapillaryAggregateHeader::Print (std::ostream &os) const
+{
+  os << "source=" << m_source << " timestamp=" << m_timestamp.GetSeconds () << " length=" << m_length;
+}
+
+uint32_t
+CapillaryAggregateHeader::GetSerializedSize (void) const
+{
+  return 8 + 8 + 2;
+}
+
+void
+CapillaryAggregateHeader::Serialize (Buffer::Iterator start) const
+{
+  WriteTo (start, m_source);
+  start.WriteHtonU64 (m_timestamp.GetNanoSeconds ());
+  start.WriteHtonU16 (m_length);
+}
+
+uint32_t
+CapillaryAggregateHeader::Deserialize (Buffer::Iterator start)
+{
+  ReadFrom (start, m_source);
+  m_timestamp = NanoSeconds (start.ReadNtohU64 ());
+  m_length = start.ReadNtohU16 ();
+  return GetSerializedSize ();
+}
+
+} /* namespace ns3 */
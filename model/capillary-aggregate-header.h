@@ -0,0 +1,66 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+#ifndef MODEL_CAPILLARY_AGGREGATE_HEADER_H_
+#define MODEL_CAPILLARY_AGGREGATE_HEADER_H_
+
+#include <ns3/header.h>
+#include <ns3/mac64-address.h>
+#include <ns3/nstime.h>
+#include <stdint.h>
+#include <iostream>
+
+namespace ns3 {
+
+/*
+ * Header of a record of an aggregated relay frame.
+ *
+ * A relay frame is a sequence of records, each one made of this header
+ * and of the payload of a packet received in a lower cell: the header
+ * keeps the source of the packet, the time it was first received by a
+ * coordinator and the length of the payload.
+ */
+class CapillaryAggregateHeader : public Header
+{
+public:
+  CapillaryAggregateHeader ();
+  CapillaryAggregateHeader (Mac64Address source, Time timestamp, uint16_t length);
+  virtual ~CapillaryAggregateHeader ();
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  Mac64Address GetSource (void) const;
+  Time GetTimestamp (void) const;
+  uint16_t GetLength (void) const;
+
+  virtual void Print (std::ostream &os) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+
+private:
+  Mac64Address m_source;
+  Time m_timestamp;
+  uint16_t m_length;
+};
+
+} /* namespace ns3 */
+
+#endif /* MODEL_CAPILLARY_AGGREGATE_HEADER_H_ */
@@ -0,0 +1,188 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include "capillary-async-trace-writer.h"
+
+#include <ns3/assert.h>
+#include <ns3/callback.h>
+#include <ns3/log.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("CapillaryAsyncTraceWriter");
+
+/** How long the consumer sleeps on an empty ring (ns). */
+static const uint64_t CONSUMER_IDLE_WAIT = 1000000;
+/** How long the producer sleeps on a full ring (ns). */
+static const uint64_t PRODUCER_FULL_WAIT = 50000;
+/** The consumer releases ring space at least every BATCH records. */
+static const uint64_t BATCH = 1024;
+
+#define ATOMIC_LOAD(x) __atomic_load_n (&(x), __ATOMIC_ACQUIRE)
+#define ATOMIC_STORE(x, v) __atomic_store_n (&(x), (v), __ATOMIC_RELEASE)
+
+/*
+ * TimedWait returns at once while the condition is set, so it is reset
+ * before the predicate is checked again: a signal sent after the check
+ * sets it back and the wait does not miss it.
+ */
+
+CapillaryAsyncTraceWriter::CapillaryAsyncTraceWriter (Ptr<CapillaryTraceWriter> writer, uint32_t capacity)
+  : m_writer (writer),
+  m_head (0),
+  m_tail (0),
+  m_flushRequested (false),
+  m_stop (false),
+  m_stalls (0)
+{
+  NS_LOG_FUNCTION (this << capacity);
+  NS_ASSERT (m_writer);
+  NS_ASSERT (capacity > 1);
+
+  uint64_t size = 1;
+  while (size < capacity)
+    {
+      size <<= 1;
+    }
+
+  m_ring.resize (size);
+  m_mask = size - 1;
+
+  m_thread = Create<SystemThread> (MakeCallback (&CapillaryAsyncTraceWriter::Run, this));
+  m_thread->Start ();
+}
+
+CapillaryAsyncTraceWriter::~CapillaryAsyncTraceWriter ()
+{
+  NS_LOG_FUNCTION (this);
+
+  ATOMIC_STORE (m_stop, true);
+  m_dataReady.SetCondition (true);
+  m_dataReady.Signal ();
+  m_thread->Join ();
+
+  NS_LOG_INFO ("Producer stalls: " << m_stalls);
+}
+
+void
+CapillaryAsyncTraceWriter::Write (const CapillaryTraceRecord &record)
+{
+  while (m_head - ATOMIC_LOAD (m_tail) > m_mask)
+    {
+      // ring full: wake the consumer and wait for free space
+      m_stalls++;
+      m_spaceReady.SetCondition (false);
+      m_dataReady.SetCondition (true);
+      m_dataReady.Signal ();
+      if (m_head - ATOMIC_LOAD (m_tail) > m_mask)
+        {
+          m_spaceReady.TimedWait (PRODUCER_FULL_WAIT);
+        }
+    }
+
+  m_ring[m_head & m_mask] = record;
+  ATOMIC_STORE (m_head, m_head + 1);
+
+  if ((m_head & (m_mask >> 2)) == 0)
+    {
+      // a quarter of the ring has been filled since the last wake up
+      m_dataReady.SetCondition (true);
+      m_dataReady.Signal ();
+    }
+}
+
+void
+CapillaryAsyncTraceWriter::Flush (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  ATOMIC_STORE (m_flushRequested, true);
+  m_dataReady.SetCondition (true);
+  m_dataReady.Signal ();
+
+  while (ATOMIC_LOAD (m_flushRequested))
+    {
+      m_spaceReady.SetCondition (false);
+      if (ATOMIC_LOAD (m_flushRequested))
+        {
+          m_spaceReady.TimedWait (PRODUCER_FULL_WAIT);
+        }
+    }
+}
+
+uint64_t
+CapillaryAsyncTraceWriter::GetStalls (void) const
+{
+  return m_stalls;
+}
+
+void
+CapillaryAsyncTraceWriter::Run (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  for (;;)
+    {
+      uint64_t tail = m_tail;
+      uint64_t head = ATOMIC_LOAD (m_head);
+
+      if (head != tail)
+        {
+          if (head - tail > BATCH)
+            {
+              head = tail + BATCH;
+            }
+
+          for (; tail != head; tail++)
+            {
+              m_writer->Write (m_ring[tail & m_mask]);
+            }
+
+          ATOMIC_STORE (m_tail, tail);
+          m_spaceReady.SetCondition (true);
+          m_spaceReady.Signal ();
+          continue;
+        }
+
+      if (ATOMIC_LOAD (m_flushRequested))
+        {
+          m_writer->Flush ();
+          ATOMIC_STORE (m_flushRequested, false);
+          m_spaceReady.SetCondition (true);
+          m_spaceReady.Signal ();
+          continue;
+        }
+
+      if (ATOMIC_LOAD (m_stop))
+        {
+          break;
+        }
+
+      m_dataReady.SetCondition (false);
+      if (ATOMIC_LOAD (m_head) == m_tail && !ATOMIC_LOAD (m_flushRequested) && !ATOMIC_LOAD (m_stop))
+        {
+          m_dataReady.TimedWait (CONSUMER_IDLE_WAIT);
+        }
+    }
+
+  m_writer->Flush ();
+}
+
+} /* namespace ns3 */
@@ -0,0 +1,94 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+#ifndef MODEL_CAPILLARY_ASYNC_TRACE_WRITER_H_
+#define MODEL_CAPILLARY_ASYNC_TRACE_WRITER_H_
+
+#include <ns3/capillary-trace-writer.h>
+#include <ns3/ptr.h>
+#include <ns3/system-condition.h>
+#include <ns3/system-thread.h>
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+
+/*
+ * Asynchronous trace writer.
+ *
+ * The simulator thread pushes records into a single-producer /
+ * single-consumer ring; a background thread pops them and hands them to
+ * the wrapped writer, which does the encoding and the file I/O. When
+ * the ring is full the producer waits for the consumer: records are
+ * never dropped.
+ *
+ * The wrapped writer must not be used directly while the asynchronous
+ * writer is alive.
+ */
+class CapillaryAsyncTraceWriter : public CapillaryTraceWriter
+{
+public:
+  static const uint32_t DEFAULT_CAPACITY = 65536;
+
+  /**
+   * @param writer the writer used by the background thread
+   * @param capacity the ring size in records, rounded up to a power of two
+   */
+  CapillaryAsyncTraceWriter (Ptr<CapillaryTraceWriter> writer, uint32_t capacity = DEFAULT_CAPACITY);
+  virtual ~CapillaryAsyncTraceWriter ();
+
+  virtual void Write (const CapillaryTraceRecord &record);
+
+  /**
+   * Wait until every queued record has been handed to the wrapped
+   * writer, then flush it.
+   */
+  virtual void Flush (void);
+
+  /**
+   * @return the number of times the producer had to wait for free space
+   */
+  uint64_t GetStalls (void) const;
+
+private:
+  void Run (void);
+
+  Ptr<CapillaryTraceWriter> m_writer;
+  Ptr<SystemThread> m_thread;
+
+  std::vector<CapillaryTraceRecord> m_ring;
+  uint64_t m_mask;
+
+  /** written by the producer only */
+  uint64_t m_head;
+  /** written by the consumer only */
+  uint64_t m_tail;
+
+  bool m_flushRequested;
+  bool m_stop;
+
+  SystemCondition m_dataReady;
+  SystemCondition m_spaceReady;
+
+  uint64_t m_stalls;
+};
+
+} /* namespace ns3 */
+
+#endif /* MODEL_CAPILLARY_ASYNC_TRACE_WRITER_H_ */
@@ -0,0 +1,213 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include "capillary-compressed-stream.h"
+
+#include <ns3/assert.h>
+#include <ns3/log.h>
+#include <fstream>
+#include <vector>
+
+#ifdef ENABLE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("CapillaryCompressedStream");
+
+/*
+ * Block buffered streambuf feeding a gzip compressor.
+ */
+class CapillaryCompressedStreamBuf : public std::streambuf
+{
+public:
+  CapillaryCompressedStreamBuf (std::string fileName, uint32_t blockSize);
+  virtual ~CapillaryCompressedStreamBuf ();
+
+  void Close (void);
+
+protected:
+  virtual int_type overflow (int_type c);
+  virtual int sync (void);
+
+private:
+  bool WriteBlock (bool finish);
+
+  std::ofstream m_file;
+  std::vector<char> m_block;
+  bool m_closed;
+
+#ifdef ENABLE_ZLIB
+  z_stream m_zs;
+  std::vector<char> m_out;
+#endif
+};
+
+CapillaryCompressedStreamBuf::CapillaryCompressedStreamBuf (std::string fileName, uint32_t blockSize)
+  : m_block (blockSize),
+  m_closed (false)
+{
+  NS_LOG_FUNCTION (this << fileName << blockSize);
+  NS_ASSERT (blockSize > 0);
+
+  m_file.open (fileName.c_str (), std::ios::out | std::ios::binary | std::ios::trunc);
+  NS_ASSERT_MSG (m_file.is_open (), "CapillaryCompressedStream: unable to open " << fileName);
+
+#ifdef ENABLE_ZLIB
+  m_zs.zalloc = Z_NULL;
+  m_zs.zfree = Z_NULL;
+  m_zs.opaque = Z_NULL;
+  // 15 + 16: maximum window, gzip wrapper
+  int ret = deflateInit2 (&m_zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+  NS_ASSERT_MSG (ret == Z_OK, "CapillaryCompressedStream: deflateInit2 failed (" << ret << ")");
+  m_out.resize (deflateBound (&m_zs, blockSize));
+#endif
+
+  setp (&m_block[0], &m_block[0] + m_block.size ());
+}
+
+CapillaryCompressedStreamBuf::~CapillaryCompressedStreamBuf ()
+{
+  NS_LOG_FUNCTION (this);
+  Close ();
+}
+
+void
+CapillaryCompressedStreamBuf::Close (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  if (m_closed)
+    {
+      return;
+    }
+
+  WriteBlock (true);
+  m_closed = true;
+
+#ifdef ENABLE_ZLIB
+  deflateEnd (&m_zs);
+  std::vector<char> ().swap (m_out);
+#endif
+
+  m_file.close ();
+  std::vector<char> ().swap (m_block);
+  setp (0, 0);
+}
+
+CapillaryCompressedStreamBuf::int_type
+CapillaryCompressedStreamBuf::overflow (int_type c)
+{
+  if (m_closed || !WriteBlock (false))
+    {
+      return traits_type::eof ();
+    }
+
+  if (!traits_type::eq_int_type (c, traits_type::eof ()))
+    {
+      *pptr () = traits_type::to_char_type (c);
+      pbump (1);
+    }
+
+  return traits_type::not_eof (c);
+}
+
+int
+CapillaryCompressedStreamBuf::sync (void)
+{
+  // line flushes only reach the block buffer: blocks are compressed when full
+  return m_closed ? -1 : 0;
+}
+
+bool
+CapillaryCompressedStreamBuf::WriteBlock (bool finish)
+{
+  uint32_t length = pptr () - pbase ();
+
+#ifdef ENABLE_ZLIB
+  m_zs.next_in = reinterpret_cast<Bytef *> (pbase ());
+  m_zs.avail_in = length;
+
+  int ret;
+  do
+    {
+      m_zs.next_out = reinterpret_cast<Bytef *> (&m_out[0]);
+      m_zs.avail_out = m_out.size ();
+      ret = deflate (&m_zs, finish ? Z_FINISH : Z_NO_FLUSH);
+      if (ret == Z_STREAM_ERROR)
+        {
+          NS_LOG_ERROR ("CapillaryCompressedStream: deflate failed.");
+          return false;
+        }
+      m_file.write (&m_out[0], m_out.size () - m_zs.avail_out);
+    }
+  while (m_zs.avail_out == 0 || (finish && ret != Z_STREAM_END));
+#else
+  m_file.write (pbase (), length);
+#endif
+
+  setp (&m_block[0], &m_block[0] + m_block.size ());
+  return m_file.good ();
+}
+
+CapillaryCompressedStream::CapillaryCompressedStream (std::string fileName, uint32_t blockSize)
+{
+  NS_LOG_FUNCTION (this << fileName << blockSize);
+
+  m_buf = new CapillaryCompressedStreamBuf (fileName, blockSize);
+  m_os = new std::ostream (m_buf);
+  m_wrapper = Create<OutputStreamWrapper> (m_os);
+}
+
+CapillaryCompressedStream::~CapillaryCompressedStream ()
+{
+  NS_LOG_FUNCTION (this);
+
+  Close ();
+  m_wrapper = 0;
+  delete m_os;
+  delete m_buf;
+}
+
+Ptr<OutputStreamWrapper>
+CapillaryCompressedStream::GetStream (void) const
+{
+  return m_wrapper;
+}
+
+void
+CapillaryCompressedStream::Close (void)
+{
+  NS_LOG_FUNCTION (this);
+  static_cast<CapillaryCompressedStreamBuf *> (m_buf)->Close ();
+}
+
+bool
+CapillaryCompressedStream::IsCompressionEnabled (void)
+{
+#ifdef ENABLE_ZLIB
+  return true;
+#else
+  return false;
+#endif
+}
+
+} /* namespace ns3 */
@@ -0,0 +1,80 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+#ifndef MODEL_CAPILLARY_COMPRESSED_STREAM_H_
+#define MODEL_CAPILLARY_COMPRESSED_STREAM_H_
+
+#include <ns3/output-stream-wrapper.h>
+#include <ns3/ptr.h>
+#include <ns3/simple-ref-count.h>
+#include <stdint.h>
+#include <iostream>
+#include <string>
+
+namespace ns3 {
+
+/*
+ * Compressed output file stream.
+ *
+ * Text written to the stream is collected in a block buffer and handed
+ * to a gzip (zlib deflate) compressor only when the block is full, so
+ * per-line flushes (std::endl) do not reach the compressor. The result
+ * is a standard .gz file. When the module is built without zlib the
+ * blocks are written uncompressed.
+ *
+ * The stream is exposed as an OutputStreamWrapper, so it can be used by
+ * every ascii trace sink.
+ */
+class CapillaryCompressedStream : public SimpleRefCount<CapillaryCompressedStream>
+{
+public:
+  static const uint32_t DEFAULT_BLOCK_SIZE = 1 << 20;
+
+  /**
+   * @param fileName the output file name
+   * @param blockSize the size in bytes of the blocks handed to the compressor
+   */
+  CapillaryCompressedStream (std::string fileName, uint32_t blockSize = DEFAULT_BLOCK_SIZE);
+  virtual ~CapillaryCompressedStream ();
+
+  /**
+   * @return the wrapper to pass to the trace sinks
+   */
+  Ptr<OutputStreamWrapper> GetStream (void) const;
+
+  /**
+   * Compress the pending data and terminate the file. Anything written
+   * afterwards is discarded.
+   */
+  void Close (void);
+
+  /**
+   * @return true if the module was built with zlib
+   */
+  static bool IsCompressionEnabled (void);
+
+private:
+  std::streambuf *m_buf;
+  std::ostream *m_os;
+  Ptr<OutputStreamWrapper> m_wrapper;
+};
+
+} /* namespace ns3 */
+
+#endif /* MODEL_CAPILLARY_COMPRESSED_STREAM_H_ */
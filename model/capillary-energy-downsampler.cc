@@ -0,0 +1,114 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include "capillary-energy-downsampler.h"
+
+#include <ns3/assert.h>
+#include <ns3/log.h>
+#include <ns3/simulator.h>
+#include <algorithm>
+#include <cmath>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("CapillaryEnergyDownsampler");
+
+CapillaryEnergyDownsampler::CapillaryEnergyDownsampler (Ptr<OutputStreamWrapper> stream, CapillaryTraceContext context, Time interval, double threshold)
+  : m_stream (stream),
+  m_context (context),
+  m_interval (interval.GetTimeStep ()),
+  m_threshold (threshold),
+  m_bucket (-1),
+  m_count (0),
+  m_sum (0),
+  m_min (0),
+  m_max (0),
+  m_last (0),
+  m_emitted (false),
+  m_lastEmitted (0)
+{
+  NS_LOG_FUNCTION (this << interval << threshold);
+  NS_ASSERT (m_stream);
+  NS_ASSERT (m_interval > 0);
+}
+
+void
+CapillaryEnergyDownsampler::Add (double value)
+{
+  int64_t bucket = Simulator::Now ().GetTimeStep () / m_interval;
+
+  if (bucket != m_bucket || m_count == 0)
+    {
+      Emit ();
+      m_bucket = bucket;
+      m_count = 0;
+      m_sum = 0;
+      m_min = value;
+      m_max = value;
+    }
+
+  m_count++;
+  m_sum += value;
+  m_min = std::min (m_min, value);
+  m_max = std::max (m_max, value);
+  m_last = value;
+}
+
+void
+CapillaryEnergyDownsampler::Flush (void)
+{
+  NS_LOG_FUNCTION (this);
+  Emit ();
+  m_count = 0;
+  m_stream->GetStream ()->flush ();
+}
+
+void
+CapillaryEnergyDownsampler::Emit (void)
+{
+  if (m_count == 0)
+    {
+      return;
+    }
+
+  if (m_emitted
+      && std::fabs (m_max - m_lastEmitted) <= m_threshold
+      && std::fabs (m_min - m_lastEmitted) <= m_threshold)
+    {
+      return;
+    }
+
+  const char *event = (m_context.source == CapillaryTraceContext::REMAINING_ENERGY) ? "* " : "- ";
+
+  *m_stream->GetStream () << event << TimeStep (m_bucket * m_interval).GetSeconds () << " " << m_context
+                          << " " << m_last << " " << m_min << " " << m_max << " " << m_sum / m_count
+                          << " " << m_count << "\n";
+
+  m_emitted = true;
+  m_lastEmitted = m_last;
+}
+
+void
+CapillaryEnergyDownsampler::Sink (Ptr<CapillaryEnergyDownsampler> downsampler, double previous, double current)
+{
+  downsampler->Add (current);
+}
+
+} /* namespace ns3 */
@@ -0,0 +1,94 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+#ifndef MODEL_CAPILLARY_ENERGY_DOWNSAMPLER_H_
+#define MODEL_CAPILLARY_ENERGY_DOWNSAMPLER_H_
+
+#include <ns3/capillary-tracer.h>
+#include <ns3/nstime.h>
+#include <ns3/output-stream-wrapper.h>
+#include <ns3/ptr.h>
+#include <ns3/simple-ref-count.h>
+#include <stdint.h>
+
+namespace ns3 {
+
+/*
+ * Time-bucketed downsampler of an energy trace source.
+ *
+ * The samples of one node are folded into fixed time buckets; when a
+ * bucket is closed a single line is written with its start time and the
+ * last, minimum, maximum and mean value:
+ *
+ *   - <time> <context> <last> <min> <max> <mean> <samples>
+ *
+ * A bucket whose samples all lie within the threshold of the last
+ * written value is suppressed. The state is constant in size, so the
+ * output volume depends on the simulated time, not on the event count.
+ */
+class CapillaryEnergyDownsampler : public SimpleRefCount<CapillaryEnergyDownsampler>
+{
+public:
+  /**
+   * @param stream the output stream
+   * @param context the trace source
+   * @param interval the bucket width
+   * @param threshold the minimum change of value for a bucket to be written
+   */
+  CapillaryEnergyDownsampler (Ptr<OutputStreamWrapper> stream, CapillaryTraceContext context, Time interval, double threshold);
+
+  /**
+   * Add a sample taken now.
+   *
+   * @param value the sample
+   */
+  void Add (double value);
+
+  /**
+   * Write out the current bucket, if any.
+   */
+  void Flush (void);
+
+  /**
+   * Trace sink for the TotalEnergyConsumption and RemainingEnergy sources.
+   */
+  static void Sink (Ptr<CapillaryEnergyDownsampler> downsampler, double previous, double current);
+
+private:
+  void Emit (void);
+
+  Ptr<OutputStreamWrapper> m_stream;
+  CapillaryTraceContext m_context;
+  int64_t m_interval;
+  double m_threshold;
+
+  int64_t m_bucket;
+  uint32_t m_count;
+  double m_sum;
+  double m_min;
+  double m_max;
+  double m_last;
+
+  bool m_emitted;
+  double m_lastEmitted;
+};
+
+} /* namespace ns3 */
+
+#endif /* MODEL_CAPILLARY_ENERGY_DOWNSAMPLER_H_ */
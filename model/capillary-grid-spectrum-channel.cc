@@ -0,0 +1,314 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include "capillary-grid-spectrum-channel.h"
+
+#include <ns3/antenna-model.h>
+#include <ns3/assert.h>
+#include <ns3/double.h>
+#include <ns3/log.h>
+#include <ns3/node.h>
+#include <ns3/simulator.h>
+#include <cmath>
+#include <limits>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("CapillaryGridSpectrumChannel");
+
+NS_OBJECT_ENSURE_REGISTERED (CapillaryGridSpectrumChannel);
+
+TypeId
+CapillaryGridSpectrumChannel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CapillaryGridSpectrumChannel")
+    .SetParent<SpectrumChannel> ()
+    .AddConstructor<CapillaryGridSpectrumChannel> ()
+    .AddAttribute ("MaxDistance",
+                   "The distance (m) beyond which the receivers are skipped, 0 to visit all of them.",
+                   DoubleValue (0),
+                   MakeDoubleAccessor (&CapillaryGridSpectrumChannel::m_maxDistance),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("MaxLossDb",
+                   "The propagation loss (dB) beyond which the receivers are skipped.",
+                   DoubleValue (std::numeric_limits<double>::max ()),
+                   MakeDoubleAccessor (&CapillaryGridSpectrumChannel::m_maxLossDb),
+                   MakeDoubleChecker<double> ())
+  ;
+  return tid;
+}
+
+CapillaryGridSpectrumChannel::CapillaryGridSpectrumChannel ()
+  : m_maxDistance (0),
+  m_maxLossDb (std::numeric_limits<double>::max ()),
+  m_indexValid (false),
+  m_deliveries (0),
+  m_culled (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+CapillaryGridSpectrumChannel::~CapillaryGridSpectrumChannel ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+CapillaryGridSpectrumChannel::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_phyList.clear ();
+  m_grid.clear ();
+  m_unplaced.clear ();
+  m_tracked.clear ();
+  m_propagationLoss = 0;
+  m_spectrumPropagationLoss = 0;
+  m_propagationDelay = 0;
+  SpectrumChannel::DoDispose ();
+}
+
+void
+CapillaryGridSpectrumChannel::AddPropagationLossModel (Ptr<PropagationLossModel> loss)
+{
+  NS_LOG_FUNCTION (this << loss);
+  NS_ASSERT (m_propagationLoss == 0);
+  m_propagationLoss = loss;
+}
+
+void
+CapillaryGridSpectrumChannel::AddSpectrumPropagationLossModel (Ptr<SpectrumPropagationLossModel> loss)
+{
+  NS_LOG_FUNCTION (this << loss);
+  NS_ASSERT (m_spectrumPropagationLoss == 0);
+  m_spectrumPropagationLoss = loss;
+}
+
+void
+CapillaryGridSpectrumChannel::SetPropagationDelayModel (Ptr<PropagationDelayModel> delay)
+{
+  NS_LOG_FUNCTION (this << delay);
+  NS_ASSERT (m_propagationDelay == 0);
+  m_propagationDelay = delay;
+}
+
+void
+CapillaryGridSpectrumChannel::AddRx (Ptr<SpectrumPhy> phy)
+{
+  NS_LOG_FUNCTION (this << phy);
+  m_phyList.push_back (phy);
+  m_indexValid = false;
+}
+
+uint32_t
+CapillaryGridSpectrumChannel::GetNDevices (void) const
+{
+  return m_phyList.size ();
+}
+
+Ptr<NetDevice>
+CapillaryGridSpectrumChannel::GetDevice (uint32_t i) const
+{
+  NS_ASSERT (i < m_phyList.size ());
+  return m_phyList[i]->GetDevice ();
+}
+
+uint64_t
+CapillaryGridSpectrumChannel::GetDeliveries (void) const
+{
+  return m_deliveries;
+}
+
+uint64_t
+CapillaryGridSpectrumChannel::GetCulled (void) const
+{
+  return m_culled;
+}
+
+CapillaryGridSpectrumChannel::GridCell
+CapillaryGridSpectrumChannel::GetGridCell (const Vector &position) const
+{
+  return GridCell ((int32_t) std::floor (position.x / m_maxDistance),
+                   (int32_t) std::floor (position.y / m_maxDistance));
+}
+
+void
+CapillaryGridSpectrumChannel::CourseChanged (Ptr<const MobilityModel> model)
+{
+  m_indexValid = false;
+}
+
+void
+CapillaryGridSpectrumChannel::BuildIndex (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  m_grid.clear ();
+  m_unplaced.clear ();
+
+  for (uint32_t i = 0; i < m_phyList.size (); i++)
+    {
+      Ptr<MobilityModel> mobility = m_phyList[i]->GetMobility ();
+      if (!mobility)
+        {
+          m_unplaced.push_back (m_phyList[i]);
+          continue;
+        }
+
+      if (m_tracked.insert (mobility).second)
+        {
+          mobility->TraceConnectWithoutContext ("CourseChange", MakeCallback (&CapillaryGridSpectrumChannel::CourseChanged, this));
+        }
+
+      m_grid[GetGridCell (mobility->GetPosition ())].push_back (m_phyList[i]);
+    }
+
+  NS_LOG_DEBUG (m_phyList.size () << " receivers in " << m_grid.size () << " grid cells");
+
+  m_indexValid = true;
+}
+
+void
+CapillaryGridSpectrumChannel::StartTx (Ptr<SpectrumSignalParameters> txParams)
+{
+  NS_LOG_FUNCTION (this << txParams->psd << txParams->duration << txParams->txPhy);
+  NS_ASSERT_MSG (txParams->psd, "NULL txPsd");
+  NS_ASSERT_MSG (txParams->txPhy, "NULL txPhy");
+
+  Ptr<MobilityModel> senderMobility = txParams->txPhy->GetMobility ();
+
+  if (m_maxDistance <= 0 || !senderMobility)
+    {
+      for (uint32_t i = 0; i < m_phyList.size (); i++)
+        {
+          Deliver (txParams, m_phyList[i]);
+        }
+      return;
+    }
+
+  if (!m_indexValid)
+    {
+      BuildIndex ();
+    }
+
+  GridCell center = GetGridCell (senderMobility->GetPosition ());
+  for (int32_t dx = -1; dx <= 1; dx++)
+    {
+      for (int32_t dy = -1; dy <= 1; dy++)
+        {
+          std::map<GridCell, std::vector<Ptr<SpectrumPhy> > >::const_iterator it =
+            m_grid.find (GridCell (center.first + dx, center.second + dy));
+          if (it == m_grid.end ())
+            {
+              continue;
+            }
+
+          for (uint32_t i = 0; i < it->second.size (); i++)
+            {
+              Ptr<SpectrumPhy> rxPhy = it->second[i];
+              if (senderMobility->GetDistanceFrom (rxPhy->GetMobility ()) > m_maxDistance)
+                {
+                  m_culled++;
+                  continue;
+                }
+              Deliver (txParams, rxPhy);
+            }
+        }
+    }
+
+  for (uint32_t i = 0; i < m_unplaced.size (); i++)
+    {
+      Deliver (txParams, m_unplaced[i]);
+    }
+}
+
+void
+CapillaryGridSpectrumChannel::Deliver (Ptr<SpectrumSignalParameters> txParams, Ptr<SpectrumPhy> rxPhy)
+{
+  if (rxPhy == txParams->txPhy)
+    {
+      return;
+    }
+
+  Time delay = Seconds (0);
+
+  Ptr<MobilityModel> senderMobility = txParams->txPhy->GetMobility ();
+  Ptr<MobilityModel> receiverMobility = rxPhy->GetMobility ();
+  Ptr<SpectrumSignalParameters> rxParams = txParams->Copy ();
+
+  if (senderMobility && receiverMobility)
+    {
+      double pathLossDb = 0;
+      if (rxParams->txAntenna != 0)
+        {
+          Angles txAngles (receiverMobility->GetPosition (), senderMobility->GetPosition ());
+          pathLossDb -= rxParams->txAntenna->GetGainDb (txAngles);
+        }
+      Ptr<AntennaModel> rxAntenna = rxPhy->GetRxAntenna ();
+      if (rxAntenna != 0)
+        {
+          Angles rxAngles (senderMobility->GetPosition (), receiverMobility->GetPosition ());
+          pathLossDb -= rxAntenna->GetGainDb (rxAngles);
+        }
+      if (m_propagationLoss)
+        {
+          pathLossDb -= m_propagationLoss->CalcRxPower (0, senderMobility, receiverMobility);
+        }
+
+      if (pathLossDb > m_maxLossDb)
+        {
+          m_culled++;
+          return;
+        }
+
+      *(rxParams->psd) *= std::pow (10.0, -pathLossDb / 10.0);
+
+      if (m_spectrumPropagationLoss)
+        {
+          rxParams->psd = m_spectrumPropagationLoss->CalcRxPowerSpectralDensity (rxParams->psd, senderMobility, receiverMobility);
+        }
+
+      if (m_propagationDelay)
+        {
+          delay = m_propagationDelay->GetDelay (senderMobility, receiverMobility);
+        }
+    }
+
+  m_deliveries++;
+
+  Ptr<NetDevice> device = rxPhy->GetDevice ();
+  if (device)
+    {
+      Simulator::ScheduleWithContext (device->GetNode ()->GetId (), delay,
+                                      &CapillaryGridSpectrumChannel::StartRx, this, rxParams, rxPhy);
+    }
+  else
+    {
+      Simulator::Schedule (delay, &CapillaryGridSpectrumChannel::StartRx, this, rxParams, rxPhy);
+    }
+}
+
+void
+CapillaryGridSpectrumChannel::StartRx (Ptr<SpectrumSignalParameters> params, Ptr<SpectrumPhy> receiver)
+{
+  NS_LOG_FUNCTION (this << params);
+  receiver->StartRx (params);
+}
+
+} /* namespace ns3 */
@@ -0,0 +1,123 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+#ifndef MODEL_CAPILLARY_GRID_SPECTRUM_CHANNEL_H_
+#define MODEL_CAPILLARY_GRID_SPECTRUM_CHANNEL_H_
+
+#include <ns3/mobility-model.h>
+#include <ns3/net-device.h>
+#include <ns3/propagation-delay-model.h>
+#include <ns3/propagation-loss-model.h>
+#include <ns3/ptr.h>
+#include <ns3/spectrum-channel.h>
+#include <ns3/spectrum-phy.h>
+#include <ns3/spectrum-propagation-loss-model.h>
+#include <ns3/spectrum-signal-parameters.h>
+#include <stdint.h>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace ns3 {
+
+/*
+ * Range culled spectrum channel.
+ *
+ * Behaves like the SingleModelSpectrumChannel, but a signal is
+ * delivered only to the receivers within MaxDistance of the
+ * transmitter and, once the propagation loss is known, within MaxLossDb
+ * of it. The receivers are kept in a square grid index with cells of
+ * MaxDistance side, so a transmission only visits the 3x3 grid cells
+ * around the transmitter: its cost follows the local density instead
+ * of the number of receivers on the channel.
+ *
+ * The index is rebuilt lazily when a receiver is added or moves. A
+ * MaxDistance of 0 disables the index and every receiver is visited.
+ *
+ *   channelHelper.SetChannel ("ns3::CapillaryGridSpectrumChannel",
+ *                             "MaxDistance", DoubleValue (100));
+ */
+class CapillaryGridSpectrumChannel : public SpectrumChannel
+{
+public:
+  static TypeId GetTypeId (void);
+
+  CapillaryGridSpectrumChannel ();
+  virtual ~CapillaryGridSpectrumChannel ();
+
+  virtual void AddPropagationLossModel (Ptr<PropagationLossModel> loss);
+  virtual void AddSpectrumPropagationLossModel (Ptr<SpectrumPropagationLossModel> loss);
+  virtual void SetPropagationDelayModel (Ptr<PropagationDelayModel> delay);
+  virtual void StartTx (Ptr<SpectrumSignalParameters> params);
+  virtual void AddRx (Ptr<SpectrumPhy> phy);
+
+  virtual uint32_t GetNDevices (void) const;
+  virtual Ptr<NetDevice> GetDevice (uint32_t i) const;
+
+  /**
+   * @return the number of signals delivered to a receiver so far
+   */
+  uint64_t GetDeliveries (void) const;
+
+  /**
+   * @return the number of receivers skipped by the range checks so far
+   */
+  uint64_t GetCulled (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  typedef std::pair<int32_t, int32_t> GridCell;
+
+  GridCell GetGridCell (const Vector &position) const;
+  void BuildIndex (void);
+  void CourseChanged (Ptr<const MobilityModel> model);
+
+  void Deliver (Ptr<SpectrumSignalParameters> txParams, Ptr<SpectrumPhy> rxPhy);
+  void StartRx (Ptr<SpectrumSignalParameters> params, Ptr<SpectrumPhy> receiver);
+
+  double m_maxDistance;
+  double m_maxLossDb;
+
+  std::vector<Ptr<SpectrumPhy> > m_phyList;
+
+  /** The receivers of every grid cell */
+  std::map<GridCell, std::vector<Ptr<SpectrumPhy> > > m_grid;
+
+  /** The receivers without a position, always visited */
+  std::vector<Ptr<SpectrumPhy> > m_unplaced;
+
+  /** The mobility models whose course changes invalidate the index */
+  std::set<Ptr<MobilityModel> > m_tracked;
+
+  bool m_indexValid;
+
+  Ptr<PropagationLossModel> m_propagationLoss;
+  Ptr<SpectrumPropagationLossModel> m_spectrumPropagationLoss;
+  Ptr<PropagationDelayModel> m_propagationDelay;
+
+  uint64_t m_deliveries;
+  uint64_t m_culled;
+};
+
+} /* namespace ns3 */
+
+#endif /* MODEL_CAPILLARY_GRID_SPECTRUM_CHANNEL_H_ */
@@ -36,6 +36,7 @@
 #include <cmath>
 #include <iostream>
 #include "capillary-phy-ideal.h"
+#include "capillary-tracepoints.h"
 
 namespace ns3 {
 
@@ -48,6 +49,8 @@ CapillaryPhyIdeal::CapillaryPhyIdeal (void)
   m_netDevice (0),
   m_channel (0),
   m_txPsd (0),
+  m_currentChannel (0),
+  m_txBand (0),
   m_state (IDLE)
 {
   NS_LOG_FUNCTION (this);
@@ -127,6 +130,27 @@ Ptr<AntennaModel> CapillaryPhyIdeal::GetRxAntenna (void)
   return m_antenna;
 }
 
+/**
+ * @param psd a channel PSD
+ * @return the index of its band with the highest power
+ */
+static uint32_t
+GetPeakBand (Ptr<const SpectrumValue> psd)
+{
+  uint32_t peak = 0;
+  double peakValue = 0;
+  uint32_t i = 0;
+  for (std::vector<double>::const_iterator it = psd->ConstValuesBegin (); it != psd->ConstValuesEnd (); ++it, ++i)
+    {
+      if (*it > peakValue)
+        {
+          peak = i;
+          peakValue = *it;
+        }
+    }
+  return peak;
+}
+
 void CapillaryPhyIdeal::StartRx (Ptr<SpectrumSignalParameters> spectrumParams)
 {
   NS_LOG_FUNCTION (this << spectrumParams);
@@ -139,7 +163,11 @@ void CapillaryPhyIdeal::StartRx (Ptr<SpectrumSignalParameters> spectrumParams)
   // the device might start RX only if the signal is of a type understood by this device
   // this corresponds in real devices to preamble detection
   Ptr<HalfDuplexIdealPhySignalParameters> rxParams = DynamicCast<HalfDuplexIdealPhySignalParameters> (spectrumParams);
-  if (rxParams != 0)
+  if (rxParams != 0 && m_txPsd && rxParams->psd != m_txPsd && (*rxParams->psd)[m_txBand] <= 0)
+    {
+      NS_LOG_LOGIC (this << " signal out of the current channel");
+    }
+  else if (rxParams != 0)
     {
       // signal is of known type
       switch (m_state)
@@ -152,6 +180,7 @@ void CapillaryPhyIdeal::StartRx (Ptr<SpectrumSignalParameters> spectrumParams)
             m_phyRxStartTrace (p);
             m_rxPacket = p;
             m_rxPsd = rxParams->psd;
+            m_rxSignals.assign (1, p);
             ChangeState (CapillaryPhy::RX);
             if (!m_phyRxStartCallback.IsNull ())
               {
@@ -168,6 +197,7 @@ void CapillaryPhyIdeal::StartRx (Ptr<SpectrumSignalParameters> spectrumParams)
           }
           break;
         case CapillaryPhy::RX:
+          m_rxSignals.push_back (rxParams->data);
           m_endRxEventId.Cancel ();
           m_endRxEventId = Simulator::Schedule (rxParams->duration, &CapillaryPhyIdeal::AbortRx, this);
 
@@ -215,7 +245,23 @@ void CapillaryPhyIdeal::SetTxPowerSpectralDensity (Ptr<SpectrumValue> txPsd)
 {
   NS_LOG_FUNCTION (this << txPsd);
   NS_ASSERT (txPsd);
-  m_txPsd = txPsd;
+
+  if (m_channels.empty ())
+    {
+      m_channels.push_back (txPsd);
+      m_channelBands.push_back (GetPeakBand (txPsd));
+    }
+  else
+    {
+      m_channels[0] = txPsd;
+      m_channelBands[0] = GetPeakBand (txPsd);
+    }
+
+  if (m_currentChannel == 0)
+    {
+      m_txPsd = txPsd;
+      m_txBand = m_channelBands[0];
+    }
   NS_LOG_INFO ( *txPsd << *m_txPsd);
 }
 
@@ -258,6 +304,7 @@ bool CapillaryPhyIdeal::StartTx (Ptr<Packet> p)
       {
         m_txPacket = p;
         ChangeState (CapillaryPhy::TX);
+        CAPILLARY_TP_TX_START (m_netDevice->GetNode ()->GetId (), p->GetSize ());
 
         Ptr<SpectrumSignalParameters> txParams = TransmissionSignalParameters ();
         NS_LOG_LOGIC (this << " tx power: " << 10 * std::log10 (Integral (*(txParams->psd))) + 30 << " dBm");
@@ -294,6 +341,58 @@ Time CapillaryPhyIdeal::GetSwitchingTime (void) const
   return m_switch;
 }
 
+Ptr<SpectrumChannel> CapillaryPhyIdeal::GetChannel (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_channel;
+}
+
+uint16_t CapillaryPhyIdeal::AddChannel (Ptr<SpectrumValue> txPsd)
+{
+  NS_LOG_FUNCTION (this << txPsd);
+  NS_ASSERT (txPsd);
+  NS_ASSERT_MSG (!m_channels.empty (), "The PSD of channel 0 must be set first");
+
+  m_channels.push_back (txPsd);
+  m_channelBands.push_back (GetPeakBand (txPsd));
+  return m_channels.size () - 1;
+}
+
+void CapillaryPhyIdeal::SetCurrentChannel (uint16_t channel)
+{
+  NS_LOG_FUNCTION (this << channel);
+  NS_ASSERT (channel < m_channels.size ());
+
+  m_currentChannel = channel;
+  m_txPsd = m_channels[channel];
+  m_txBand = m_channelBands[channel];
+}
+
+uint16_t CapillaryPhyIdeal::GetCurrentChannel (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_currentChannel;
+}
+
+uint16_t CapillaryPhyIdeal::GetNChannels (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_channels.size ();
+}
+
+double CapillaryPhyIdeal::GetRxPower (void) const
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (m_rxPsd);
+  return 10 * std::log10 (Integral (*m_rxPsd)) + 30;
+}
+
+const std::vector<Ptr<const Packet> > &CapillaryPhyIdeal::GetRxSignals (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_rxSignals;
+}
+
 void CapillaryPhyIdeal::SetAntenna (Ptr<AntennaModel> a)
 {
   NS_LOG_FUNCTION (this << a);
@@ -307,6 +406,8 @@ void CapillaryPhyIdeal::DoDispose (void)
   m_netDevice = 0;
   m_channel = 0;
   m_txPsd = 0;
+  m_channels.clear ();
+  m_channelBands.clear ();
   m_rxPsd = 0;
   m_txPacket = 0;
   m_rxPacket = 0;
@@ -331,6 +432,8 @@ void CapillaryPhyIdeal::ChangeState (CapillaryPhy::State newState)
       m_state = newState;
     }
 
+  CAPILLARY_TP_PHY_STATE (m_netDevice->GetNode ()->GetId (), m_state);
+
   if (!m_energyCallback.IsNull ())
     {
       m_energyCallback (m_state);
@@ -346,6 +449,7 @@ void CapillaryPhyIdeal::EndTx (void)
 
   if (m_state == CapillaryPhy::TX)
     {
+      CAPILLARY_TP_TX_END (m_netDevice->GetNode ()->GetId (), m_txPacket->GetSize ());
 
       m_phyTxEndTrace (m_txPacket);
 
@@ -366,6 +470,7 @@ void CapillaryPhyIdeal::AbortRx (void)
 
   if (m_state == CapillaryPhy::RX)
     {
+      CAPILLARY_TP_RX_ERROR (m_netDevice->GetNode ()->GetId ());
       m_interference.AbortRx ();
       m_phyRxAbortTrace (m_rxPacket);
       m_endRxEventId.Cancel ();
@@ -382,6 +487,7 @@ void CapillaryPhyIdeal::AbortRx (void)
         {
           NS_LOG_LOGIC (this << " m_phyMacRxEndErrorCallback is NULL");
         }
+      m_rxSignals.clear ();
     }
 }
 
@@ -396,6 +502,7 @@ void CapillaryPhyIdeal::EndRx (void)
 
       if (rxOk)
         {
+          CAPILLARY_TP_RX_OK (m_netDevice->GetNode ()->GetId (), m_rxPacket->GetSize ());
           m_phyRxEndOkTrace (m_rxPacket);
           if (!m_phyRxEndOkCallback.IsNull ())
             {
@@ -409,6 +516,7 @@ void CapillaryPhyIdeal::EndRx (void)
         }
       else
         {
+          CAPILLARY_TP_RX_ERROR (m_netDevice->GetNode ()->GetId ());
           m_phyRxEndErrorTrace (m_rxPacket);
           if (!m_phyRxEndErrorCallback.IsNull ())
             {
@@ -424,6 +532,7 @@ void CapillaryPhyIdeal::EndRx (void)
       ChangeState (CapillaryPhy::IDLE);
       m_rxPacket = 0;
       m_rxPsd = 0;
+      m_rxSignals.clear ();
     }
 }
 
@@ -33,6 +33,7 @@
 #include <ns3/spectrum-model.h>
 #include <ns3/spectrum-signal-parameters.h>
 #include <ns3/spectrum-value.h>
+#include <vector>
 
 namespace ns3 {
 
@@ -94,6 +95,45 @@ public:
    */
   virtual Time GetSwitchingTime (void) const;
 
+  /**
+   * @return the spectrum channel the PHY is attached to
+   */
+  Ptr<SpectrumChannel> GetChannel (void) const;
+
+  /**
+   * Add a channel, i.e. the band described by the PSD used to transmit
+   * on it. Channel 0 is the one set by SetTxPowerSpectralDensity.
+   *
+   * @param txPsd the transmission PSD of the channel
+   * @return the index of the channel
+   */
+  uint16_t AddChannel (Ptr<SpectrumValue> txPsd);
+
+  /**
+   * Tune the PHY: it transmits on the channel and synchronizes only on
+   * signals overlapping its band; the others are just interference.
+   *
+   * @param channel the channel index
+   */
+  void SetCurrentChannel (uint16_t channel);
+  uint16_t GetCurrentChannel (void) const;
+  uint16_t GetNChannels (void) const;
+
+  /**
+   * @return the power, in dBm, of the signal being received; valid
+   *         from the start to the end of the reception callbacks
+   */
+  double GetRxPower (void) const;
+
+  /**
+   * The signals overlapping the reception, the synchronized one first:
+   * what a receiver buffers to cancel them later. Valid from the start
+   * to the end of the reception callbacks.
+   *
+   * @return the packets of the overlapping signals
+   */
+  const std::vector<Ptr<const Packet> > &GetRxSignals (void) const;
+
 
 private:
   virtual void DoDispose (void);
@@ -113,9 +153,16 @@ private:
   Ptr<SpectrumChannel> m_channel;
 
   Ptr<SpectrumValue> m_txPsd;
+  std::vector<Ptr<SpectrumValue> > m_channels;
+  uint16_t m_currentChannel;
+
+  /** The peak band of each channel, and of the current one */
+  std::vector<uint32_t> m_channelBands;
+  uint32_t m_txBand;
   Ptr<const SpectrumValue> m_rxPsd;
   Ptr<Packet> m_txPacket;
   Ptr<Packet> m_rxPacket;
+  std::vector<Ptr<const Packet> > m_rxSignals;
 
   DataRate m_rate;
 
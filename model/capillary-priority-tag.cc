@@ -0,0 +1,106 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include "capillary-priority-tag.h"
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (CapillaryPriorityTag);
+
+CapillaryPriorityTag::CapillaryPriorityTag ()
+  : m_priority (ROUTINE),
+  m_enqueueTime (Seconds (0))
+{
+}
+
+CapillaryPriorityTag::CapillaryPriorityTag (Priority priority)
+  : m_priority (priority),
+  m_enqueueTime (Seconds (0))
+{
+}
+
+TypeId
+CapillaryPriorityTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CapillaryPriorityTag")
+    .SetParent<Tag> ()
+    .SetGroupName ("m2m-capillary")
+    .AddConstructor<CapillaryPriorityTag> ()
+  ;
+  return tid;
+}
+
+TypeId
+CapillaryPriorityTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+void
+CapillaryPriorityTag::SetPriority (Priority priority)
+{
+  m_priority = priority;
+}
+
+CapillaryPriorityTag::Priority
+CapillaryPriorityTag::GetPriority (void) const
+{
+  return static_cast<Priority> (m_priority);
+}
+
+void
+CapillaryPriorityTag::SetEnqueueTime (Time enqueueTime)
+{
+  m_enqueueTime = enqueueTime;
+}
+
+Time
+CapillaryPriorityTag::GetEnqueueTime (void) const
+{
+  return m_enqueueTime;
+}
+
+uint32_t
+CapillaryPriorityTag::GetSerializedSize (void) const
+{
+  return 1 + 8;
+}
+
+void
+CapillaryPriorityTag::Serialize (TagBuffer i) const
+{
+  i.WriteU8 (m_priority);
+  i.WriteU64 (m_enqueueTime.GetTimeStep ());
+}
+
+void
+CapillaryPriorityTag::Deserialize (TagBuffer i)
+{
+  m_priority = i.ReadU8 ();
+  m_enqueueTime = TimeStep (i.ReadU64 ());
+}
+
+void
+CapillaryPriorityTag::Print (std::ostream &os) const
+{
+  os << "priority=" << (uint16_t) m_priority << " enqueued=" << m_enqueueTime;
+}
+
+} /* namespace ns3 */
@@ -0,0 +1,71 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+#ifndef MODEL_CAPILLARY_PRIORITY_TAG_H_
+#define MODEL_CAPILLARY_PRIORITY_TAG_H_
+
+#include <ns3/nstime.h>
+#include <ns3/tag.h>
+#include <stdint.h>
+#include <iostream>
+
+namespace ns3 {
+
+/*
+ * Traffic class of a DATA packet.
+ *
+ * An application marks an alarm with an ALARM tag before sending it; a
+ * packet without the tag is ROUTINE. The FsalohaMac queues the packet by
+ * class and stamps the tag with the queueing time, used for the access
+ * delay.
+ */
+class CapillaryPriorityTag : public Tag
+{
+public:
+  typedef enum
+  {
+    ROUTINE = 0,
+    ALARM = 1
+  } Priority;
+
+  CapillaryPriorityTag ();
+  CapillaryPriorityTag (Priority priority);
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  void SetPriority (Priority priority);
+  Priority GetPriority (void) const;
+
+  void SetEnqueueTime (Time enqueueTime);
+  Time GetEnqueueTime (void) const;
+
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  virtual void Print (std::ostream &os) const;
+
+private:
+  uint8_t m_priority;
+  Time m_enqueueTime;
+};
+
+} /* namespace ns3 */
+
+#endif /* MODEL_CAPILLARY_PRIORITY_TAG_H_ */
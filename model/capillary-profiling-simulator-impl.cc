@@ -0,0 +1,213 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include "capillary-profiling-simulator-impl.h"
+
+#include <ns3/log.h>
+#include <ns3/ptr.h>
+#include <cstring>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("CapillaryProfilingSimulatorImpl");
+
+NS_OBJECT_ENSURE_REGISTERED (CapillaryProfilingSimulatorImpl);
+
+/*
+ * Wrapper counting the execution of an event.
+ */
+class CapillaryProfilingSimulatorImpl::CountedEvent : public EventImpl
+{
+public:
+  CountedEvent (EventImpl *event, Handler handler, CapillaryProfilingSimulatorImpl *impl)
+    : m_event (event, false),
+    m_handler (handler),
+    m_impl (impl)
+  {
+  }
+
+  Handler GetHandler (void) const
+  {
+    return m_handler;
+  }
+
+protected:
+  virtual void Notify (void)
+  {
+    m_impl->m_executed[m_handler]++;
+    m_impl->m_pending[m_handler]--;
+    m_event->Invoke ();
+  }
+
+private:
+  Ptr<EventImpl> m_event;
+  Handler m_handler;
+  CapillaryProfilingSimulatorImpl *m_impl;
+};
+
+TypeId
+CapillaryProfilingSimulatorImpl::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CapillaryProfilingSimulatorImpl")
+    .SetParent<DefaultSimulatorImpl> ()
+    .AddConstructor<CapillaryProfilingSimulatorImpl> ()
+  ;
+  return tid;
+}
+
+CapillaryProfilingSimulatorImpl::CapillaryProfilingSimulatorImpl ()
+{
+  NS_LOG_FUNCTION (this);
+
+  for (uint32_t i = 0; i < N_HANDLERS; i++)
+    {
+      m_executed[i] = 0;
+      m_pending[i] = 0;
+    }
+}
+
+CapillaryProfilingSimulatorImpl::~CapillaryProfilingSimulatorImpl ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+CapillaryProfilingSimulatorImpl::Handler
+CapillaryProfilingSimulatorImpl::Classify (EventImpl *event)
+{
+  const std::type_info *type = &typeid (*event);
+
+  std::map<const std::type_info *, Handler>::const_iterator it = m_handlers.find (type);
+  if (it != m_handlers.end ())
+    {
+      return it->second;
+    }
+
+  // the event classes made by MakeEvent carry the handler class in their name
+  const char *name = type->name ();
+  Handler handler = OTHER;
+  if (std::strstr (name, "FsalohaMac") != 0)
+    {
+      handler = FSALOHA_MAC;
+    }
+  else if (std::strstr (name, "CapillaryPhy") != 0 || std::strstr (name, "SpectrumPhy") != 0)
+    {
+      handler = PHY;
+    }
+  else if (std::strstr (name, "EnergySource") != 0)
+    {
+      handler = ENERGY_SOURCE;
+    }
+
+  NS_LOG_DEBUG ("Event type " << name << " -> " << handler);
+
+  m_handlers[type] = handler;
+  return handler;
+}
+
+EventImpl *
+CapillaryProfilingSimulatorImpl::Wrap (EventImpl *event)
+{
+  Handler handler = Classify (event);
+  m_pending[handler]++;
+  return new CountedEvent (event, handler, this);
+}
+
+void
+CapillaryProfilingSimulatorImpl::NotifyGone (const EventId &id)
+{
+  if (IsExpired (id))
+    {
+      return;
+    }
+
+  CountedEvent *event = dynamic_cast<CountedEvent *> (id.PeekEventImpl ());
+  if (event != 0)
+    {
+      m_pending[event->GetHandler ()]--;
+    }
+}
+
+EventId
+CapillaryProfilingSimulatorImpl::Schedule (Time const &delay, EventImpl *event)
+{
+  return DefaultSimulatorImpl::Schedule (delay, Wrap (event));
+}
+
+void
+CapillaryProfilingSimulatorImpl::ScheduleWithContext (uint32_t context, Time const &delay, EventImpl *event)
+{
+  DefaultSimulatorImpl::ScheduleWithContext (context, delay, Wrap (event));
+}
+
+EventId
+CapillaryProfilingSimulatorImpl::ScheduleNow (EventImpl *event)
+{
+  return DefaultSimulatorImpl::ScheduleNow (Wrap (event));
+}
+
+void
+CapillaryProfilingSimulatorImpl::Remove (const EventId &id)
+{
+  NotifyGone (id);
+  DefaultSimulatorImpl::Remove (id);
+}
+
+void
+CapillaryProfilingSimulatorImpl::Cancel (const EventId &id)
+{
+  NotifyGone (id);
+  DefaultSimulatorImpl::Cancel (id);
+}
+
+uint64_t
+CapillaryProfilingSimulatorImpl::GetExecutedEvents (void) const
+{
+  uint64_t executed = 0;
+  for (uint32_t i = 0; i < N_HANDLERS; i++)
+    {
+      executed += m_executed[i];
+    }
+  return executed;
+}
+
+uint64_t
+CapillaryProfilingSimulatorImpl::GetPendingEvents (void) const
+{
+  uint64_t pending = 0;
+  for (uint32_t i = 0; i < N_HANDLERS; i++)
+    {
+      pending += m_pending[i];
+    }
+  return pending;
+}
+
+uint64_t
+CapillaryProfilingSimulatorImpl::GetPendingEvents (Handler handler) const
+{
+  return m_pending[handler];
+}
+
+uint64_t
+CapillaryProfilingSimulatorImpl::GetExecutedEvents (Handler handler) const
+{
+  return m_executed[handler];
+}
+
+} /* namespace ns3 */
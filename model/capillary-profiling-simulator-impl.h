@@ -0,0 +1,106 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+#ifndef MODEL_CAPILLARY_PROFILING_SIMULATOR_IMPL_H_
+#define MODEL_CAPILLARY_PROFILING_SIMULATOR_IMPL_H_
+
+#include <ns3/default-simulator-impl.h>
+#include <ns3/event-id.h>
+#include <ns3/event-impl.h>
+#include <ns3/nstime.h>
+#include <stdint.h>
+#include <map>
+#include <typeinfo>
+
+namespace ns3 {
+
+/*
+ * Event counting simulator implementation.
+ *
+ * Behaves like DefaultSimulatorImpl, but keeps the number of executed
+ * and pending events, split by the class handling them (FsalohaMac,
+ * the PHY, the energy source, anything else). Select it with
+ *
+ *   GlobalValue::Bind ("SimulatorImplementationType",
+ *                      StringValue ("ns3::CapillaryProfilingSimulatorImpl"));
+ *
+ * Each scheduled event is wrapped in a small counting event.
+ */
+class CapillaryProfilingSimulatorImpl : public DefaultSimulatorImpl
+{
+public:
+  typedef enum
+  {
+    FSALOHA_MAC = 0,
+    PHY = 1,
+    ENERGY_SOURCE = 2,
+    OTHER = 3,
+    N_HANDLERS = 4
+  } Handler;
+
+  static TypeId GetTypeId (void);
+
+  CapillaryProfilingSimulatorImpl ();
+  virtual ~CapillaryProfilingSimulatorImpl ();
+
+  virtual EventId Schedule (Time const &delay, EventImpl *event);
+  virtual void ScheduleWithContext (uint32_t context, Time const &delay, EventImpl *event);
+  virtual EventId ScheduleNow (EventImpl *event);
+  virtual void Remove (const EventId &id);
+  virtual void Cancel (const EventId &id);
+
+  /**
+   * @return the number of executed events
+   */
+  uint64_t GetExecutedEvents (void) const;
+
+  /**
+   * @return the number of scheduled events not yet executed or cancelled
+   */
+  uint64_t GetPendingEvents (void) const;
+
+  /**
+   * @param handler the handler class
+   * @return the number of pending events of the handler class
+   */
+  uint64_t GetPendingEvents (Handler handler) const;
+
+  /**
+   * @param handler the handler class
+   * @return the number of executed events of the handler class
+   */
+  uint64_t GetExecutedEvents (Handler handler) const;
+
+private:
+  class CountedEvent;
+
+  EventImpl *Wrap (EventImpl *event);
+  Handler Classify (EventImpl *event);
+  void NotifyGone (const EventId &id);
+
+  /** handler class of every event type seen so far */
+  std::map<const std::type_info *, Handler> m_handlers;
+
+  uint64_t m_executed[N_HANDLERS];
+  uint64_t m_pending[N_HANDLERS];
+};
+
+} /* namespace ns3 */
+
+#endif /* MODEL_CAPILLARY_PROFILING_SIMULATOR_IMPL_H_ */
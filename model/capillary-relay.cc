@@ -0,0 +1,228 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include "capillary-relay.h"
+
+#include <ns3/assert.h>
+#include <ns3/callback.h>
+#include <ns3/capillary-aggregate-header.h>
+#include <ns3/log.h>
+#include <ns3/simulator.h>
+#include <ns3/trace-source-accessor.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("CapillaryRelay");
+
+NS_OBJECT_ENSURE_REGISTERED (CapillaryRelay);
+
+TypeId
+CapillaryRelay::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CapillaryRelay")
+    .SetParent<Object> ()
+    .SetGroupName ("m2m-capillary")
+    .AddConstructor<CapillaryRelay> ()
+    .AddTraceSource ("Rx",
+                     "A packet reached the sink",
+                     MakeTraceSourceAccessor (&CapillaryRelay::m_rxTrace),
+                     "ns3::CapillaryRelay::RxTracedCallback")
+    .AddTraceSource ("Aggregate",
+                     "An aggregated frame was queued on the upper device",
+                     MakeTraceSourceAccessor (&CapillaryRelay::m_aggregateTrace),
+                     "ns3::CapillaryRelay::AggregateTracedCallback")
+    .AddTraceSource ("Drop",
+                     "A payload too large for the upper MTU, or a frame refused by the upper device",
+                     MakeTraceSourceAccessor (&CapillaryRelay::m_dropTrace),
+                     "ns3::Packet::TracedCallback")
+  ;
+  return tid;
+}
+
+CapillaryRelay::CapillaryRelay ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+CapillaryRelay::~CapillaryRelay ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+CapillaryRelay::Install (Ptr<CapillaryNetDevice> lower, Ptr<CapillaryNetDevice> upper)
+{
+  NS_LOG_FUNCTION (this << lower << upper);
+  NS_ASSERT (lower && lower->GetType () == CapillaryNetDevice::COORDINATOR);
+  NS_ASSERT (!upper || upper->GetType () == CapillaryNetDevice::END_DEVICE);
+
+  m_lower = lower;
+  m_upper = upper;
+
+  // chain the forwarding callback already set by the device
+  Ptr<CapillaryMac> mac = m_lower->GetMac ();
+  CallbackValue fwdUp;
+  mac->GetAttribute ("ForwardUpCallback", fwdUp);
+  fwdUp.GetAccessor (m_lowerFwdUp);
+
+  mac->SetAttribute ("ForwardUpCallback", CallbackValue (MakeCallback (&CapillaryRelay::ForwardUp, this)));
+  mac->TraceConnectWithoutContext ("DcrStatus", MakeCallback (&CapillaryRelay::DcrStatusChanged, this));
+}
+
+uint32_t
+CapillaryRelay::GetPendingRecords (void) const
+{
+  return m_pending.size ();
+}
+
+void
+CapillaryRelay::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_lower = 0;
+  m_upper = 0;
+  m_lowerFwdUp.Nullify ();
+  m_pending.clear ();
+  Object::DoDispose ();
+}
+
+void
+CapillaryRelay::ForwardUp (Ptr<Packet> p, LlcSnapHeader &llc, Mac64Address src, Mac64Address dst)
+{
+  NS_LOG_FUNCTION (this << p << src << dst);
+
+  if (llc.GetType () != PROT_NUMBER)
+    {
+      Deliver (p->Copy (), src, Simulator::Now ());
+
+      if (!m_lowerFwdUp.IsNull ())
+        {
+          m_lowerFwdUp (p, llc, src, dst);
+        }
+      return;
+    }
+
+  // records of a lower relay
+  Ptr<Packet> frame = p->Copy ();
+  CapillaryAggregateHeader header;
+  while (frame->GetSize () >= header.GetSerializedSize ())
+    {
+      frame->RemoveHeader (header);
+      NS_ASSERT (header.GetLength () <= frame->GetSize ());
+
+      Deliver (frame->CreateFragment (0, header.GetLength ()), header.GetSource (), header.GetTimestamp ());
+      frame->RemoveAtStart (header.GetLength ());
+    }
+}
+
+void
+CapillaryRelay::DcrStatusChanged (CapillaryMac::DcrStatus previous, CapillaryMac::DcrStatus current)
+{
+  NS_LOG_FUNCTION (this << previous << current);
+
+  if (m_upper && (current == CapillaryMac::ACTIVE_STOP || current == CapillaryMac::ACTIVE_ABORT))
+    {
+      Flush ();
+    }
+}
+
+void
+CapillaryRelay::Deliver (Ptr<Packet> payload, Mac64Address source, Time timestamp)
+{
+  NS_LOG_FUNCTION (this << payload << source << timestamp);
+
+  if (!m_upper)
+    {
+      m_rxTrace (payload, source, Simulator::Now () - timestamp);
+      return;
+    }
+
+  Record record;
+  record.payload = payload;
+  record.source = source;
+  record.timestamp = timestamp;
+  m_pending.push_back (record);
+}
+
+void
+CapillaryRelay::Flush (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  if (Mac64Address::ConvertFrom (m_upper->GetMac ()->GetCoordinator ()) == Mac64Address ("00:00:00:00:00:00:00:00"))
+    {
+      // no RFD of the upper cell heard yet: kept for the next DCR
+      NS_LOG_DEBUG ("Upper coordinator unknown, holding " << m_pending.size () << " records");
+      return;
+    }
+
+  uint16_t mtu = m_upper->GetMac ()->GetMtu ();
+
+  Ptr<Packet> frame = Create<Packet> ();
+  uint32_t records = 0;
+
+  for (uint32_t i = 0; i < m_pending.size (); i++)
+    {
+      Ptr<Packet> record = m_pending[i].payload->Copy ();
+      uint32_t length = record->GetSize ();
+      record->AddHeader (CapillaryAggregateHeader (m_pending[i].source, m_pending[i].timestamp, length));
+
+      if (record->GetSize () > mtu)
+        {
+          NS_LOG_WARN ("Payload larger than the upper MTU, dropped");
+          m_dropTrace (m_pending[i].payload);
+          continue;
+        }
+
+      if (frame->GetSize () + record->GetSize () > mtu)
+        {
+          SendFrame (frame, records);
+          frame = Create<Packet> ();
+          records = 0;
+        }
+
+      frame->AddAtEnd (record);
+      records++;
+    }
+
+  if (records > 0)
+    {
+      SendFrame (frame, records);
+    }
+
+  m_pending.clear ();
+}
+
+void
+CapillaryRelay::SendFrame (Ptr<Packet> frame, uint32_t records)
+{
+  NS_LOG_FUNCTION (this << frame << records);
+
+  NS_LOG_DEBUG ("Relaying " << records << " records, " << frame->GetSize () << " bytes");
+
+  m_aggregateTrace (frame, records);
+
+  if (!m_upper->Send (frame, m_upper->GetMac ()->GetCoordinator (), PROT_NUMBER))
+    {
+      m_dropTrace (frame);
+    }
+}
+
+} /* namespace ns3 */
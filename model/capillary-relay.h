@@ -0,0 +1,126 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+#ifndef MODEL_CAPILLARY_RELAY_H_
+#define MODEL_CAPILLARY_RELAY_H_
+
+#include <ns3/capillary-mac.h>
+#include <ns3/capillary-net-device.h>
+#include <ns3/llc-snap-header.h>
+#include <ns3/mac64-address.h>
+#include <ns3/nstime.h>
+#include <ns3/object.h>
+#include <ns3/packet.h>
+#include <ns3/ptr.h>
+#include <ns3/traced-callback.h>
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+
+/*
+ * Cluster-tree relay.
+ *
+ * The relay joins the coordinator of a lower cell with an end device,
+ * on the same node, of an upper-tier cell. The DATA received by the
+ * coordinator during a DCR are kept and, when the DCR ends, aggregated
+ * into as few upper-tier frames as the upper MTU allows; the end device
+ * sends them to its coordinator during the next upper DCR. Until the
+ * end device hears the first RFD of its coordinator the records are
+ * kept for the end of the next DCR.
+ *
+ * A relay with no upper device is the sink: it takes the records apart
+ * and fires the Rx trace with the delay from the first coordinator.
+ * Aggregated frames reaching an intermediate relay are flattened, so
+ * the records keep their source and timestamp across the tiers.
+ */
+class CapillaryRelay : public Object
+{
+public:
+  /** The LLC type of the aggregated frames */
+  static const uint16_t PROT_NUMBER = 0x88b5;
+
+  /**
+   * TracedCallback signature for the packets reaching the sink.
+   *
+   * @param packet the payload
+   * @param source the end device originating the packet
+   * @param delay the time since the packet was received by the first coordinator
+   */
+  typedef void (* RxTracedCallback)(Ptr<const Packet> packet, Mac64Address source, Time delay);
+
+  /**
+   * TracedCallback signature for the aggregated frames.
+   *
+   * @param packet the frame
+   * @param records the number of records in the frame
+   */
+  typedef void (* AggregateTracedCallback)(Ptr<const Packet> packet, uint32_t records);
+
+  static TypeId GetTypeId (void);
+
+  CapillaryRelay ();
+  virtual ~CapillaryRelay ();
+
+  /**
+   * @param lower the coordinator of the lower cell
+   * @param upper the end device of the upper-tier cell, 0 for the sink
+   */
+  void Install (Ptr<CapillaryNetDevice> lower, Ptr<CapillaryNetDevice> upper);
+
+  /**
+   * @return the number of records waiting for the end of the DCR, or
+   *         for the first RFD of the upper cell
+   */
+  uint32_t GetPendingRecords (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  struct Record
+  {
+    Ptr<Packet> payload;
+    Mac64Address source;
+    Time timestamp;
+  };
+
+  void ForwardUp (Ptr<Packet> p, LlcSnapHeader &llc, Mac64Address src, Mac64Address dst);
+  void DcrStatusChanged (CapillaryMac::DcrStatus previous, CapillaryMac::DcrStatus current);
+
+  void Deliver (Ptr<Packet> payload, Mac64Address source, Time timestamp);
+  void Flush (void);
+  void SendFrame (Ptr<Packet> frame, uint32_t records);
+
+  Ptr<CapillaryNetDevice> m_lower;
+  Ptr<CapillaryNetDevice> m_upper;
+
+  /** The forwarding callback of the lower MAC before the relay */
+  CapillaryMac::ForwardUpCallback m_lowerFwdUp;
+
+  std::vector<Record> m_pending;
+
+  TracedCallback<Ptr<const Packet>, Mac64Address, Time> m_rxTrace;
+  TracedCallback<Ptr<const Packet>, uint32_t> m_aggregateTrace;
+  TracedCallback<Ptr<const Packet> > m_dropTrace;
+};
+
+} /* namespace ns3 */
+
+#endif /* MODEL_CAPILLARY_RELAY_H_ */
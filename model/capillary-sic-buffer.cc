@@ -0,0 +1,101 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include "capillary-sic-buffer.h"
+
+#include <ns3/log.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("CapillarySicBuffer");
+
+CapillarySicBuffer::CapillarySicBuffer ()
+{
+}
+
+void
+CapillarySicBuffer::Clear (void)
+{
+  m_slots.clear ();
+}
+
+void
+CapillarySicBuffer::AddCollision (uint32_t slot, const std::vector<Ptr<const Packet> > &signals)
+{
+  NS_LOG_FUNCTION (this << slot << signals.size ());
+
+  std::vector<Ptr<const Packet> > &buffered = m_slots[slot];
+  buffered.insert (buffered.end (), signals.begin (), signals.end ());
+}
+
+Ptr<const Packet>
+CapillarySicBuffer::Cancel (uint32_t slot, uint64_t uid)
+{
+  NS_LOG_FUNCTION (this << slot << uid);
+
+  std::map<uint32_t, std::vector<Ptr<const Packet> > >::iterator it = m_slots.find (slot);
+  if (it == m_slots.end ())
+    {
+      return 0;
+    }
+
+  std::vector<Ptr<const Packet> > &signals = it->second;
+  bool cancelled = false;
+  for (std::vector<Ptr<const Packet> >::iterator s = signals.begin (); s != signals.end (); s++)
+    {
+      if ((*s)->GetUid () == uid)
+        {
+          signals.erase (s);
+          cancelled = true;
+          break;
+        }
+    }
+
+  // a signal alone from the start was lost to the noise
+  if (!cancelled || signals.size () != 1)
+    {
+      return 0;
+    }
+
+  Ptr<const Packet> residual = signals.front ();
+  signals.clear ();
+  NS_LOG_DEBUG ("Slot " << slot << ": decoded " << residual->GetUid ());
+  return residual;
+}
+
+bool
+CapillarySicBuffer::IsResolved (uint32_t slot) const
+{
+  std::map<uint32_t, std::vector<Ptr<const Packet> > >::const_iterator it = m_slots.find (slot);
+  return it == m_slots.end () || it->second.empty ();
+}
+
+uint32_t
+CapillarySicBuffer::GetNSignals (void) const
+{
+  uint32_t n = 0;
+  for (std::map<uint32_t, std::vector<Ptr<const Packet> > >::const_iterator it = m_slots.begin (); it != m_slots.end (); it++)
+    {
+      n += it->second.size ();
+    }
+  return n;
+}
+
+} /* namespace ns3 */
@@ -0,0 +1,82 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+#ifndef MODEL_CAPILLARY_SIC_BUFFER_H_
+#define MODEL_CAPILLARY_SIC_BUFFER_H_
+
+#include <ns3/packet.h>
+#include <ns3/ptr.h>
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+namespace ns3 {
+
+/*
+ * The collided slots of a frame, kept for successive interference
+ * cancellation.
+ *
+ * A collided slot is stored as the set of the overlapping signals
+ * reported by the PHY (CapillaryPhyIdeal::GetRxSignals), each one
+ * identified by the uid of its packet. Cancelling a signal decoded in
+ * another slot removes it from the slot; the last signal left is then
+ * clean and decoded. The cancellation is ideal: no residual
+ * interference is left behind.
+ */
+class CapillarySicBuffer
+{
+public:
+  CapillarySicBuffer ();
+
+  void Clear (void);
+
+  /**
+   * @param slot the channel * nSlots + slot index
+   * @param signals the overlapping signals
+   */
+  void AddCollision (uint32_t slot, const std::vector<Ptr<const Packet> > &signals);
+
+  /**
+   * Cancel a decoded signal from a slot.
+   *
+   * @param slot the channel * nSlots + slot index
+   * @param uid the uid of the decoded packet
+   * @return the signal left alone in the slot by the cancellation, now
+   *         decoded; 0 otherwise
+   */
+  Ptr<const Packet> Cancel (uint32_t slot, uint64_t uid);
+
+  /**
+   * @param slot the channel * nSlots + slot index
+   * @return true if no signal of the slot is left undecoded
+   */
+  bool IsResolved (uint32_t slot) const;
+
+  /**
+   * @return the number of signals still undecoded
+   */
+  uint32_t GetNSignals (void) const;
+
+private:
+  std::map<uint32_t, std::vector<Ptr<const Packet> > > m_slots;
+};
+
+} /* namespace ns3 */
+
+#endif /* MODEL_CAPILLARY_SIC_BUFFER_H_ */
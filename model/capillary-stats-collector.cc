@@ -0,0 +1,358 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include "capillary-stats-collector.h"
+
+#include <ns3/assert.h>
+#include <ns3/double.h>
+#include <ns3/log.h>
+#include <ns3/node.h>
+#include <ns3/simulator.h>
+#include <ns3/uinteger.h>
+#include <cmath>
+#include <limits>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("CapillaryStatsCollector");
+
+NS_OBJECT_ENSURE_REGISTERED (CapillaryStatsCollector);
+
+CapillaryRunningStats::CapillaryRunningStats ()
+  : m_count (0),
+  m_mean (0),
+  m_m2 (0),
+  m_min (std::numeric_limits<double>::max ()),
+  m_max (-std::numeric_limits<double>::max ())
+{
+}
+
+void
+CapillaryRunningStats::Add (double x)
+{
+  m_count++;
+  double delta = x - m_mean;
+  m_mean += delta / m_count;
+  m_m2 += delta * (x - m_mean);
+
+  m_min = std::min (m_min, x);
+  m_max = std::max (m_max, x);
+}
+
+uint64_t
+CapillaryRunningStats::GetCount (void) const
+{
+  return m_count;
+}
+
+double
+CapillaryRunningStats::GetMean (void) const
+{
+  return m_mean;
+}
+
+double
+CapillaryRunningStats::GetVariance (void) const
+{
+  return (m_count > 1) ? m_m2 / (m_count - 1) : 0;
+}
+
+double
+CapillaryRunningStats::GetMin (void) const
+{
+  return (m_count > 0) ? m_min : 0;
+}
+
+double
+CapillaryRunningStats::GetMax (void) const
+{
+  return (m_count > 0) ? m_max : 0;
+}
+
+CapillaryQuantileSketch::CapillaryQuantileSketch (double min, double max, uint16_t buckets)
+  : m_min (min),
+  m_count (0),
+  m_buckets (buckets, 0)
+{
+  NS_ASSERT (min > 0 && max > min && buckets > 0);
+
+  m_logMin = std::log (min);
+  m_logWidth = (std::log (max) - m_logMin) / buckets;
+}
+
+void
+CapillaryQuantileSketch::Add (double x)
+{
+  int32_t i = 0;
+  if (x > m_min)
+    {
+      i = (int32_t)((std::log (x) - m_logMin) / m_logWidth);
+      i = std::min<int32_t> (i, m_buckets.size () - 1);
+    }
+
+  m_buckets[i]++;
+  m_count++;
+}
+
+double
+CapillaryQuantileSketch::GetQuantile (double q) const
+{
+  if (m_count == 0)
+    {
+      return 0;
+    }
+
+  uint64_t rank = (uint64_t)std::ceil (q * m_count);
+  rank = std::max<uint64_t> (rank, 1);
+
+  uint64_t cumulated = 0;
+  size_t i = 0;
+  for (; i < m_buckets.size (); i++)
+    {
+      cumulated += m_buckets[i];
+      if (cumulated >= rank)
+        {
+          break;
+        }
+    }
+
+  // geometric centre of the bucket
+  return std::exp (m_logMin + (i + 0.5) * m_logWidth);
+}
+
+uint64_t
+CapillaryQuantileSketch::GetCount (void) const
+{
+  return m_count;
+}
+
+CapillaryStatsCollector::NodeStats::NodeStats (uint32_t node, bool coordinator, double sketchMin, double sketchMax, uint16_t sketchBuckets)
+  : m_node (node),
+  m_coordinator (coordinator),
+  m_dcrStart (Seconds (0)),
+  m_frames (0),
+  m_dcrAborted (0),
+  m_dcrDurationSketch (sketchMin, sketchMax, sketchBuckets)
+{
+  m_outcomes[FsalohaMac::EMPTY] = 0;
+  m_outcomes[FsalohaMac::OK] = 0;
+  m_outcomes[FsalohaMac::ERROR] = 0;
+}
+
+TypeId
+CapillaryStatsCollector::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CapillaryStatsCollector")
+    .SetParent<Object> ()
+    .AddConstructor<CapillaryStatsCollector> ()
+    .AddAttribute ("SketchMin",
+                   "The smallest DCR duration (s) resolved by the quantile sketch.",
+                   DoubleValue (1e-3),
+                   MakeDoubleAccessor (&CapillaryStatsCollector::m_sketchMin),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("SketchMax",
+                   "The largest DCR duration (s) resolved by the quantile sketch.",
+                   DoubleValue (1e4),
+                   MakeDoubleAccessor (&CapillaryStatsCollector::m_sketchMax),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("SketchBuckets",
+                   "The number of buckets of the quantile sketch.",
+                   UintegerValue (256),
+                   MakeUintegerAccessor (&CapillaryStatsCollector::m_sketchBuckets),
+                   MakeUintegerChecker<uint16_t> (1))
+  ;
+  return tid;
+}
+
+CapillaryStatsCollector::CapillaryStatsCollector ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+CapillaryStatsCollector::~CapillaryStatsCollector ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+CapillaryStatsCollector::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_dumpEvent.Cancel ();
+  m_nodes.clear ();
+  Object::DoDispose ();
+}
+
+void
+CapillaryStatsCollector::Install (NetDeviceContainer devices)
+{
+  NS_LOG_FUNCTION (this);
+
+  for (NetDeviceContainer::Iterator i = devices.Begin (); i != devices.End (); ++i)
+    {
+      Ptr<CapillaryNetDevice> device = DynamicCast<CapillaryNetDevice> (*i);
+      NS_ASSERT_MSG (device, "CapillaryStatsCollector::Install(): Device " << *i << " not of type ns3::CapillaryNetDevice");
+
+      Ptr<NodeStats> stats = Create<NodeStats> (device->GetNode ()->GetId (),
+                                                device->GetType () == CapillaryNetDevice::COORDINATOR,
+                                                m_sketchMin, m_sketchMax, m_sketchBuckets);
+      m_nodes.push_back (stats);
+
+      device->GetMac ()->TraceConnectWithoutContext ("DcrStatus", MakeBoundCallback (&CapillaryStatsCollector::DcrStatusSink, stats));
+
+      Ptr<FsalohaMac> mac = DynamicCast<FsalohaMac> (device->GetMac ());
+      if (mac)
+        {
+          mac->TraceConnectWithoutContext ("Frames", MakeBoundCallback (&CapillaryStatsCollector::FramesSink, stats));
+          mac->TraceConnectWithoutContext ("SlotStatus", MakeBoundCallback (&CapillaryStatsCollector::SlotStatusSink, stats));
+          mac->TraceConnectWithoutContext ("TxOutcome", MakeBoundCallback (&CapillaryStatsCollector::TxOutcomeSink, stats));
+        }
+    }
+}
+
+void
+CapillaryStatsCollector::EnableSummary (Ptr<OutputStreamWrapper> stream, Time interval)
+{
+  NS_LOG_FUNCTION (this << interval);
+  NS_ASSERT (stream);
+
+  if (interval > Seconds (0))
+    {
+      m_dumpEvent = Simulator::Schedule (interval, &CapillaryStatsCollector::PeriodicDump, this, stream, interval);
+    }
+
+  Simulator::ScheduleDestroy (&CapillaryStatsCollector::FinalDump, Ptr<CapillaryStatsCollector> (this), stream);
+}
+
+void
+CapillaryStatsCollector::DisableSummary (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_dumpEvent.Cancel ();
+}
+
+void
+CapillaryStatsCollector::PeriodicDump (Ptr<OutputStreamWrapper> stream, Time interval)
+{
+  Dump (*stream->GetStream ());
+  m_dumpEvent = Simulator::Schedule (interval, &CapillaryStatsCollector::PeriodicDump, this, stream, interval);
+}
+
+void
+CapillaryStatsCollector::FinalDump (Ptr<CapillaryStatsCollector> collector, Ptr<OutputStreamWrapper> stream)
+{
+  collector->Dump (*stream->GetStream ());
+  stream->GetStream ()->flush ();
+}
+
+void
+CapillaryStatsCollector::Dump (std::ostream &os) const
+{
+  os << "# time " << Simulator::Now ().GetSeconds () << "\n";
+  os << "# node role dcr aborted dcrMean dcrVar dcrMin dcrMax dcrP50 dcrP90 dcrP99 framesMean framesVar empty ok error okRatio\n";
+
+  for (std::vector<Ptr<NodeStats> >::const_iterator it = m_nodes.begin (); it != m_nodes.end (); ++it)
+    {
+      DumpNode (os, *it);
+    }
+}
+
+void
+CapillaryStatsCollector::DumpNode (std::ostream &os, Ptr<NodeStats> stats) const
+{
+  uint64_t total = stats->m_outcomes[FsalohaMac::EMPTY] + stats->m_outcomes[FsalohaMac::OK] + stats->m_outcomes[FsalohaMac::ERROR];
+  double okRatio = 0;
+  if (stats->m_coordinator)
+    {
+      // success ratio of the cell: successful over busy slots
+      uint64_t busy = stats->m_outcomes[FsalohaMac::OK] + stats->m_outcomes[FsalohaMac::ERROR];
+      okRatio = (busy > 0) ? (double)stats->m_outcomes[FsalohaMac::OK] / busy : 0;
+    }
+  else
+    {
+      // delivery ratio of the node
+      okRatio = (total > 0) ? (double)stats->m_outcomes[FsalohaMac::OK] / total : 0;
+    }
+
+  os << stats->m_node << " "
+     << (stats->m_coordinator ? "C" : "E") << " "
+     << stats->m_dcrDuration.GetCount () << " "
+     << stats->m_dcrAborted << " "
+     << stats->m_dcrDuration.GetMean () << " "
+     << stats->m_dcrDuration.GetVariance () << " "
+     << stats->m_dcrDuration.GetMin () << " "
+     << stats->m_dcrDuration.GetMax () << " "
+     << stats->m_dcrDurationSketch.GetQuantile (0.5) << " "
+     << stats->m_dcrDurationSketch.GetQuantile (0.9) << " "
+     << stats->m_dcrDurationSketch.GetQuantile (0.99) << " "
+     << stats->m_framesPerDcr.GetMean () << " "
+     << stats->m_framesPerDcr.GetVariance () << " "
+     << stats->m_outcomes[FsalohaMac::EMPTY] << " "
+     << stats->m_outcomes[FsalohaMac::OK] << " "
+     << stats->m_outcomes[FsalohaMac::ERROR] << " "
+     << okRatio << "\n";
+}
+
+void
+CapillaryStatsCollector::DcrStatusSink (Ptr<NodeStats> stats, CapillaryMac::DcrStatus previous, CapillaryMac::DcrStatus current)
+{
+  switch (current)
+    {
+    case CapillaryMac::ACTIVE_START:
+      stats->m_dcrStart = Simulator::Now ();
+      break;
+    case CapillaryMac::ACTIVE_STOP:
+      {
+        double duration = (Simulator::Now () - stats->m_dcrStart).GetSeconds ();
+        stats->m_dcrDuration.Add (duration);
+        stats->m_dcrDurationSketch.Add (duration);
+        stats->m_framesPerDcr.Add (stats->m_frames);
+      }
+      break;
+    case CapillaryMac::ACTIVE_ABORT:
+      stats->m_dcrAborted++;
+      break;
+    default:
+      break;
+    }
+}
+
+void
+CapillaryStatsCollector::FramesSink (Ptr<NodeStats> stats, int previous, int current)
+{
+  stats->m_frames = current;
+}
+
+void
+CapillaryStatsCollector::SlotStatusSink (Ptr<NodeStats> stats, const std::vector<FsalohaMac::SlotState> &status)
+{
+  for (std::vector<FsalohaMac::SlotState>::const_iterator it = status.begin (); it != status.end (); ++it)
+    {
+      stats->m_outcomes[*it]++;
+    }
+}
+
+void
+CapillaryStatsCollector::TxOutcomeSink (Ptr<NodeStats> stats, FsalohaMac::SlotState state)
+{
+  stats->m_outcomes[state]++;
+}
+
+} /* namespace ns3 */
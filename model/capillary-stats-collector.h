@@ -0,0 +1,192 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+#ifndef MODEL_CAPILLARY_STATS_COLLECTOR_H_
+#define MODEL_CAPILLARY_STATS_COLLECTOR_H_
+
+#include <ns3/capillary-mac.h>
+#include <ns3/capillary-net-device.h>
+#include <ns3/event-id.h>
+#include <ns3/fsaloha-mac.h>
+#include <ns3/net-device-container.h>
+#include <ns3/nstime.h>
+#include <ns3/object.h>
+#include <ns3/output-stream-wrapper.h>
+#include <ns3/ptr.h>
+#include <ns3/simple-ref-count.h>
+#include <stdint.h>
+#include <iostream>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * Running mean, variance, minimum and maximum (Welford's algorithm).
+ */
+class CapillaryRunningStats
+{
+public:
+  CapillaryRunningStats ();
+
+  void Add (double x);
+
+  uint64_t GetCount (void) const;
+  double GetMean (void) const;
+  double GetVariance (void) const;
+  double GetMin (void) const;
+  double GetMax (void) const;
+
+private:
+  uint64_t m_count;
+  double m_mean;
+  double m_m2;
+  double m_min;
+  double m_max;
+};
+
+/**
+ * Fixed-memory quantile sketch.
+ *
+ * Samples are counted in logarithmically spaced buckets between a
+ * minimum and a maximum value, so the relative error of a quantile is
+ * bounded by the bucket width whatever the number of samples. Values
+ * outside the range are clamped to the first or the last bucket.
+ */
+class CapillaryQuantileSketch
+{
+public:
+  /**
+   * @param min the lower bound of the tracked range (> 0)
+   * @param max the upper bound of the tracked range
+   * @param buckets the number of buckets
+   */
+  CapillaryQuantileSketch (double min, double max, uint16_t buckets);
+
+  void Add (double x);
+
+  /**
+   * @param q the quantile, in [0, 1]
+   * @return the estimated value of the quantile, 0 if empty
+   */
+  double GetQuantile (double q) const;
+
+  uint64_t GetCount (void) const;
+
+private:
+  double m_min;
+  double m_logMin;
+  double m_logWidth;
+  uint64_t m_count;
+  std::vector<uint32_t> m_buckets;
+};
+
+/*
+ * Streaming statistics collector.
+ *
+ * Hooks the DcrStatus, Frames, SlotStatus and TxOutcome trace sources of
+ * the capillary devices and keeps constant-size aggregates per node:
+ * DCR duration and frames per DCR (mean, variance and quantiles), slot
+ * outcome counts for coordinators (one per cell) and transmission
+ * outcome counts for end devices. No per-event record is stored: a
+ * summary is written at the end of the simulation and, optionally, at
+ * regular intervals.
+ */
+class CapillaryStatsCollector : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  CapillaryStatsCollector ();
+  virtual ~CapillaryStatsCollector ();
+
+  /**
+   * Hook the trace sources of the given capillary devices.
+   *
+   * @param devices the devices to monitor
+   */
+  void Install (NetDeviceContainer devices);
+
+  /**
+   * Write the summary to stream at the end of the simulation and, if
+   * interval is not zero, every interval.
+   *
+   * @param stream the output stream
+   * @param interval the period of the intermediate summaries
+   */
+  void EnableSummary (Ptr<OutputStreamWrapper> stream, Time interval = Seconds (0));
+
+  /**
+   * Stop the intermediate summaries, so that a simulation without a
+   * stop time can end; the final one is still written.
+   */
+  void DisableSummary (void);
+
+  /**
+   * Write the current summary.
+   *
+   * @param os the output stream
+   */
+  void Dump (std::ostream &os) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  class NodeStats : public SimpleRefCount<NodeStats>
+  {
+public:
+    NodeStats (uint32_t node, bool coordinator, double sketchMin, double sketchMax, uint16_t sketchBuckets);
+
+    uint32_t m_node;
+    bool m_coordinator;
+
+    Time m_dcrStart;
+    int m_frames;
+    uint64_t m_dcrAborted;
+
+    CapillaryRunningStats m_dcrDuration;
+    CapillaryQuantileSketch m_dcrDurationSketch;
+    CapillaryRunningStats m_framesPerDcr;
+
+    /** slot (coordinator) or transmission (end device) outcomes */
+    uint64_t m_outcomes[3];
+  };
+
+  static void DcrStatusSink (Ptr<NodeStats> stats, CapillaryMac::DcrStatus previous, CapillaryMac::DcrStatus current);
+  static void FramesSink (Ptr<NodeStats> stats, int previous, int current);
+  static void SlotStatusSink (Ptr<NodeStats> stats, const std::vector<FsalohaMac::SlotState> &status);
+  static void TxOutcomeSink (Ptr<NodeStats> stats, FsalohaMac::SlotState state);
+
+  void PeriodicDump (Ptr<OutputStreamWrapper> stream, Time interval);
+  static void FinalDump (Ptr<CapillaryStatsCollector> collector, Ptr<OutputStreamWrapper> stream);
+
+  void DumpNode (std::ostream &os, Ptr<NodeStats> stats) const;
+
+  std::vector<Ptr<NodeStats> > m_nodes;
+
+  double m_sketchMin;
+  double m_sketchMax;
+  uint16_t m_sketchBuckets;
+
+  EventId m_dumpEvent;
+};
+
+} /* namespace ns3 */
+
+#endif /* MODEL_CAPILLARY_STATS_COLLECTOR_H_ */
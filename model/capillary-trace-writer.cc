@@ -0,0 +1,292 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include "capillary-trace-writer.h"
+
+#include <ns3/assert.h>
+#include <ns3/log.h>
+#include <ns3/nstime.h>
+#include <cstring>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("CapillaryTraceWriter");
+
+static const char CAPILLARY_TRACE_MAGIC[4] = { 'C', 'T', 'R', 'B' };
+static const uint16_t CAPILLARY_TRACE_VERSION = 1;
+static const uint16_t CAPILLARY_TRACE_BYTE_ORDER = 0x0102;
+
+CapillaryTraceWriter::~CapillaryTraceWriter ()
+{
+}
+
+CapillaryBinaryTraceWriter::CapillaryBinaryTraceWriter (std::string fileName, uint32_t blockRecords)
+  : m_blockRecords (blockRecords)
+{
+  NS_LOG_FUNCTION (this << fileName << blockRecords);
+  NS_ASSERT (m_blockRecords > 0);
+
+  m_file.open (fileName.c_str (), std::ios::out | std::ios::binary | std::ios::trunc);
+  NS_ASSERT_MSG (m_file.is_open (), "CapillaryBinaryTraceWriter: unable to open " << fileName);
+
+  m_time.reserve (m_blockRecords);
+  m_node.reserve (m_blockRecords);
+  m_event.reserve (m_blockRecords);
+  m_value.reserve (m_blockRecords);
+
+  WriteFileHeader ();
+}
+
+CapillaryBinaryTraceWriter::~CapillaryBinaryTraceWriter ()
+{
+  NS_LOG_FUNCTION (this);
+  Flush ();
+  m_file.close ();
+}
+
+void
+CapillaryBinaryTraceWriter::WriteFileHeader (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  int64_t ticksPerSecond = Seconds (1).GetTimeStep ();
+
+  m_file.write (CAPILLARY_TRACE_MAGIC, sizeof (CAPILLARY_TRACE_MAGIC));
+  m_file.write (reinterpret_cast<const char *> (&CAPILLARY_TRACE_VERSION), sizeof (uint16_t));
+  m_file.write (reinterpret_cast<const char *> (&CAPILLARY_TRACE_BYTE_ORDER), sizeof (uint16_t));
+  m_file.write (reinterpret_cast<const char *> (&ticksPerSecond), sizeof (int64_t));
+}
+
+void
+CapillaryBinaryTraceWriter::Write (const CapillaryTraceRecord &record)
+{
+  m_time.push_back (record.time);
+  m_node.push_back (record.node);
+  m_event.push_back (record.event);
+  m_value.push_back (record.value);
+
+  if (m_time.size () >= m_blockRecords)
+    {
+      Flush ();
+    }
+}
+
+void
+CapillaryBinaryTraceWriter::Flush (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  uint32_t count = m_time.size ();
+  if (count == 0)
+    {
+      return;
+    }
+
+  m_file.write (reinterpret_cast<const char *> (&count), sizeof (uint32_t));
+  m_file.write (reinterpret_cast<const char *> (&m_time[0]), count * sizeof (int64_t));
+  m_file.write (reinterpret_cast<const char *> (&m_node[0]), count * sizeof (uint32_t));
+  m_file.write (reinterpret_cast<const char *> (&m_event[0]), count * sizeof (uint16_t));
+  m_file.write (reinterpret_cast<const char *> (&m_value[0]), count * sizeof (double));
+  m_file.flush ();
+
+  m_time.clear ();
+  m_node.clear ();
+  m_event.clear ();
+  m_value.clear ();
+}
+
+CapillaryBinaryTraceReader::CapillaryBinaryTraceReader (std::string fileName)
+  : m_valid (false),
+  m_ticksPerSecond (1)
+{
+  NS_LOG_FUNCTION (this << fileName);
+
+  m_file.open (fileName.c_str (), std::ios::in | std::ios::binary);
+  if (!m_file.is_open ())
+    {
+      NS_LOG_ERROR ("CapillaryBinaryTraceReader: unable to open " << fileName);
+      return;
+    }
+
+  char magic[4];
+  uint16_t version = 0;
+  uint16_t byteOrder = 0;
+
+  m_file.read (magic, sizeof (magic));
+  m_file.read (reinterpret_cast<char *> (&version), sizeof (uint16_t));
+  m_file.read (reinterpret_cast<char *> (&byteOrder), sizeof (uint16_t));
+  m_file.read (reinterpret_cast<char *> (&m_ticksPerSecond), sizeof (int64_t));
+
+  if (!m_file.good ()
+      || std::memcmp (magic, CAPILLARY_TRACE_MAGIC, sizeof (magic)) != 0
+      || version != CAPILLARY_TRACE_VERSION
+      || byteOrder != CAPILLARY_TRACE_BYTE_ORDER
+      || m_ticksPerSecond <= 0)
+    {
+      NS_LOG_ERROR ("CapillaryBinaryTraceReader: " << fileName << " is not a valid trace file.");
+      return;
+    }
+
+  m_valid = true;
+}
+
+CapillaryBinaryTraceReader::~CapillaryBinaryTraceReader ()
+{
+  NS_LOG_FUNCTION (this);
+  m_file.close ();
+}
+
+bool
+CapillaryBinaryTraceReader::IsValid (void) const
+{
+  return m_valid;
+}
+
+int64_t
+CapillaryBinaryTraceReader::GetTicksPerSecond (void) const
+{
+  return m_ticksPerSecond;
+}
+
+bool
+CapillaryBinaryTraceReader::ReadBlock (std::vector<CapillaryTraceRecord> &records)
+{
+  NS_LOG_FUNCTION (this);
+
+  records.clear ();
+
+  if (!m_valid)
+    {
+      return false;
+    }
+
+  uint32_t count = 0;
+  m_file.read (reinterpret_cast<char *> (&count), sizeof (uint32_t));
+  if (!m_file.good () || count == 0)
+    {
+      return false;
+    }
+
+  std::vector<int64_t> time (count);
+  std::vector<uint32_t> node (count);
+  std::vector<uint16_t> event (count);
+  std::vector<double> value (count);
+
+  m_file.read (reinterpret_cast<char *> (&time[0]), count * sizeof (int64_t));
+  m_file.read (reinterpret_cast<char *> (&node[0]), count * sizeof (uint32_t));
+  m_file.read (reinterpret_cast<char *> (&event[0]), count * sizeof (uint16_t));
+  m_file.read (reinterpret_cast<char *> (&value[0]), count * sizeof (double));
+
+  if (!m_file.good ())
+    {
+      NS_LOG_ERROR ("CapillaryBinaryTraceReader: truncated block.");
+      return false;
+    }
+
+  records.resize (count);
+  for (uint32_t i = 0; i < count; i++)
+    {
+      records[i].time = time[i];
+      records[i].node = node[i];
+      records[i].event = event[i];
+      records[i].value = value[i];
+    }
+
+  return true;
+}
+
+uint64_t
+CapillaryBinaryTraceReader::ConvertToCsv (std::ostream &os)
+{
+  NS_LOG_FUNCTION (this);
+
+  uint64_t converted = 0;
+  std::vector<CapillaryTraceRecord> records;
+
+  os << "time,node,event,value" << "\n";
+
+  while (ReadBlock (records))
+    {
+      for (size_t i = 0; i < records.size (); i++)
+        {
+          os << (double)records[i].time / m_ticksPerSecond << ","
+             << records[i].node << ","
+             << static_cast<CapillaryTraceRecord::EventCode> (records[i].event) << ","
+             << records[i].value << "\n";
+        }
+      converted += records.size ();
+    }
+
+  os.flush ();
+  return converted;
+}
+
+std::ostream& operator<< (std::ostream& os, CapillaryTraceRecord::EventCode event)
+{
+  switch (event)
+    {
+    case CapillaryTraceRecord::DCR_STATUS:
+      os << "DCR_STATUS";
+      break;
+    case CapillaryTraceRecord::FRAMES:
+      os << "FRAMES";
+      break;
+    case CapillaryTraceRecord::ENERGY_CONSUMPTION:
+      os << "ENERGY_CONSUMPTION";
+      break;
+    case CapillaryTraceRecord::REMAINING_ENERGY:
+      os << "REMAINING_ENERGY";
+      break;
+    case CapillaryTraceRecord::TP_SLOT_START:
+      os << "TP_SLOT_START";
+      break;
+    case CapillaryTraceRecord::TP_SLOT_STOP:
+      os << "TP_SLOT_STOP";
+      break;
+    case CapillaryTraceRecord::TP_TX_START:
+      os << "TP_TX_START";
+      break;
+    case CapillaryTraceRecord::TP_TX_END:
+      os << "TP_TX_END";
+      break;
+    case CapillaryTraceRecord::TP_RX_OK:
+      os << "TP_RX_OK";
+      break;
+    case CapillaryTraceRecord::TP_RX_ERROR:
+      os << "TP_RX_ERROR";
+      break;
+    case CapillaryTraceRecord::TP_PHY_STATE:
+      os << "TP_PHY_STATE";
+      break;
+    case CapillaryTraceRecord::TP_DCR_START:
+      os << "TP_DCR_START";
+      break;
+    case CapillaryTraceRecord::TP_DCR_STOP:
+      os << "TP_DCR_STOP";
+      break;
+    default:
+      os << "UNKNOWN(" << (uint16_t)event << ")";
+      break;
+    }
+
+  return os;
+}
+
+} /* namespace ns3 */
@@ -0,0 +1,163 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+#ifndef MODEL_CAPILLARY_TRACE_WRITER_H_
+#define MODEL_CAPILLARY_TRACE_WRITER_H_
+
+#include <ns3/simple-ref-count.h>
+#include <stdint.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * A fixed-width trace record: simulation time in ticks of the time
+ * resolution, node id, event code and a numeric value.
+ */
+struct CapillaryTraceRecord
+{
+  typedef enum
+  {
+    DCR_STATUS = 0x0000,
+    FRAMES = 0x0001,
+    ENERGY_CONSUMPTION = 0x0002,
+    REMAINING_ENERGY = 0x0003,
+    TP_SLOT_START = 0x0100,
+    TP_SLOT_STOP = 0x0101,
+    TP_TX_START = 0x0102,
+    TP_TX_END = 0x0103,
+    TP_RX_OK = 0x0104,
+    TP_RX_ERROR = 0x0105,
+    TP_PHY_STATE = 0x0106,
+    TP_DCR_START = 0x0107,
+    TP_DCR_STOP = 0x0108
+  } EventCode;
+
+  int64_t time;
+  uint32_t node;
+  uint16_t event;
+  double value;
+};
+
+std::ostream& operator<< (std::ostream& os, CapillaryTraceRecord::EventCode event);
+
+/*
+ * Base class of the record oriented trace writers.
+ */
+class CapillaryTraceWriter : public SimpleRefCount<CapillaryTraceWriter>
+{
+public:
+  virtual ~CapillaryTraceWriter ();
+
+  /**
+   * Append a record to the trace.
+   *
+   * @param record the record to write
+   */
+  virtual void Write (const CapillaryTraceRecord &record) = 0;
+
+  /**
+   * Force the buffered records out to the underlying storage.
+   */
+  virtual void Flush (void) = 0;
+};
+
+/*
+ * Binary trace writer.
+ *
+ * Records are accumulated in one buffer per column (time, node, event,
+ * value) and written out a block at a time. The file starts with a
+ * header (magic "CTRB", version, byte order mark, ticks per second);
+ * every block is a record count followed by the four columns stored
+ * contiguously in host byte order.
+ */
+class CapillaryBinaryTraceWriter : public CapillaryTraceWriter
+{
+public:
+  static const uint32_t DEFAULT_BLOCK_RECORDS = 65536;
+
+  /**
+   * @param fileName the output file name
+   * @param blockRecords the number of records buffered before a block is written
+   */
+  CapillaryBinaryTraceWriter (std::string fileName, uint32_t blockRecords = DEFAULT_BLOCK_RECORDS);
+  virtual ~CapillaryBinaryTraceWriter ();
+
+  virtual void Write (const CapillaryTraceRecord &record);
+  virtual void Flush (void);
+
+private:
+  void WriteFileHeader (void);
+
+  std::ofstream m_file;
+  uint32_t m_blockRecords;
+
+  std::vector<int64_t> m_time;
+  std::vector<uint32_t> m_node;
+  std::vector<uint16_t> m_event;
+  std::vector<double> m_value;
+};
+
+/*
+ * Reader for the files produced by CapillaryBinaryTraceWriter.
+ */
+class CapillaryBinaryTraceReader
+{
+public:
+  CapillaryBinaryTraceReader (std::string fileName);
+  virtual ~CapillaryBinaryTraceReader ();
+
+  /**
+   * @return true if the file was opened and has a valid header
+   */
+  bool IsValid (void) const;
+
+  /**
+   * @return the number of time ticks in one simulated second
+   */
+  int64_t GetTicksPerSecond (void) const;
+
+  /**
+   * Read the next block of records.
+   *
+   * @param records the vector filled with the records of the block
+   * @return false when no more blocks are available
+   */
+  bool ReadBlock (std::vector<CapillaryTraceRecord> &records);
+
+  /**
+   * Convert the whole trace to CSV (time,node,event,value).
+   *
+   * @param os the output stream
+   * @return the number of converted records
+   */
+  uint64_t ConvertToCsv (std::ostream &os);
+
+private:
+  std::ifstream m_file;
+  bool m_valid;
+  int64_t m_ticksPerSecond;
+};
+
+} /* namespace ns3 */
+
+#endif /* MODEL_CAPILLARY_TRACE_WRITER_H_ */
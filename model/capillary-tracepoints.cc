@@ -0,0 +1,122 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include "capillary-tracepoints.h"
+
+#include <ns3/assert.h>
+#include <ns3/log.h>
+#include <ns3/simulator.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("CapillaryTracepoints");
+
+bool CapillaryTracepoints::g_enabled = false;
+Ptr<CapillaryTraceWriter> CapillaryTracepoints::g_writer = 0;
+
+void
+CapillaryTracepoints::Enable (Ptr<CapillaryTraceWriter> writer)
+{
+  NS_LOG_FUNCTION (writer);
+  NS_ASSERT (writer);
+
+  g_writer = writer;
+  g_enabled = true;
+}
+
+void
+CapillaryTracepoints::Disable (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+
+  g_enabled = false;
+  if (g_writer)
+    {
+      g_writer->Flush ();
+      g_writer = 0;
+    }
+}
+
+void
+CapillaryTracepoints::Fire (CapillaryTraceRecord::EventCode event, uint32_t node, double value)
+{
+  CapillaryTraceRecord record;
+  record.time = Simulator::Now ().GetTimeStep ();
+  record.node = node;
+  record.event = event;
+  record.value = value;
+  g_writer->Write (record);
+}
+
+void
+CapillaryTracepoints::SlotStart (uint32_t node, uint16_t slot)
+{
+  Fire (CapillaryTraceRecord::TP_SLOT_START, node, slot);
+}
+
+void
+CapillaryTracepoints::SlotStop (uint32_t node, uint16_t slot)
+{
+  Fire (CapillaryTraceRecord::TP_SLOT_STOP, node, slot);
+}
+
+void
+CapillaryTracepoints::TxStart (uint32_t node, uint32_t bytes)
+{
+  Fire (CapillaryTraceRecord::TP_TX_START, node, bytes);
+}
+
+void
+CapillaryTracepoints::TxEnd (uint32_t node, uint32_t bytes)
+{
+  Fire (CapillaryTraceRecord::TP_TX_END, node, bytes);
+}
+
+void
+CapillaryTracepoints::RxOk (uint32_t node, uint32_t bytes)
+{
+  Fire (CapillaryTraceRecord::TP_RX_OK, node, bytes);
+}
+
+void
+CapillaryTracepoints::RxError (uint32_t node)
+{
+  Fire (CapillaryTraceRecord::TP_RX_ERROR, node, 0);
+}
+
+void
+CapillaryTracepoints::PhyState (uint32_t node, uint16_t state)
+{
+  Fire (CapillaryTraceRecord::TP_PHY_STATE, node, state);
+}
+
+void
+CapillaryTracepoints::DcrStart (uint32_t node)
+{
+  Fire (CapillaryTraceRecord::TP_DCR_START, node, 0);
+}
+
+void
+CapillaryTracepoints::DcrStop (uint32_t node, int frames)
+{
+  Fire (CapillaryTraceRecord::TP_DCR_STOP, node, frames);
+}
+
+} /* namespace ns3 */
@@ -0,0 +1,101 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+#ifndef MODEL_CAPILLARY_TRACEPOINTS_H_
+#define MODEL_CAPILLARY_TRACEPOINTS_H_
+
+#include <ns3/capillary-trace-writer.h>
+#include <ns3/ptr.h>
+#include <stdint.h>
+
+/*
+ * Static tracepoints of the MAC and PHY hot paths.
+ *
+ * Every tracepoint is a macro guarded by a single global flag: when the
+ * tracepoints are disabled the cost is one predictable branch and the
+ * arguments are not evaluated. When enabled, a record with the probe code
+ * and its typed argument is handed to the trace writer set with
+ * CapillaryTracepoints::Enable.
+ */
+
+#if defined (__GNUC__)
+#define CAPILLARY_TRACEPOINT_UNLIKELY(x) __builtin_expect (!!(x), 0)
+#else
+#define CAPILLARY_TRACEPOINT_UNLIKELY(x) (x)
+#endif
+
+#define CAPILLARY_TRACEPOINT(probe, args)                                     \
+  do                                                                          \
+    {                                                                         \
+      if (CAPILLARY_TRACEPOINT_UNLIKELY (ns3::CapillaryTracepoints::g_enabled)) \
+        {                                                                     \
+          ns3::CapillaryTracepoints::probe args;                              \
+        }                                                                     \
+    }                                                                         \
+  while (false)
+
+#define CAPILLARY_TP_SLOT_START(node, slot) CAPILLARY_TRACEPOINT (SlotStart, (node, slot))
+#define CAPILLARY_TP_SLOT_STOP(node, slot) CAPILLARY_TRACEPOINT (SlotStop, (node, slot))
+#define CAPILLARY_TP_TX_START(node, bytes) CAPILLARY_TRACEPOINT (TxStart, (node, bytes))
+#define CAPILLARY_TP_TX_END(node, bytes) CAPILLARY_TRACEPOINT (TxEnd, (node, bytes))
+#define CAPILLARY_TP_RX_OK(node, bytes) CAPILLARY_TRACEPOINT (RxOk, (node, bytes))
+#define CAPILLARY_TP_RX_ERROR(node) CAPILLARY_TRACEPOINT (RxError, (node))
+#define CAPILLARY_TP_PHY_STATE(node, state) CAPILLARY_TRACEPOINT (PhyState, (node, state))
+#define CAPILLARY_TP_DCR_START(node) CAPILLARY_TRACEPOINT (DcrStart, (node))
+#define CAPILLARY_TP_DCR_STOP(node, frames) CAPILLARY_TRACEPOINT (DcrStop, (node, frames))
+
+namespace ns3 {
+
+class CapillaryTracepoints
+{
+public:
+  /**
+   * Route the tracepoints to a trace writer.
+   *
+   * @param writer the writer receiving one record per tracepoint hit
+   */
+  static void Enable (Ptr<CapillaryTraceWriter> writer);
+
+  /**
+   * Disable the tracepoints and flush the writer.
+   */
+  static void Disable (void);
+
+  static void SlotStart (uint32_t node, uint16_t slot);
+  static void SlotStop (uint32_t node, uint16_t slot);
+  static void TxStart (uint32_t node, uint32_t bytes);
+  static void TxEnd (uint32_t node, uint32_t bytes);
+  static void RxOk (uint32_t node, uint32_t bytes);
+  static void RxError (uint32_t node);
+  static void PhyState (uint32_t node, uint16_t state);
+  static void DcrStart (uint32_t node);
+  static void DcrStop (uint32_t node, int frames);
+
+  /** true if the tracepoints are enabled */
+  static bool g_enabled;
+
+private:
+  static void Fire (CapillaryTraceRecord::EventCode event, uint32_t node, double value);
+
+  static Ptr<CapillaryTraceWriter> g_writer;
+};
+
+} /* namespace ns3 */
+
+#endif /* MODEL_CAPILLARY_TRACEPOINTS_H_ */
@@ -20,6 +20,7 @@
 
 #include "capillary-tracer.h"
 
+#include <ns3/capillary-async-trace-writer.h>
 #include <ns3/assert.h>
 #include <ns3/nstime.h>
 #include <ns3/simulator.h>
@@ -30,8 +31,63 @@
 
 namespace ns3 {
 
+CapillaryTraceContext::CapillaryTraceContext (uint32_t node, uint16_t device, Source source)
+  : node (node),
+  device (device),
+  source (source)
+{
+}
+
+std::ostream& operator<< (std::ostream& os, const CapillaryTraceContext &context)
+{
+  os << "/NodeList/" << context.node;
+  if (context.device != CapillaryTraceContext::NO_DEVICE)
+    {
+      os << "/DeviceList/" << context.device;
+    }
+
+  switch (context.source)
+    {
+    case CapillaryTraceContext::MAC_RX:
+      os << "/$ns3::CapillaryNetDevice/Mac/MacRx";
+      break;
+    case CapillaryTraceContext::MAC_TX:
+      os << "/$ns3::CapillaryNetDevice/Mac/MacTx";
+      break;
+    case CapillaryTraceContext::MAC_TX_ENQUEUE:
+      os << "/$ns3::CapillaryNetDevice/Mac/MacTxEnqueue";
+      break;
+    case CapillaryTraceContext::MAC_TX_DEQUEUE:
+      os << "/$ns3::CapillaryNetDevice/Mac/MacTxDequeue";
+      break;
+    case CapillaryTraceContext::MAC_TX_DROP:
+      os << "/$ns3::CapillaryNetDevice/Mac/MacTxDrop";
+      break;
+    case CapillaryTraceContext::DCR_STATUS:
+      os << "/$ns3::CapillaryNetDevice/Mac/DcrStatus";
+      break;
+    case CapillaryTraceContext::FRAMES:
+      os << "/$ns3::CapillaryNetDevice/Mac/Frames";
+      break;
+    case CapillaryTraceContext::TOTAL_ENERGY_CONSUMPTION:
+      os << "/$ns3::CapillaryEnergyModel/TotalEnergyConsumption";
+      break;
+    case CapillaryTraceContext::REMAINING_ENERGY:
+      os << "/$ns3::EnergySource/RemainingEnergy";
+      break;
+    default:
+      os << "/UNKNOWN(" << context.source << ")";
+      break;
+    }
+
+  return os;
+}
 
 CapillaryTracer::CapillaryTracer ()
+  : m_numericContext (true),
+  m_energyInterval (Seconds (0)),
+  m_energyThreshold (0),
+  m_asyncCapacity (0)
 {
 }
 CapillaryTracer::~CapillaryTracer ()
@@ -118,55 +174,212 @@ CapillaryTracer::EnableSourceAscii (Ptr<OutputStreamWrapper> stream, EnergySourc
 }
 
 void
-CapillaryTracer::DefaultDataCollectionRoundSinkWithContext (Ptr<OutputStreamWrapper> stream, std::string context, CapillaryMac::DcrStatus previous, CapillaryMac::DcrStatus current)
+CapillaryTracer::EnableEnergyDownsampling (Time interval, double threshold)
+{
+  NS_ASSERT (interval > Seconds (0));
+  NS_ASSERT (threshold >= 0);
+  m_energyInterval = interval;
+  m_energyThreshold = threshold;
+}
+
+void
+CapillaryTracer::DisableEnergyDownsampling (void)
+{
+  m_energyInterval = Seconds (0);
+}
+
+void
+CapillaryTracer::EnableDCRBinary (Ptr<CapillaryTraceWriter> writer, NetDeviceContainer n)
+{
+  writer = PrepareWriter (writer);
+  for (NetDeviceContainer::Iterator i = n.Begin (); i != n.End (); ++i)
+    {
+      Ptr<CapillaryNetDevice> dev = DynamicCast<CapillaryNetDevice> (*i);
+      NS_ASSERT (dev);
+      EnableBinaryInternal (writer, dev);
+    }
+}
+
+void
+CapillaryTracer::EnableEnergyBinary (Ptr<CapillaryTraceWriter> writer, DeviceEnergyModelContainer n)
+{
+  writer = PrepareWriter (writer);
+  for (DeviceEnergyModelContainer::Iterator i = n.Begin (); i != n.End (); ++i)
+    {
+      Ptr<CapillaryEnergyModel> dev = DynamicCast<CapillaryEnergyModel> (*i);
+      NS_ASSERT (dev);
+      EnableBinaryInternal (writer, dev);
+    }
+}
+
+void
+CapillaryTracer::EnableSourceBinary (Ptr<CapillaryTraceWriter> writer, EnergySourceContainer n)
+{
+  writer = PrepareWriter (writer);
+  for (EnergySourceContainer::Iterator i = n.Begin (); i != n.End (); ++i)
+    {
+      Ptr<EnergySource> dev = DynamicCast<EnergySource> (*i);
+      NS_ASSERT (dev);
+      EnableBinaryInternal (writer, dev);
+    }
+}
+
+Ptr<CapillaryTraceWriter>
+CapillaryTracer::PrepareWriter (Ptr<CapillaryTraceWriter> writer)
+{
+  NS_ASSERT (writer);
+
+  if (m_asyncCapacity == 0)
+    {
+      return writer;
+    }
+
+  // one background thread per underlying writer
+  std::map<CapillaryTraceWriter *, Ptr<CapillaryTraceWriter> >::iterator it = m_asyncWriters.find (PeekPointer (writer));
+  if (it != m_asyncWriters.end ())
+    {
+      return it->second;
+    }
+
+  Ptr<CapillaryTraceWriter> async = Create<CapillaryAsyncTraceWriter> (writer, m_asyncCapacity);
+  m_asyncWriters[PeekPointer (writer)] = async;
+  return async;
+}
+
+/*
+ * The ascii lines of the sinks, shared by the config path and the
+ * numeric contexts.
+ */
+template <typename Context>
+static void
+WriteDataCollectionRound (std::ostream &os, const Context &context, CapillaryMac::DcrStatus current)
 {
   switch (current)
     {
 
     case CapillaryMac::ACTIVE_START:
-      *stream->GetStream () << "+ " << Simulator::Now ().GetSeconds () << " " << context << " [ACTIVE_START]" << std::endl;
+      os << "+ " << Simulator::Now ().GetSeconds () << " " << context << " [ACTIVE_START]" << std::endl;
       break;
 
     case CapillaryMac::ACTIVE_STOP:
-      *stream->GetStream () << "- " << Simulator::Now ().GetSeconds () << " " << context << " [ACTIVE_STOP]" << std::endl;
+      os << "- " << Simulator::Now ().GetSeconds () << " " << context << " [ACTIVE_STOP]" << std::endl;
       break;
 
     case CapillaryMac::ACTIVE_ABORT:
-      *stream->GetStream () << "- " << Simulator::Now ().GetSeconds () << " " << context << " [ACTIVE_ABORT]" << std::endl;
+      os << "- " << Simulator::Now ().GetSeconds () << " " << context << " [ACTIVE_ABORT]" << std::endl;
       break;
 
     case CapillaryMac::NON_ACTIVE_START:
-      *stream->GetStream () << "+ " << Simulator::Now ().GetSeconds () << " " << context << " [NON_ACTIVE_START]" << std::endl;
+      os << "+ " << Simulator::Now ().GetSeconds () << " " << context << " [NON_ACTIVE_START]" << std::endl;
       break;
 
     case CapillaryMac::NON_ACTIVE_STOP:
-      *stream->GetStream () << "- " << Simulator::Now ().GetSeconds () << " " << context << " [NON_ACTIVE_STOP]" << std::endl;
+      os << "- " << Simulator::Now ().GetSeconds () << " " << context << " [NON_ACTIVE_STOP]" << std::endl;
       break;
 
     default:
-      *stream->GetStream () << "* " << Simulator::Now ().GetSeconds () << " " << context << " [UNKNOWN]" << std::endl;
+      os << "* " << Simulator::Now ().GetSeconds () << " " << context << " [UNKNOWN]" << std::endl;
       break;
 
     }
+}
 
+template <typename Context, typename Value>
+static void
+WriteValue (std::ostream &os, const char *prefix, const Context &context, Value current)
+{
+  os << prefix << " " << Simulator::Now ().GetSeconds () << " " << context << " " << current << std::endl;
+}
+
+void
+CapillaryTracer::DefaultDataCollectionRoundSinkWithContext (Ptr<OutputStreamWrapper> stream, std::string context, CapillaryMac::DcrStatus previous, CapillaryMac::DcrStatus current)
+{
+  WriteDataCollectionRound (*stream->GetStream (), context, current);
 }
 
 void
 CapillaryTracer::DefaultFramesSinkWithContext (Ptr<OutputStreamWrapper> stream, std::string context, int previous, int current)
 {
-  *stream->GetStream () << "- " << Simulator::Now ().GetSeconds () <<
-    " " << context << " " << current << std::endl;
+  WriteValue (*stream->GetStream (), "-", context, current);
 }
 
 void
 CapillaryTracer::DefaultEnergyConsumptionSinkWithContext (Ptr<OutputStreamWrapper> stream, std::string context, double previous, double current)
 {
-  *stream->GetStream () << "- " << Simulator::Now ().GetSeconds () << " " << context << " " << current << std::endl;
+  WriteValue (*stream->GetStream (), "-", context, current);
 }
 
 void CapillaryTracer::DefaultEnergySourceSinkWithContext (Ptr<OutputStreamWrapper> stream, std::string context, double previous, double current)
 {
-  *stream->GetStream () << "* " << Simulator::Now ().GetSeconds () << " " << context << " " << current << std::endl;
+  WriteValue (*stream->GetStream (), "*", context, current);
+}
+
+void
+CapillaryTracer::NumericDataCollectionRoundSink (Ptr<OutputStreamWrapper> stream, CapillaryTraceContext context, CapillaryMac::DcrStatus previous, CapillaryMac::DcrStatus current)
+{
+  WriteDataCollectionRound (*stream->GetStream (), context, current);
+}
+
+void
+CapillaryTracer::NumericFramesSink (Ptr<OutputStreamWrapper> stream, CapillaryTraceContext context, int previous, int current)
+{
+  WriteValue (*stream->GetStream (), "-", context, current);
+}
+
+void
+CapillaryTracer::NumericEnergyConsumptionSink (Ptr<OutputStreamWrapper> stream, CapillaryTraceContext context, double previous, double current)
+{
+  WriteValue (*stream->GetStream (), "-", context, current);
+}
+
+void
+CapillaryTracer::NumericEnergySourceSink (Ptr<OutputStreamWrapper> stream, CapillaryTraceContext context, double previous, double current)
+{
+  WriteValue (*stream->GetStream (), "*", context, current);
+}
+
+void
+CapillaryTracer::BinaryDataCollectionRoundSink (Ptr<CapillaryTraceWriter> writer, uint32_t node, CapillaryMac::DcrStatus previous, CapillaryMac::DcrStatus current)
+{
+  CapillaryTraceRecord record;
+  record.time = Simulator::Now ().GetTimeStep ();
+  record.node = node;
+  record.event = CapillaryTraceRecord::DCR_STATUS;
+  record.value = current;
+  writer->Write (record);
+}
+
+void
+CapillaryTracer::BinaryFramesSink (Ptr<CapillaryTraceWriter> writer, uint32_t node, int previous, int current)
+{
+  CapillaryTraceRecord record;
+  record.time = Simulator::Now ().GetTimeStep ();
+  record.node = node;
+  record.event = CapillaryTraceRecord::FRAMES;
+  record.value = current;
+  writer->Write (record);
+}
+
+void
+CapillaryTracer::BinaryEnergyConsumptionSink (Ptr<CapillaryTraceWriter> writer, uint32_t node, double previous, double current)
+{
+  CapillaryTraceRecord record;
+  record.time = Simulator::Now ().GetTimeStep ();
+  record.node = node;
+  record.event = CapillaryTraceRecord::ENERGY_CONSUMPTION;
+  record.value = current;
+  writer->Write (record);
+}
+
+void
+CapillaryTracer::BinaryEnergySourceSink (Ptr<CapillaryTraceWriter> writer, uint32_t node, double previous, double current)
+{
+  CapillaryTraceRecord record;
+  record.time = Simulator::Now ().GetTimeStep ();
+  record.node = node;
+  record.event = CapillaryTraceRecord::REMAINING_ENERGY;
+  record.value = current;
+  writer->Write (record);
 }
 
 
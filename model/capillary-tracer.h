@@ -26,14 +26,55 @@
 #include <ns3/energy-source.h>
 #include <ns3/energy-source-container.h>
 #include <ns3/net-device-container.h>
+#include <ns3/nstime.h>
 #include <ns3/output-stream-wrapper.h>
 #include <ns3/ptr.h>
+#include <stdint.h>
+#include <iostream>
+#include <map>
 #include <string>
 
 #include <ns3/capillary-net-device.h>
+#include <ns3/capillary-trace-writer.h>
 
 namespace ns3 {
 
+/**
+ * Compact identifier of a trace source: node id, device index and source
+ * code. It is bound to the trace sinks in place of the config path
+ * string, which is only rebuilt when a line of text is written.
+ */
+struct CapillaryTraceContext
+{
+  typedef enum
+  {
+    MAC_RX = 0x0000,
+    MAC_TX = 0x0001,
+    MAC_TX_ENQUEUE = 0x0002,
+    MAC_TX_DEQUEUE = 0x0003,
+    MAC_TX_DROP = 0x0004,
+    DCR_STATUS = 0x0005,
+    FRAMES = 0x0006,
+    TOTAL_ENERGY_CONSUMPTION = 0x0007,
+    REMAINING_ENERGY = 0x0008
+  } Source;
+
+  /** The device index of the sources not attached to a device */
+  static const uint16_t NO_DEVICE = 0xffff;
+
+  CapillaryTraceContext (uint32_t node, uint16_t device, Source source);
+
+  uint32_t node;
+  uint16_t device;
+  uint16_t source;
+};
+
+/**
+ * Write the config path of the trace source, e.g.
+ * /NodeList/3/DeviceList/0/$ns3::CapillaryNetDevice/Mac/DcrStatus
+ */
+std::ostream& operator<< (std::ostream& os, const CapillaryTraceContext &context);
+
 /*
  *
  */
@@ -55,12 +96,62 @@ public:
   virtual void EnableAsciiInternal (Ptr<OutputStreamWrapper> stream, Ptr<CapillaryEnergyModel> nd) = 0;
   virtual void EnableAsciiInternal (Ptr<OutputStreamWrapper> stream, Ptr<EnergySource> nd) = 0;
 
+  /**
+   * Downsample the energy ascii traces enabled from now on: one line per
+   * node and time bucket (last, min, max and mean value), skipped when
+   * the value moved less than threshold since the last line.
+   *
+   * @param interval the bucket width
+   * @param threshold the minimum change of value to be written
+   */
+  void EnableEnergyDownsampling (Time interval, double threshold = 0);
+
+  /**
+   * Write every energy sample of the traces enabled from now on.
+   */
+  void DisableEnergyDownsampling (void);
+
+  void EnableDCRBinary (Ptr<CapillaryTraceWriter> writer, NetDeviceContainer n);
+  void EnableEnergyBinary (Ptr<CapillaryTraceWriter> writer, DeviceEnergyModelContainer n);
+  void EnableSourceBinary (Ptr<CapillaryTraceWriter> writer, EnergySourceContainer n);
+
+  virtual void EnableBinaryInternal (Ptr<CapillaryTraceWriter> writer, Ptr<CapillaryNetDevice> nd) = 0;
+  virtual void EnableBinaryInternal (Ptr<CapillaryTraceWriter> writer, Ptr<CapillaryEnergyModel> nd) = 0;
+  virtual void EnableBinaryInternal (Ptr<CapillaryTraceWriter> writer, Ptr<EnergySource> nd) = 0;
+
 protected:
+  /**
+   * @return the writer the binary sinks must be bound to: the writer
+   * itself, or its asynchronous wrapper when the asynchronous mode is on
+   */
+  Ptr<CapillaryTraceWriter> PrepareWriter (Ptr<CapillaryTraceWriter> writer);
+
+  /** Bind the ascii sinks to a CapillaryTraceContext instead of a config path */
+  bool m_numericContext;
+
+  /** The energy downsampling bucket, zero if disabled */
+  Time m_energyInterval;
+  double m_energyThreshold;
+
+  /** The ring capacity of the asynchronous writers, 0 if disabled */
+  uint32_t m_asyncCapacity;
+  std::map<CapillaryTraceWriter *, Ptr<CapillaryTraceWriter> > m_asyncWriters;
+
   static void DefaultDataCollectionRoundSinkWithContext (Ptr<OutputStreamWrapper> stream, std::string context, CapillaryMac::DcrStatus previous, CapillaryMac::DcrStatus current);
   static void DefaultFramesSinkWithContext (Ptr<OutputStreamWrapper> stream, std::string context, int previous, int current);
   static void DefaultEnergyConsumptionSinkWithContext (Ptr<OutputStreamWrapper> stream, std::string context, double previous, double current);
 
   static void DefaultEnergySourceSinkWithContext (Ptr<OutputStreamWrapper> stream, std::string context, double previous, double current);
+
+  static void NumericDataCollectionRoundSink (Ptr<OutputStreamWrapper> stream, CapillaryTraceContext context, CapillaryMac::DcrStatus previous, CapillaryMac::DcrStatus current);
+  static void NumericFramesSink (Ptr<OutputStreamWrapper> stream, CapillaryTraceContext context, int previous, int current);
+  static void NumericEnergyConsumptionSink (Ptr<OutputStreamWrapper> stream, CapillaryTraceContext context, double previous, double current);
+  static void NumericEnergySourceSink (Ptr<OutputStreamWrapper> stream, CapillaryTraceContext context, double previous, double current);
+
+  static void BinaryDataCollectionRoundSink (Ptr<CapillaryTraceWriter> writer, uint32_t node, CapillaryMac::DcrStatus previous, CapillaryMac::DcrStatus current);
+  static void BinaryFramesSink (Ptr<CapillaryTraceWriter> writer, uint32_t node, int previous, int current);
+  static void BinaryEnergyConsumptionSink (Ptr<CapillaryTraceWriter> writer, uint32_t node, double previous, double current);
+  static void BinaryEnergySourceSink (Ptr<CapillaryTraceWriter> writer, uint32_t node, double previous, double current);
 };
 
 } /* namespace ns3 */
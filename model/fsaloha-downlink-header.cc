@@ -0,0 +1,123 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include "fsaloha-downlink-header.h"
+
+#include <ns3/address-utils.h>
+#include <ns3/assert.h>
+#include <ns3/log.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("FsalohaDownlinkHeader");
+
+NS_OBJECT_ENSURE_REGISTERED (FsalohaDownlinkHeader);
+
+FsalohaDownlinkHeader::FsalohaDownlinkHeader ()
+{
+}
+
+FsalohaDownlinkHeader::~FsalohaDownlinkHeader ()
+{
+}
+
+TypeId
+FsalohaDownlinkHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::FsalohaDownlinkHeader")
+    .SetParent<Header> ()
+    .SetGroupName ("m2m-capillary")
+    .AddConstructor<FsalohaDownlinkHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+FsalohaDownlinkHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+void
+FsalohaDownlinkHeader::AddDestination (Mac64Address destination)
+{
+  NS_ASSERT (m_destinations.size () < 0xff);
+  m_destinations.push_back (destination);
+}
+
+uint16_t
+FsalohaDownlinkHeader::GetNSlots (void) const
+{
+  return m_destinations.size ();
+}
+
+bool
+FsalohaDownlinkHeader::GetSlot (Mac64Address address, uint16_t &slot) const
+{
+  for (uint32_t i = 0; i < m_destinations.size (); i++)
+    {
+      if (m_destinations[i] == address)
+        {
+          slot = i;
+          return true;
+        }
+    }
+  return false;
+}
+
+void
+FsalohaDownlinkHeader::Print (std::ostream &os) const
+{
+  os << "downlink=" << m_destinations.size ();
+  for (uint32_t i = 0; i < m_destinations.size (); i++)
+    {
+      os << " " << m_destinations[i];
+    }
+}
+
+uint32_t
+FsalohaDownlinkHeader::GetSerializedSize (void) const
+{
+  return 1 + 8 * m_destinations.size ();
+}
+
+void
+FsalohaDownlinkHeader::Serialize (Buffer::Iterator start) const
+{
+  start.WriteU8 (m_destinations.size ());
+  for (uint32_t i = 0; i < m_destinations.size (); i++)
+    {
+      WriteTo (start, m_destinations[i]);
+    }
+}
+
+uint32_t
+FsalohaDownlinkHeader::Deserialize (Buffer::Iterator start)
+{
+  uint8_t n = start.ReadU8 ();
+  m_destinations.resize (n);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      ReadFrom (start, m_destinations[i]);
+    }
+  return GetSerializedSize ();
+}
+
+} /* namespace ns3 */
@@ -0,0 +1,76 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+#ifndef MODEL_FSALOHA_DOWNLINK_HEADER_H_
+#define MODEL_FSALOHA_DOWNLINK_HEADER_H_
+
+#include <ns3/header.h>
+#include <ns3/mac64-address.h>
+#include <stdint.h>
+#include <iostream>
+#include <vector>
+
+namespace ns3 {
+
+/*
+ * Downlink announcement, carried by the RFD right after the
+ * FsalohaHeader.
+ *
+ * It lists the end devices the coordinator has data for: the i-th one
+ * gets its data in the i-th downlink slot, right after the RFD and
+ * before the first frame of the DCR.
+ */
+class FsalohaDownlinkHeader : public Header
+{
+public:
+  FsalohaDownlinkHeader ();
+  virtual ~FsalohaDownlinkHeader ();
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  /**
+   * @param destination the end device of the next downlink slot
+   */
+  void AddDestination (Mac64Address destination);
+
+  /**
+   * @return the number of downlink slots
+   */
+  uint16_t GetNSlots (void) const;
+
+  /**
+   * @param address an end device
+   * @param slot the downlink slot of the device, if any
+   * @return true if the device has a downlink slot
+   */
+  bool GetSlot (Mac64Address address, uint16_t &slot) const;
+
+  virtual void Print (std::ostream &os) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+
+private:
+  std::vector<Mac64Address> m_destinations;
+};
+
+} /* namespace ns3 */
+
+#endif /* MODEL_FSALOHA_DOWNLINK_HEADER_H_ */
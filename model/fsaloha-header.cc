@@ -0,0 +1,121 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include "fsaloha-header.h"
+
+#include <ns3/log.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("FsalohaHeader");
+
+NS_OBJECT_ENSURE_REGISTERED (FsalohaHeader);
+
+FsalohaHeader::FsalohaHeader ()
+  : m_cellId (0),
+  m_flags (0)
+{
+}
+
+FsalohaHeader::FsalohaHeader (uint16_t cellId)
+  : m_cellId (cellId),
+  m_flags (0)
+{
+}
+
+FsalohaHeader::~FsalohaHeader ()
+{
+}
+
+TypeId
+FsalohaHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::FsalohaHeader")
+    .SetParent<Header> ()
+    .SetGroupName ("m2m-capillary")
+    .AddConstructor<FsalohaHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+FsalohaHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+void
+FsalohaHeader::SetCellId (uint16_t cellId)
+{
+  m_cellId = cellId;
+}
+
+uint16_t
+FsalohaHeader::GetCellId (void) const
+{
+  return m_cellId;
+}
+
+void
+FsalohaHeader::SetFlag (Flag flag)
+{
+  m_flags |= flag;
+}
+
+void
+FsalohaHeader::ClearFlag (Flag flag)
+{
+  m_flags &= ~flag;
+}
+
+bool
+FsalohaHeader::IsFlagSet (Flag flag) const
+{
+  return (m_flags & flag) != 0;
+}
+
+void
+FsalohaHeader::Print (std::ostream &os) const
+{
+  os << "cell=" << m_cellId << " flags=" << (uint16_t) m_flags;
+}
+
+uint32_t
+FsalohaHeader::GetSerializedSize (void) const
+{
+  return 3;
+}
+
+void
+FsalohaHeader::Serialize (Buffer::Iterator start) const
+{
+  start.WriteHtonU16 (m_cellId);
+  start.WriteU8 (m_flags);
+}
+
+uint32_t
+FsalohaHeader::Deserialize (Buffer::Iterator start)
+{
+  m_cellId = start.ReadNtohU16 ();
+  m_flags = start.ReadU8 ();
+  return GetSerializedSize ();
+}
+
+} /* namespace ns3 */
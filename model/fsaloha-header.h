@@ -0,0 +1,82 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+#ifndef MODEL_FSALOHA_HEADER_H_
+#define MODEL_FSALOHA_HEADER_H_
+
+#include <ns3/header.h>
+#include <stdint.h>
+#include <iostream>
+
+namespace ns3 {
+
+/*
+ * FSA header, carried right after the CapillaryMacHeader by every frame
+ * (RFD, FBP and DATA).
+ *
+ * It holds the identifier of the cell the frame belongs to, so that
+ * devices hearing more coordinators on the same channel only follow
+ * their own, and a flags field.
+ */
+class FsalohaHeader : public Header
+{
+public:
+  typedef enum
+  {
+    /** DATA: the sender gives its reserved slot back */
+    RELEASE = 0x01,
+    /** FBP: the next frame splits the collided slots */
+    SPLIT = 0x02,
+    /** DATA: the sender has more packets in this DCR */
+    MORE = 0x04,
+    /** FBP: the DCR ends with this feedback */
+    END = 0x08,
+    /** FBP: the acknowledgement of the DATA of the current slot */
+    ACK = 0x10,
+    /** DATA: a FsalohaReplicaHeader follows */
+    REPLICA = 0x20
+  } Flag;
+
+  FsalohaHeader ();
+  FsalohaHeader (uint16_t cellId);
+  virtual ~FsalohaHeader ();
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  void SetCellId (uint16_t cellId);
+  uint16_t GetCellId (void) const;
+
+  void SetFlag (Flag flag);
+  void ClearFlag (Flag flag);
+  bool IsFlagSet (Flag flag) const;
+
+  virtual void Print (std::ostream &os) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+
+private:
+  uint16_t m_cellId;
+  uint8_t m_flags;
+};
+
+} /* namespace ns3 */
+
+#endif /* MODEL_FSALOHA_HEADER_H_ */
@@ -0,0 +1,214 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include "fsaloha-mac-config.h"
+
+#include <ns3/capillary-mac-header.h>
+#include <ns3/capillary-mac-trailer.h>
+#include <ns3/fsaloha-header.h>
+#include <ns3/llc-snap-header.h>
+#include <ns3/log.h>
+#include <ns3/simulator.h>
+#include <map>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("FsalohaMacConfig");
+
+typedef std::map<FsalohaMacConfig, Ptr<const FsalohaMacConfig> > FsalohaMacConfigMap;
+
+static FsalohaMacConfigMap &
+GetInterned (void)
+{
+  static FsalohaMacConfigMap interned;
+  return interned;
+}
+
+static void
+ClearInterned (void)
+{
+  GetInterned ().clear ();
+}
+
+FsalohaMacConfig::FsalohaMacConfig ()
+  : nSlots (1),
+  nChannels (1),
+  maxDelay (MicroSeconds (10)),
+  mtu (140),
+  nPackets (1),
+  cellId (0),
+  reservation (false),
+  splittingFactor (0),
+  immediateAck (false),
+  replicas (1),
+  alarmSlots (0),
+  backoff (0),
+  backoffExponent (4),
+  m_cachedRate (0),
+  m_cachedSlotDuration (Seconds (0)),
+  m_cachedAckOffset (Seconds (0))
+{
+}
+
+Ptr<const FsalohaMacConfig>
+FsalohaMacConfig::Intern (const FsalohaMacConfig &config)
+{
+  FsalohaMacConfigMap &interned = GetInterned ();
+
+  FsalohaMacConfigMap::const_iterator it = interned.find (config);
+  if (it != interned.end ())
+    {
+      return it->second;
+    }
+
+  NS_LOG_DEBUG ("New configuration: " << config.nSlots << " slots, " << config.nChannels << " channels, cell " << config.cellId);
+
+  // the cache of the modified copy is stale
+  FsalohaMacConfig copy = config;
+  copy.m_cachedRate = 0;
+
+  if (interned.empty ())
+    {
+      // released with the simulation, the devices keep their own references
+      Simulator::ScheduleDestroy (&ClearInterned);
+    }
+
+  Ptr<const FsalohaMacConfig> shared = Create<FsalohaMacConfig> (copy);
+  interned[config] = shared;
+  return shared;
+}
+
+uint32_t
+FsalohaMacConfig::GetNInterned (void)
+{
+  return GetInterned ().size ();
+}
+
+void
+FsalohaMacConfig::UpdateCache (DataRate rate) const
+{
+  CapillaryMacHeader header;
+  FsalohaHeader fsaHdr;
+  LlcSnapHeader llc;
+  CapillaryMacTrailer trailer;
+  uint32_t overhead = header.GetSerializedSize () + fsaHdr.GetSerializedSize () + trailer.GetSerializedSize () + llc.GetSerializedSize ();
+
+  // the replica pointers
+  uint32_t data = mtu + overhead;
+  if (replicas > 1)
+    {
+      data += 1 + 2 * replicas;
+    }
+
+  m_cachedRate = rate.GetBitRate ();
+  m_cachedAckOffset = (2 * maxDelay) + Time (Seconds (data * 8.0 / rate.GetBitRate ()));
+  m_cachedSlotDuration = m_cachedAckOffset;
+
+  if (immediateAck)
+    {
+      // one bit per channel
+      uint32_t ack = overhead + (nChannels + 7) / 8;
+      m_cachedSlotDuration += (2 * maxDelay) + Time (Seconds (ack * 8.0 / rate.GetBitRate ()));
+    }
+}
+
+Time
+FsalohaMacConfig::GetSlotDuration (DataRate rate) const
+{
+  if (rate.GetBitRate () != m_cachedRate)
+    {
+      UpdateCache (rate);
+    }
+
+  return m_cachedSlotDuration;
+}
+
+uint32_t
+FsalohaMacConfig::GetFeedbackSize (void) const
+{
+  return (2 * nChannels * nSlots + 7) / 8;
+}
+
+Time
+FsalohaMacConfig::GetAckOffset (DataRate rate) const
+{
+  if (rate.GetBitRate () != m_cachedRate)
+    {
+      UpdateCache (rate);
+    }
+
+  return m_cachedAckOffset;
+}
+
+bool
+FsalohaMacConfig::operator< (const FsalohaMacConfig &other) const
+{
+  if (nSlots != other.nSlots)
+    {
+      return nSlots < other.nSlots;
+    }
+  if (nChannels != other.nChannels)
+    {
+      return nChannels < other.nChannels;
+    }
+  if (maxDelay != other.maxDelay)
+    {
+      return maxDelay < other.maxDelay;
+    }
+  if (mtu != other.mtu)
+    {
+      return mtu < other.mtu;
+    }
+  if (nPackets != other.nPackets)
+    {
+      return nPackets < other.nPackets;
+    }
+  if (cellId != other.cellId)
+    {
+      return cellId < other.cellId;
+    }
+  if (reservation != other.reservation)
+    {
+      return reservation < other.reservation;
+    }
+  if (splittingFactor != other.splittingFactor)
+    {
+      return splittingFactor < other.splittingFactor;
+    }
+  if (immediateAck != other.immediateAck)
+    {
+      return immediateAck < other.immediateAck;
+    }
+  if (replicas != other.replicas)
+    {
+      return replicas < other.replicas;
+    }
+  if (alarmSlots != other.alarmSlots)
+    {
+      return alarmSlots < other.alarmSlots;
+    }
+  if (backoff != other.backoff)
+    {
+      return backoff < other.backoff;
+    }
+  return backoffExponent < other.backoffExponent;
+}
+
+} /* namespace ns3 */
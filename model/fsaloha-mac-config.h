@@ -0,0 +1,130 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+#ifndef MODEL_FSALOHA_MAC_CONFIG_H_
+#define MODEL_FSALOHA_MAC_CONFIG_H_
+
+#include <ns3/data-rate.h>
+#include <ns3/nstime.h>
+#include <ns3/ptr.h>
+#include <ns3/simple-ref-count.h>
+#include <stdint.h>
+
+namespace ns3 {
+
+/*
+ * The FsalohaMac configuration shared by the devices of a cell.
+ *
+ * The configurations are interned: Intern returns the one shared
+ * instance of each distinct value, so thousands of MACs with the same
+ * attributes point to a single object. An interned configuration must
+ * not be changed; a MAC changing an attribute interns a modified copy.
+ */
+class FsalohaMacConfig : public SimpleRefCount<FsalohaMacConfig>
+{
+public:
+  FsalohaMacConfig ();
+
+  /**
+   * The instances are kept until Simulator::Destroy, then only by the
+   * devices still holding them.
+   *
+   * @param config the configuration
+   * @return the shared instance equal to config
+   */
+  static Ptr<const FsalohaMacConfig> Intern (const FsalohaMacConfig &config);
+
+  /**
+   * @return the number of distinct configurations interned in this simulation
+   */
+  static uint32_t GetNInterned (void);
+
+  /**
+   * The slot duration: the maximum delay on both sides of the longest
+   * frame. The last value is cached, the devices of a cell sharing the
+   * same rate.
+   *
+   * @param rate the PHY rate
+   * @return the slot duration
+   */
+  Time GetSlotDuration (DataRate rate) const;
+
+  /**
+   * @param rate the PHY rate
+   * @return the time from the start of a slot to its immediate ACK
+   */
+  Time GetAckOffset (DataRate rate) const;
+
+  /**
+   * @return the FBP payload: two bits for every (channel, slot)
+   */
+  uint32_t GetFeedbackSize (void) const;
+
+  bool operator< (const FsalohaMacConfig &other) const;
+
+  /** The number of slots in a frame */
+  uint16_t nSlots;
+
+  /** The number of channels of a frame */
+  uint16_t nChannels;
+
+  /** The maximum accettable delay */
+  Time maxDelay;
+
+  /** Maximum Transmission Unit */
+  uint16_t mtu;
+
+  /** The number of packets to transmit in a DCR */
+  uint32_t nPackets;
+
+  /** The cell of the devices */
+  uint16_t cellId;
+
+  /** Whether a successful slot is kept by the device in the next DCRs */
+  bool reservation;
+
+  /** The sub-slots of a collided slot in a splitting frame, 0 to retry in a full frame */
+  uint16_t splittingFactor;
+
+  /** Whether the coordinator acknowledges the DATA within their slot */
+  bool immediateAck;
+
+  /** The copies of a DATA sent in a frame, in distinct slots */
+  uint16_t replicas;
+
+  /** The first slots of the signalling channel, left to the alarm traffic */
+  uint16_t alarmSlots;
+
+  /** The FsalohaMac::BackoffPolicy of the end devices after a collision */
+  uint8_t backoff;
+
+  /** The collisions after which the backoff window stops growing */
+  uint16_t backoffExponent;
+
+private:
+  mutable uint64_t m_cachedRate;
+  mutable Time m_cachedSlotDuration;
+  mutable Time m_cachedAckOffset;
+
+  void UpdateCache (DataRate rate) const;
+};
+
+} /* namespace ns3 */
+
+#endif /* MODEL_FSALOHA_MAC_CONFIG_H_ */
@@ -19,7 +19,9 @@
 
 #include "fsaloha-mac.h"
 
+#include <ns3/abort.h>
 #include <ns3/assert.h>
+#include <ns3/boolean.h>
 #include <ns3/callback.h>
 #include <ns3/data-rate.h>
 #include <ns3/double.h>
@@ -40,10 +42,19 @@
 #include <algorithm>    // std::find
 #include <cstring>
 #include <iterator>
+#include <limits>
 
 #include <ns3/capillary-mac-header.h>
 #include <ns3/capillary-mac-trailer.h>
+#include <ns3/capillary-priority-tag.h>
+#include <ns3/fsaloha-header.h>
+#include <ns3/fsaloha-downlink-header.h>
+#include <ns3/fsaloha-reservation-header.h>
+#include <ns3/fsaloha-replica-header.h>
+#include <ns3/fsaloha-mac-config.h>
+#include <ns3/capillary-tracepoints.h>
 #include <ns3/capillary-phy.h>
+#include <ns3/capillary-phy-ideal.h>
 
 namespace ns3 {
 
@@ -54,9 +65,41 @@ NS_OBJECT_ENSURE_REGISTERED (FsalohaMac);
 #define MAC_DEBUG(x) NS_LOG_DEBUG ("" << Mac64Address::ConvertFrom (GetAddress ()) << " " << x)
 
 FsalohaMac::FsalohaMac () :
-  m_dev (0)
+  m_dev (0),
+  m_coordinator ("00:00:00:00:00:00:00:00"),
+  m_handover (false),
+  m_linkAlpha (0.25),
+  m_hysteresis (3),
+  m_minRxPower (-std::numeric_limits<double>::infinity ()),
+  m_linkTimeout (Seconds (120)),
+  m_frameSlots (0),
+  m_splitting (false),
+  m_splitSlots (0),
+  m_splitIndex (0),
+  m_splitWait (false),
+  m_splitKey (0),
+  m_retryLimit (0),
+  m_retries (0),
+  m_backoffFrames (0),
+  m_preemptedRetries (0),
+  m_backoffWait (false),
+  m_nRetryDrops (0),
+  m_downlinkQueueSize (100),
+  m_maxDownlinkSlots (4),
+  m_downlinkSlots (0),
+  m_downlinkPending (false),
+  m_downlinkIndex (0),
+  m_backoffHold (0),
+  m_acked (false),
+  m_endDCR (false),
+  m_maxMissedDcrs (3),
+  m_reserved (false),
+  m_reservedIndex (0),
+  m_reservationConfirmed (false),
+  m_releaseReservation (false)
 {
   NS_LOG_FUNCTION (this);
+  m_config = FsalohaMacConfig::Intern (FsalohaMacConfig ());
   m_activeDCR = CapillaryMac::ACTIVE_STOP;
   m_nFramesDCR = 0;
 }
@@ -66,6 +109,22 @@ FsalohaMac::~FsalohaMac ()
   NS_LOG_FUNCTION (this);
 }
 
+FsalohaMac::CoordinatorState::CoordinatorState () :
+  downlinkSlot (0),
+  collidedFrames (0)
+{
+}
+
+FsalohaMac::CoordinatorState & FsalohaMac::GetCoordinatorState (void)
+{
+  if (!m_coordinatorState)
+    {
+      NS_ASSERT (m_dev->GetType () == CapillaryNetDevice::COORDINATOR);
+      m_coordinatorState = Create<CoordinatorState> ();
+    }
+  return *m_coordinatorState;
+}
+
 void FsalohaMac::SetDevice (Ptr<NetDevice> d)
 {
   NS_LOG_FUNCTION (this << d);
@@ -99,14 +158,104 @@ TypeId FsalohaMac::GetTypeId (void)
                    "The number of slots in a Frame", UintegerValue (1),
                    MakeUintegerAccessor (&FsalohaMac::SetNSlots, &FsalohaMac::GetNSlots),
                    MakeUintegerChecker<uint16_t> (1, 32768))
+    .AddAttribute ("Channels",
+                   "The number of channels of a Frame", UintegerValue (1),
+                   MakeUintegerAccessor (&FsalohaMac::SetNChannels, &FsalohaMac::GetNChannels),
+                   MakeUintegerChecker<uint16_t> (1, 64))
     .AddAttribute ("MaxDelay",
                    "The maximum accettable delay", TimeValue (MicroSeconds (10)),
-                   MakeTimeAccessor (&FsalohaMac::m_maxDelay),
+                   MakeTimeAccessor (&FsalohaMac::SetMaxDelay, &FsalohaMac::GetMaxDelay),
                    MakeTimeChecker ())
     .AddAttribute ("packets",
                    "The number of packets to transmit in a DCR", UintegerValue (1),
-                   MakeUintegerAccessor (&FsalohaMac::m_NPackets),
+                   MakeUintegerAccessor (&FsalohaMac::SetNPackets, &FsalohaMac::GetNPackets),
                    MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("CellId",
+                   "The cell of the device; frames of other cells are ignored", UintegerValue (0),
+                   MakeUintegerAccessor (&FsalohaMac::SetCellId, &FsalohaMac::GetCellId),
+                   MakeUintegerChecker<uint16_t> ())
+    .AddAttribute ("Reservation",
+                   "Whether an end device keeps the slot of a successful transmission in the next DCRs",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&FsalohaMac::SetReservation, &FsalohaMac::GetReservation),
+                   MakeBooleanChecker ())
+    .AddAttribute ("MaxMissedDcrs",
+                   "The DCRs in a row a reserved slot can stay empty before the coordinator frees it",
+                   UintegerValue (3),
+                   MakeUintegerAccessor (&FsalohaMac::m_maxMissedDcrs),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("SplittingFactor",
+                   "The sub-slots a collided slot is split into by the next frame, 0 to retry in a full frame",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&FsalohaMac::SetSplittingFactor, &FsalohaMac::GetSplittingFactor),
+                   MakeUintegerChecker<uint16_t> ())
+    .AddAttribute ("ImmediateAck",
+                   "Whether the coordinator acknowledges the DATA within their slot",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&FsalohaMac::SetImmediateAck, &FsalohaMac::GetImmediateAck),
+                   MakeBooleanChecker ())
+    .AddAttribute ("Replicas",
+                   "The copies of a DATA an end device sends in distinct slots of a frame, cancelled from the collisions by the coordinator",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&FsalohaMac::SetReplicas, &FsalohaMac::GetReplicas),
+                   MakeUintegerChecker<uint16_t> (1, 255))
+    .AddAttribute ("AlarmSlots",
+                   "The first slots of the signalling channel left to the alarm traffic, 0 for none",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&FsalohaMac::SetAlarmSlots, &FsalohaMac::GetAlarmSlots),
+                   MakeUintegerChecker<uint16_t> ())
+    .AddAttribute ("Backoff",
+                   "The backoff of the end devices after the collisions of their packets; the coordinator waits out a FrameSkip window before ending a DCR",
+                   EnumValue (FsalohaMac::BACKOFF_NONE),
+                   MakeEnumAccessor (&FsalohaMac::SetBackoff, &FsalohaMac::GetBackoff),
+                   MakeEnumChecker (FsalohaMac::BACKOFF_NONE, "None",
+                                    FsalohaMac::FRAME_SKIP, "FrameSkip",
+                                    FsalohaMac::PERSISTENCE, "Persistence"))
+    .AddAttribute ("BackoffExponent",
+                   "The collisions after which the backoff stops growing",
+                   UintegerValue (4),
+                   MakeUintegerAccessor (&FsalohaMac::SetBackoffExponent, &FsalohaMac::GetBackoffExponent),
+                   MakeUintegerChecker<uint16_t> (0, 16))
+    .AddAttribute ("RetryLimit",
+                   "The collisions after which an end device drops its packet, 0 for no limit",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&FsalohaMac::m_retryLimit),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("DownlinkSlots",
+                   "The maximum number of downlink slots after an RFD",
+                   UintegerValue (4),
+                   MakeUintegerAccessor (&FsalohaMac::m_maxDownlinkSlots),
+                   MakeUintegerChecker<uint16_t> (0, 255))
+    .AddAttribute ("DownlinkQueueSize",
+                   "The maximum number of packets a coordinator holds for its end devices",
+                   UintegerValue (100),
+                   MakeUintegerAccessor (&FsalohaMac::m_downlinkQueueSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Handover",
+                   "Whether an end device moves to the cell with the best link quality",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&FsalohaMac::m_handover),
+                   MakeBooleanChecker ())
+    .AddAttribute ("LinkQualityAlpha",
+                   "The weight of a new sample in the smoothed link quality",
+                   DoubleValue (0.25),
+                   MakeDoubleAccessor (&FsalohaMac::m_linkAlpha),
+                   MakeDoubleChecker<double> (0, 1))
+    .AddAttribute ("HandoverHysteresis",
+                   "The link quality margin (dB) a cell needs over the current one to take the device",
+                   DoubleValue (3),
+                   MakeDoubleAccessor (&FsalohaMac::m_hysteresis),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("MinRxPower",
+                   "The link quality (dBm) below which an end device with handover does not contend",
+                   DoubleValue (-std::numeric_limits<double>::infinity ()),
+                   MakeDoubleAccessor (&FsalohaMac::m_minRxPower),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("LinkTimeout",
+                   "The time after which a cell not heard is no more a handover candidate",
+                   TimeValue (Seconds (120)),
+                   MakeTimeAccessor (&FsalohaMac::m_linkTimeout),
+                   MakeTimeChecker ())
     .AddAttribute ("RandomStream",
                    "A Random Variable Stream used to select transmission slots.",
                    PointerValue (),
@@ -122,6 +271,11 @@ TypeId FsalohaMac::GetTypeId (void)
                    StringValue ("ns3::DropTailQueue"),
                    MakePointerAccessor (&FsalohaMac::m_TxQueue),
                    MakePointerChecker<Queue> ())
+    .AddAttribute ("AlarmQueue",
+                   "alarm packets get queued here, ahead of the others",
+                   StringValue ("ns3::DropTailQueue"),
+                   MakePointerAccessor (&FsalohaMac::m_alarmQueue),
+                   MakePointerChecker<Queue> ())
     .AddAttribute ("Controller",
                    "The Capillary Controller .",
                    StringValue ("ns3::BasicController"),
@@ -130,6 +284,22 @@ TypeId FsalohaMac::GetTypeId (void)
     .AddTraceSource ("Frames",
                      "The number of frames in a DCR",
                      MakeTraceSourceAccessor (&FsalohaMac::m_nFrames))
+    .AddTraceSource ("SlotStatus",
+                     "The status of the slots of a frame, reported by the coordinator",
+                     MakeTraceSourceAccessor (&FsalohaMac::m_slotStatusTrace),
+                     "ns3::FsalohaMac::SlotStatusTracedCallback")
+    .AddTraceSource ("TxOutcome",
+                     "The outcome of a data transmission, reported by the end device",
+                     MakeTraceSourceAccessor (&FsalohaMac::m_txOutcomeTrace),
+                     "ns3::FsalohaMac::TxOutcomeTracedCallback")
+    .AddTraceSource ("CellChange",
+                     "The handover of an end device to another cell",
+                     MakeTraceSourceAccessor (&FsalohaMac::m_cellChangeTrace),
+                     "ns3::FsalohaMac::CellChangeTracedCallback")
+    .AddTraceSource ("AccessDelay",
+                     "The time from the queueing of a DATA to its successful transmission, reported by the end device",
+                     MakeTraceSourceAccessor (&FsalohaMac::m_accessDelayTrace),
+                     "ns3::FsalohaMac::AccessDelayTracedCallback")
   ;
 
   return tid;
@@ -176,13 +346,374 @@ Address FsalohaMac::GetBroadcast (void) const
 Address FsalohaMac::GetCoordinator (void) const
 {
   NS_LOG_FUNCTION (this);
-  return Mac64Address ("00:00:00:00:00:00:00:00");
+
+  if (m_dev && m_dev->GetType () == CapillaryNetDevice::COORDINATOR)
+    {
+      return m_addr;
+    }
+
+  return m_coordinator;
+}
+
+void FsalohaMac::SetCellId (const uint16_t cellId)
+{
+  NS_LOG_FUNCTION (this << cellId);
+
+  FsalohaMacConfig config = *m_config;
+  config.cellId = cellId;
+  m_config = FsalohaMacConfig::Intern (config);
+}
+
+uint16_t FsalohaMac::GetCellId (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_config->cellId;
+}
+
+void FsalohaMac::SetReservation (const bool reservation)
+{
+  NS_LOG_FUNCTION (this << reservation);
+
+  FsalohaMacConfig config = *m_config;
+  config.reservation = reservation;
+  m_config = FsalohaMacConfig::Intern (config);
+}
+
+bool FsalohaMac::GetReservation (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_config->reservation;
+}
+
+void FsalohaMac::SetSplittingFactor (const uint16_t splittingFactor)
+{
+  NS_LOG_FUNCTION (this << splittingFactor);
+  NS_ASSERT (splittingFactor != 1);
+
+  FsalohaMacConfig config = *m_config;
+  config.splittingFactor = splittingFactor;
+  m_config = FsalohaMacConfig::Intern (config);
+}
+
+uint16_t FsalohaMac::GetSplittingFactor (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_config->splittingFactor;
+}
+
+void FsalohaMac::SetImmediateAck (const bool immediateAck)
+{
+  NS_LOG_FUNCTION (this << immediateAck);
+
+  FsalohaMacConfig config = *m_config;
+  config.immediateAck = immediateAck;
+  m_config = FsalohaMacConfig::Intern (config);
+}
+
+bool FsalohaMac::GetImmediateAck (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_config->immediateAck;
+}
+
+void FsalohaMac::SetReplicas (const uint16_t replicas)
+{
+  NS_LOG_FUNCTION (this << replicas);
+  NS_ASSERT (replicas > 0);
+
+  FsalohaMacConfig config = *m_config;
+  config.replicas = replicas;
+  m_config = FsalohaMacConfig::Intern (config);
+}
+
+uint16_t FsalohaMac::GetReplicas (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_config->replicas;
+}
+
+void FsalohaMac::SetAlarmSlots (const uint16_t alarmSlots)
+{
+  NS_LOG_FUNCTION (this << alarmSlots);
+
+  FsalohaMacConfig config = *m_config;
+  config.alarmSlots = alarmSlots;
+  m_config = FsalohaMacConfig::Intern (config);
+}
+
+uint16_t FsalohaMac::GetAlarmSlots (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_config->alarmSlots;
+}
+
+void FsalohaMac::SetBackoff (const BackoffPolicy backoff)
+{
+  NS_LOG_FUNCTION (this << backoff);
+
+  FsalohaMacConfig config = *m_config;
+  config.backoff = backoff;
+  m_config = FsalohaMacConfig::Intern (config);
+}
+
+FsalohaMac::BackoffPolicy FsalohaMac::GetBackoff (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return (BackoffPolicy) m_config->backoff;
+}
+
+void FsalohaMac::SetBackoffExponent (const uint16_t backoffExponent)
+{
+  NS_LOG_FUNCTION (this << backoffExponent);
+
+  FsalohaMacConfig config = *m_config;
+  config.backoffExponent = backoffExponent;
+  m_config = FsalohaMacConfig::Intern (config);
+}
+
+uint16_t FsalohaMac::GetBackoffExponent (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_config->backoffExponent;
+}
+
+void FsalohaMac::ReleaseReservation (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  if (m_reserved)
+    {
+      m_releaseReservation = true;
+    }
+}
+
+uint32_t FsalohaMac::GetNRetryDrops (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_nRetryDrops;
+}
+
+uint32_t FsalohaMac::GetNReservations (void) const
+{
+  NS_LOG_FUNCTION (this);
+
+  if (m_dev->GetType () == CapillaryNetDevice::COORDINATOR)
+    {
+      return m_coordinatorState ? m_coordinatorState->reservations.size () : 0;
+    }
+  return m_reserved ? 1 : 0;
+}
+
+FsalohaReservationHeader FsalohaMac::BuildReservationMap (void) const
+{
+  NS_LOG_FUNCTION (this);
+
+  FsalohaReservationHeader map (m_config->nChannels * m_config->nSlots);
+  for (uint32_t i = 0; i < std::min<uint32_t> (m_config->alarmSlots, m_config->nSlots); i++)
+    {
+      // out of the contention of the routine traffic
+      map.SetReserved (i);
+    }
+  if (!m_coordinatorState)
+    {
+      return map;
+    }
+  for (std::map<uint32_t, Mac64Address>::const_iterator it = m_coordinatorState->reservations.begin (); it != m_coordinatorState->reservations.end (); it++)
+    {
+      map.SetReserved (it->first, it->second);
+    }
+  return map;
+}
+
+void FsalohaMac::UpdateReservation (uint32_t index, Mac64Address owner, bool release)
+{
+  NS_LOG_FUNCTION (this << index << owner << release);
+
+  CoordinatorState &coordinator = GetCoordinatorState ();
+
+  std::map<uint32_t, Mac64Address>::iterator it = coordinator.reservations.find (index);
+
+  if (index < m_config->alarmSlots)
+    {
+      return;
+    }
+
+  if (release)
+    {
+      if (it != coordinator.reservations.end () && it->second == owner)
+        {
+          MAC_DEBUG ("Slot " << index << " released by " << owner);
+          coordinator.reservations.erase (it);
+          coordinator.missedDcrs.erase (index);
+        }
+      return;
+    }
+
+  if (it != coordinator.reservations.end ())
+    {
+      return;
+    }
+
+  // a device keeps its first slot
+  for (it = coordinator.reservations.begin (); it != coordinator.reservations.end (); it++)
+    {
+      if (it->second == owner)
+        {
+          return;
+        }
+    }
+
+  MAC_DEBUG ("Slot " << index << " reserved by " << owner);
+  coordinator.reservations[index] = owner;
+  coordinator.missedDcrs[index] = 0;
+}
+
+void FsalohaMac::CheckReservations (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  CoordinatorState &coordinator = GetCoordinatorState ();
+
+  // a periodic reporter uses its slot in the first frame of the DCRs
+  // it has data for: a collision frees the slot at once, an owner with
+  // nothing to send keeps it for MaxMissedDcrs DCRs
+  std::map<uint32_t, Mac64Address>::iterator it = coordinator.reservations.begin ();
+  while (it != coordinator.reservations.end ())
+    {
+      SlotState state = it->first < m_slotStatus.size () ? m_slotStatus[it->first] : EMPTY;
+      if (state == OK)
+        {
+          coordinator.missedDcrs[it->first] = 0;
+        }
+      if (state == ERROR || (state == EMPTY && ++coordinator.missedDcrs[it->first] > m_maxMissedDcrs))
+        {
+          MAC_DEBUG ("Slot " << it->first << " missed by " << it->second);
+          coordinator.missedDcrs.erase (it->first);
+          coordinator.reservations.erase (it++);
+        }
+      else
+        {
+          it++;
+        }
+    }
+}
+
+void FsalohaMac::UpdateOwnReservation (SlotState state)
+{
+  NS_LOG_FUNCTION (this << state);
+
+  if (state == OK && m_releaseReservation)
+    {
+      // the release went with this DATA
+      m_reserved = false;
+      m_reservationConfirmed = false;
+      m_releaseReservation = false;
+    }
+  else if (state == OK && !m_reserved && m_rndChannel * m_config->nSlots + m_rndSlot >= m_config->alarmSlots)
+    {
+      // used from the next DCR, once confirmed by the RFD
+      m_reserved = true;
+      m_reservedIndex = m_rndChannel * m_config->nSlots + m_rndSlot;
+      m_reservationConfirmed = false;
+      MAC_DEBUG ("Reserved slot " << m_reservedIndex);
+    }
+  else if (state == ERROR && m_reservationConfirmed)
+    {
+      // the coordinator drops it as missed
+      m_reserved = false;
+      m_reservationConfirmed = false;
+    }
+}
+
+double FsalohaMac::GetLinkQuality (uint16_t cellId) const
+{
+  NS_LOG_FUNCTION (this << cellId);
+
+  std::map<uint16_t, LinkQuality>::const_iterator it = m_links.find (cellId);
+  if (it == m_links.end ())
+    {
+      return -std::numeric_limits<double>::infinity ();
+    }
+  return it->second.rxPower;
+}
+
+void FsalohaMac::UpdateLinkQuality (uint16_t cellId, Mac64Address coordinator)
+{
+  NS_LOG_FUNCTION (this << cellId << coordinator);
+
+  Ptr<CapillaryPhyIdeal> phy = DynamicCast<CapillaryPhyIdeal> (m_phy);
+  if (!phy)
+    {
+      return;
+    }
+
+  double sample = phy->GetRxPower ();
+
+  std::map<uint16_t, LinkQuality>::iterator it = m_links.find (cellId);
+  if (it == m_links.end ()
+      || it->second.coordinator != coordinator
+      || Simulator::Now () - it->second.lastHeard > m_linkTimeout)
+    {
+      LinkQuality link;
+      link.coordinator = coordinator;
+      link.rxPower = sample;
+      link.lastHeard = Simulator::Now ();
+      m_links[cellId] = link;
+    }
+  else
+    {
+      it->second.rxPower = m_linkAlpha * sample + (1 - m_linkAlpha) * it->second.rxPower;
+      it->second.lastHeard = Simulator::Now ();
+    }
+
+  MAC_DEBUG ("Cell " << cellId << " link quality " << m_links[cellId].rxPower << " dBm");
+}
+
+void FsalohaMac::CheckHandover (uint16_t cellId)
+{
+  NS_LOG_FUNCTION (this << cellId);
+
+  // the device leaves only between two DCRs, its data stay queued
+  if (!m_handover || cellId == m_config->cellId || m_activeDCR == CapillaryMac::ACTIVE_START)
+    {
+      return;
+    }
+
+  double current = -std::numeric_limits<double>::infinity ();
+  std::map<uint16_t, LinkQuality>::const_iterator it = m_links.find (m_config->cellId);
+  if (it != m_links.end () && Simulator::Now () - it->second.lastHeard <= m_linkTimeout)
+    {
+      current = it->second.rxPower;
+    }
+
+  const LinkQuality &candidate = m_links[cellId];
+  if (candidate.rxPower < current + m_hysteresis)
+    {
+      return;
+    }
+
+  uint16_t oldCell = m_config->cellId;
+  SetCellId (cellId);
+  m_coordinator = candidate.coordinator;
+
+  // the reservation stays in the old cell, missed there
+  m_reserved = false;
+  m_reservationConfirmed = false;
+  m_releaseReservation = false;
+  m_reservationMap = FsalohaReservationHeader ();
+
+  MAC_DEBUG ("Handover from cell " << oldCell << " to cell " << cellId);
+  m_cellChangeTrace (oldCell, cellId);
 }
 
 bool FsalohaMac::SetMtu (const uint16_t mtu)
 {
   NS_LOG_FUNCTION (this);
-  m_mtu = mtu;
+
+  FsalohaMacConfig config = *m_config;
+  config.mtu = mtu;
+  NS_ABORT_MSG_IF (config.GetFeedbackSize () > config.mtu, "The FBP of " << config.GetFeedbackSize () << " bytes does not fit in an MTU of " << mtu);
+  m_config = FsalohaMacConfig::Intern (config);
 
   return true;
 }
@@ -190,38 +721,143 @@ bool FsalohaMac::SetMtu (const uint16_t mtu)
 uint16_t FsalohaMac::GetMtu (void) const
 {
   NS_LOG_FUNCTION (this);
-  return m_mtu;
+  return m_config->mtu;
 }
 
 Time FsalohaMac::GetSlotDuration (void) const
 {
   NS_LOG_FUNCTION (this);
-
-  CapillaryMacHeader header;
-  LlcSnapHeader llc;
-  CapillaryMacTrailer trailer;
-
-  return (2 * m_maxDelay) + Time (Seconds ((m_mtu + header.GetSerializedSize () +  trailer.GetSerializedSize () + llc.GetSerializedSize ()) * 8.0 / m_phy->GetRate ().GetBitRate ()));
+  return m_config->GetSlotDuration (m_phy->GetRate ());
 }
 
 void FsalohaMac::SetNSlots (const uint16_t nSlots)
 {
   NS_LOG_FUNCTION (this << nSlots);
   NS_ASSERT (nSlots > 0);
-  m_nSlots = nSlots;
 
-  m_slotStatus.resize (m_nSlots);
+  FsalohaMacConfig config = *m_config;
+  config.nSlots = nSlots;
+  NS_ABORT_MSG_IF (config.GetFeedbackSize () > config.mtu, "The FBP of " << nSlots << " slots does not fit in the MTU");
+  m_config = FsalohaMacConfig::Intern (config);
 
   if (m_random)
     {
-      m_random->SetAttribute ("Max", DoubleValue (m_nSlots - 1));
+      m_random->SetAttribute ("Max", DoubleValue (m_config->nChannels * m_config->nSlots - 1));
     }
 }
 
+void FsalohaMac::SetNChannels (const uint16_t nChannels)
+{
+  NS_LOG_FUNCTION (this << nChannels);
+  NS_ASSERT (nChannels > 0);
+
+  FsalohaMacConfig config = *m_config;
+  config.nChannels = nChannels;
+  NS_ABORT_MSG_IF (config.GetFeedbackSize () > config.mtu, "The FBP of " << nChannels << " channels does not fit in the MTU");
+  m_config = FsalohaMacConfig::Intern (config);
+
+  if (m_random)
+    {
+      m_random->SetAttribute ("Max", DoubleValue (m_config->nChannels * m_config->nSlots - 1));
+    }
+}
+
+uint16_t FsalohaMac::GetNChannels (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_config->nChannels;
+}
+
+void FsalohaMac::SetMaxDelay (const Time maxDelay)
+{
+  NS_LOG_FUNCTION (this << maxDelay);
+
+  FsalohaMacConfig config = *m_config;
+  config.maxDelay = maxDelay;
+  m_config = FsalohaMacConfig::Intern (config);
+}
+
+Time FsalohaMac::GetMaxDelay (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_config->maxDelay;
+}
+
+void FsalohaMac::SetNPackets (const uint32_t nPackets)
+{
+  NS_LOG_FUNCTION (this << nPackets);
+
+  FsalohaMacConfig config = *m_config;
+  config.nPackets = nPackets;
+  m_config = FsalohaMacConfig::Intern (config);
+}
+
+uint32_t FsalohaMac::GetNPackets (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_config->nPackets;
+}
+
+Ptr<const FsalohaMacConfig> FsalohaMac::GetConfig (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_config;
+}
+
+void FsalohaMac::AddReceiver (Ptr<CapillaryPhy> phy)
+{
+  NS_LOG_FUNCTION (this << phy);
+  NS_ASSERT (phy);
+
+  CoordinatorState &coordinator = GetCoordinatorState ();
+  uint16_t channel = coordinator.receivers.size () + 1;
+  NS_ASSERT_MSG (channel < m_config->nChannels, "More receivers than channels");
+
+  phy->SetAttribute ("RxEndErrorCallback", CallbackValue (MakeBoundCallback (&FsalohaMac::ReceiverEndError, this, channel)));
+  phy->SetAttribute ("RxEndOkCallback", CallbackValue (MakeBoundCallback (&FsalohaMac::ReceiverEndOk, this, channel)));
+
+  coordinator.receivers.push_back (phy);
+}
+
 uint16_t FsalohaMac::GetNSlots (void) const
 {
   NS_LOG_FUNCTION (this);
-  return m_nSlots;
+  return m_config->nSlots;
+}
+
+uint32_t FsalohaMac::GetQueueLength (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_queue->GetNPackets ();
+}
+
+uint32_t FsalohaMac::GetTxQueueLength (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_TxQueue->GetNPackets ();
+}
+
+uint32_t FsalohaMac::GetDownlinkQueueLength (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_coordinatorState ? m_coordinatorState->downlinkQueue.size () : 0;
+}
+
+uint32_t FsalohaMac::GetSlotStatusSize (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_slotStatus.capacity () * sizeof (SlotState);
+}
+
+uint32_t FsalohaMac::GetCoordinatorStateSize (void) const
+{
+  NS_LOG_FUNCTION (this);
+  if (!m_coordinatorState)
+    {
+      return 0;
+    }
+  return sizeof (CoordinatorState) + m_coordinatorState->receivers.capacity () * sizeof (Ptr<CapillaryPhy>)
+         + m_coordinatorState->downlinkBurst.capacity () * sizeof (Ptr<Packet>);
 }
 
 
@@ -233,7 +869,7 @@ void FsalohaMac::SetRandomStream (Ptr<UniformRandomVariable> random)
   m_random = random;
 
   m_random->SetAttribute ("Min", DoubleValue (0));
-  m_random->SetAttribute ("Max", DoubleValue (m_nSlots - 1));
+  m_random->SetAttribute ("Max", DoubleValue (m_config->nChannels * m_config->nSlots - 1));
 }
 
 Ptr<UniformRandomVariable> FsalohaMac::GetRandomStream (void) const
@@ -246,6 +882,7 @@ void FsalohaMac::DoInitialize (void)
 {
   NS_LOG_FUNCTION (this);
   m_rndSlot = 0;
+  m_rndChannel = 0;
   m_currSlot = 0;
   m_slotStatus = std::vector<SlotState> ();
 }
@@ -257,6 +894,7 @@ void FsalohaMac::DoDispose (void)
   m_random = 0;
   m_dev = 0;
   m_controller = 0;
+  m_coordinatorState = 0;
   m_fwdUp.Nullify ();
 }
 
@@ -269,6 +907,14 @@ void FsalohaMac::WakeUp (void)
       m_phy->WakeUp ();
     }
 
+  for (uint32_t i = 0; m_coordinatorState && i < m_coordinatorState->receivers.size (); i++)
+    {
+      if (m_coordinatorState->receivers[i]->GetStatus () == CapillaryPhy::SLEEP)
+        {
+          m_coordinatorState->receivers[i]->WakeUp ();
+        }
+    }
+
   switch (m_dev->GetType ())
     {
     case CapillaryNetDevice::COORDINATOR:
@@ -287,61 +933,98 @@ void FsalohaMac::ForceSleep (void)
   MAC_DEBUG ("Forced State Sleep.");
 
   m_phy->ForceSleep ();
+
+  for (uint32_t i = 0; m_coordinatorState && i < m_coordinatorState->receivers.size (); i++)
+    {
+      m_coordinatorState->receivers[i]->ForceSleep ();
+    }
 }
 
 bool FsalohaMac::DataEnqueue (Ptr<Packet> packet, const Address& source, const Address& dest, uint16_t protocolNumber)
 {
   NS_LOG_FUNCTION (packet << source << dest << protocolNumber);
 
-  switch (m_dev->GetType ())
+  if (packet->GetSize () > m_config->mtu)
     {
-    case CapillaryNetDevice::COORDINATOR:
-      NS_LOG_ERROR ("DATA packets transmission not supported by COORDINATOR devices.");
-      break;
-    case CapillaryNetDevice::END_DEVICE:
-      {
-
-        if ( packet->GetSize () <= m_mtu)
-          {
-            LlcSnapHeader llc;
-            llc.SetType (protocolNumber);
-            packet->AddHeader (llc);
+      NS_LOG_ERROR ("Fragmentation not implemented yet. The Packet was dropped");
+      m_macTxDropTrace (packet);
+      return false;
+    }
 
-            CapillaryMacHeader macHdr (CapillaryMacHeader::CAPILLARY_MAC_DATA);
-            macHdr.SetSeqNum (m_DataSeqNum);
-            m_DataSeqNum++;
-            macHdr.SetSrcAddr (Mac64Address::ConvertFrom (source));
-            macHdr.SetDstAddr (Mac64Address::ConvertFrom (dest));
+  if (m_dev->GetType () == CapillaryNetDevice::COORDINATOR
+      && Mac64Address::ConvertFrom (dest) == Mac64Address::ConvertFrom (GetBroadcast ()))
+    {
+      NS_LOG_ERROR ("Broadcast DATA packets not supported by COORDINATOR devices.");
+      m_macTxDropTrace (packet);
+      return false;
+    }
 
-            packet->AddHeader (macHdr);
+  LlcSnapHeader llc;
+  llc.SetType (protocolNumber);
+  packet->AddHeader (llc);
+  packet->AddHeader (FsalohaHeader (m_config->cellId));
 
-            m_queue->Enqueue (Create<QueueItem> (packet));
+  CapillaryMacHeader macHdr (CapillaryMacHeader::CAPILLARY_MAC_DATA);
+  macHdr.SetSeqNum (m_DataSeqNum);
+  m_DataSeqNum++;
+  macHdr.SetSrcAddr (Mac64Address::ConvertFrom (source));
+  macHdr.SetDstAddr (Mac64Address::ConvertFrom (dest));
 
-            MAC_DEBUG ("Data Queue: " << m_queue->GetNPackets ());
+  packet->AddHeader (macHdr);
 
-            return true;
+  switch (m_dev->GetType ())
+    {
+    case CapillaryNetDevice::COORDINATOR:
+      {
+        // sent in a downlink slot after the next RFD
+        std::list<Ptr<Packet> > &downlinkQueue = GetCoordinatorState ().downlinkQueue;
+        if (downlinkQueue.size () >= m_downlinkQueueSize)
+          {
+            MAC_DEBUG ("Downlink Queue full, the Packet was dropped");
+            m_macTxDropTrace (packet);
+            return false;
           }
-        else
+
+        downlinkQueue.push_back (packet);
+        m_macTxEnqueueTrace (packet);
+        MAC_DEBUG ("Downlink Queue: " << downlinkQueue.size ());
+      }
+      break;
+
+    case CapillaryNetDevice::END_DEVICE:
+      {
+        // the queueing time, for the access delay
+        CapillaryPriorityTag tag;
+        packet->RemovePacketTag (tag);
+        tag.SetEnqueueTime (Simulator::Now ());
+        packet->AddPacketTag (tag);
+
+        Ptr<Queue> queue = (tag.GetPriority () == CapillaryPriorityTag::ALARM) ? m_alarmQueue : m_queue;
+        if (!queue->Enqueue (Create<QueueItem> (packet)))
           {
-            NS_LOG_ERROR ("Fragmentation not implemented yet. The Packet was dropped");
+            MAC_DEBUG ("Data Queue full, the Packet was dropped");
+            m_macTxDropTrace (packet);
+            return false;
           }
+
+        MAC_DEBUG ("Data Queue: " << m_queue->GetNPackets () << ", Alarm Queue: " << m_alarmQueue->GetNPackets ());
       }
       break;
     }
 
-  return false;
+  return true;
 }
 
 bool FsalohaMac::TrasmissionEnqueue (void)
 {
   NS_LOG_FUNCTION (this);
 
-  for (uint32_t i = 0; i < m_NPackets; i++)
+  for (uint32_t i = 0; i < m_config->nPackets; i++)
     {
 
       if (!m_queue->IsEmpty ())
         {
-          if (m_TxQueue->GetNPackets () >= m_NPackets)
+          if (m_TxQueue->GetNPackets () >= m_config->nPackets)
             {
               break;
             }
@@ -362,24 +1045,111 @@ bool FsalohaMac::TrasmissionEnqueue (void)
 
     }
 
-  if (!m_TxQueue->IsEmpty ())
+  MAC_DEBUG ("Transmission Queue: " << m_TxQueue->GetNPackets ());
+
+  if (m_currentPkt)
     {
-      MAC_DEBUG ("Transmission Queue: " << m_TxQueue->GetNPackets ());
+      // still backing off from the last DCR, unless an alarm came meanwhile
+      PreemptByAlarm ();
+      return true;
+    }
+
+  return DequeueNext ();
+}
+
+bool FsalohaMac::DequeueNext (void)
+{
+  NS_LOG_FUNCTION (this);
 
+  m_retries = 0;
+  m_backoffFrames = 0;
 
+  // an alarm goes ahead of the routine packets of the DCR
+  Ptr<QueueItem> item = m_alarmQueue->Dequeue ();
+  if (item)
+    {
+      m_currentPkt = item->GetPacket ();
+      m_macTxEnqueueTrace (m_currentPkt);
+      return true;
+    }
 
-      Ptr<QueueItem> item =  m_TxQueue->Dequeue ();
-      if (item)
-        {
+  if (m_preemptedPkt)
+    {
+      // back in the place it had before the alarm
+      m_currentPkt = m_preemptedPkt;
+      m_retries = m_preemptedRetries;
+      m_preemptedPkt = 0;
+      return true;
+    }
+
+  item = m_TxQueue->Dequeue ();
+  if (item)
+    {
+      m_currentPkt = item->GetPacket ();
+      return true;
+    }
+
+  m_currentPkt = 0;
+  return false;
+}
+
+bool FsalohaMac::PreemptByAlarm (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  if (!m_currentPkt || IsAlarm (m_currentPkt) || m_alarmQueue->IsEmpty ())
+    {
+      return false;
+    }
+
+  MAC_DEBUG ("Preempted by an alarm after " << m_retries << " collisions");
+  m_preemptedPkt = m_currentPkt;
+  m_preemptedRetries = m_retries;
+  return DequeueNext ();
+}
 
-          m_currentPkt = item->GetPacket ();
+bool FsalohaMac::Backoff (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  uint32_t window = 1u << std::min<uint32_t> (m_retries, m_config->backoffExponent);
+  switch (m_config->backoff)
+    {
+    case FRAME_SKIP:
+      if (m_backoffFrames > 0)
+        {
+          m_backoffFrames--;
           return true;
         }
+      break;
+
+    case PERSISTENCE:
+      return m_random->GetValue (0, 1) * window >= 1;
+
+    case BACKOFF_NONE:
+      break;
     }
 
   return false;
 }
 
+bool FsalohaMac::IsAlarm (Ptr<const Packet> p) const
+{
+  CapillaryPriorityTag tag;
+  return p && p->PeekPacketTag (tag) && tag.GetPriority () == CapillaryPriorityTag::ALARM;
+}
+
+void FsalohaMac::NotifyAccessDelay (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  CapillaryPriorityTag tag;
+  if (m_currentPkt->PeekPacketTag (tag))
+    {
+      m_accessDelayTrace (Simulator::Now () - tag.GetEnqueueTime (), tag.GetPriority ());
+    }
+}
+
 
 void FsalohaMac::NotifyTransmissionStart (Ptr<const Packet> p)
 {
@@ -407,43 +1177,48 @@ void FsalohaMac::NotifyTransmissionEnd (Ptr<const Packet> p)
         {
         case CapillaryMacHeader::CAPILLARY_MAC_RFD:
           MAC_DEBUG ("RFD Successfully Sent");
-          Simulator::Schedule (m_maxDelay, &FsalohaMac::StartFrame, this);
+          if (GetCoordinatorState ().downlinkBurst.empty ())
+            {
+              Simulator::Schedule (m_config->maxDelay, &FsalohaMac::StartFrame, this);
+            }
+          else
+            {
+              GetCoordinatorState ().downlinkSlot = 0;
+              Simulator::Schedule (m_config->maxDelay, &FsalohaMac::StartDownlinkSlot, this);
+            }
           break;
         case CapillaryMacHeader::CAPILLARY_MAC_DATA:
           MAC_DEBUG ("DATA Successfully Sent");
           break;
         case CapillaryMacHeader::CAPILLARY_MAC_FBP:
           {
+            Ptr<Packet> copy = p->Copy ();
+            copy->RemoveHeader (macHdr);
+            FsalohaHeader fsaHdr;
+            copy->PeekHeader (fsaHdr);
+            if (fsaHdr.IsFlagSet (FsalohaHeader::ACK))
+              {
+                MAC_DEBUG ("ACK Successfully Sent");
+                break;
+              }
+
             MAC_DEBUG ("FBP Successfully Sent");
             MAC_DEBUG ("Slots Status" << m_slotStatus);
 
+            if (m_config->reservation && m_nFramesDCR == 0)
+              {
+                CheckReservations ();
+              }
+
             m_nFramesDCR++;
 
-            if (m_NPackets == 1)
+            if (m_endDCR)
               {
-                if (std::find (m_slotStatus.begin (), m_slotStatus.end (), ERROR) == m_slotStatus.end ())
-                  {
-                    NotifyActivePeriodStopped ();
-                  }
-                else
-                  {
-                    Simulator::Schedule (m_maxDelay, &FsalohaMac::StartFrame, this);
-                  }
-
+                NotifyActivePeriodStopped ();
               }
             else
               {
-
-                if ((std::find (m_slotStatus.begin (), m_slotStatus.end (), ERROR) == m_slotStatus.end ())
-                    && (std::find (m_slotStatus.begin (), m_slotStatus.end (), OK) == m_slotStatus.end ())
-                    )
-                  {
-                    NotifyActivePeriodStopped ();
-                  }
-                else
-                  {
-                    Simulator::Schedule (m_maxDelay, &FsalohaMac::StartFrame, this);
-                  }
+                Simulator::Schedule (m_config->maxDelay, &FsalohaMac::StartFrame, this);
               }
 
           }
@@ -453,6 +1228,11 @@ void FsalohaMac::NotifyTransmissionEnd (Ptr<const Packet> p)
 
     case CapillaryNetDevice::END_DEVICE:
       MAC_DEBUG ("Packet successfully sent.");
+      if (m_config->immediateAck && m_rndChannel != 0)
+        {
+          // the ACK comes on the signalling channel
+          TuneChannel (0);
+        }
       break;
     }
 }
@@ -466,14 +1246,47 @@ void FsalohaMac::NotifyReceptionStart (void)
 void FsalohaMac::NotifyReceptionEndError (void)
 {
   NS_LOG_FUNCTION (this);
+  NotifyChannelReceptionEndError (0);
+}
+
+void FsalohaMac::NotifyReceptionEndOk (Ptr<Packet> p)
+{
+  NS_LOG_FUNCTION (this << p);
+  NotifyChannelReceptionEndOk (0, p);
+}
+
+void FsalohaMac::ReceiverEndError (FsalohaMac *mac, uint16_t channel)
+{
+  mac->NotifyChannelReceptionEndError (channel);
+}
+
+void FsalohaMac::ReceiverEndOk (FsalohaMac *mac, uint16_t channel, Ptr<Packet> p)
+{
+  mac->NotifyChannelReceptionEndOk (channel, p);
+}
+
+void FsalohaMac::NotifyChannelReceptionEndError (uint16_t channel)
+{
+  NS_LOG_FUNCTION (this << channel);
 
-  MAC_DEBUG ("Reception Error.");
+  MAC_DEBUG ("Reception Error on channel " << channel);
 
   switch (m_dev->GetType ())
     {
     case CapillaryNetDevice::COORDINATOR:
       {
-        m_slotStatus[m_currSlot] = ERROR;
+        SetSlotState (channel, ERROR);
+
+        if (m_config->replicas > 1 && !m_splitting)
+          {
+            // kept for the interference cancellation
+            CoordinatorState &coordinator = GetCoordinatorState ();
+            Ptr<CapillaryPhyIdeal> phy = DynamicCast<CapillaryPhyIdeal> (channel == 0 ? m_phy : coordinator.receivers[channel - 1]);
+            if (phy)
+              {
+                coordinator.sic.AddCollision (channel * m_config->nSlots + m_currSlot, phy->GetRxSignals ());
+              }
+          }
       }
       break;
 
@@ -483,9 +1296,9 @@ void FsalohaMac::NotifyReceptionEndError (void)
 }
 
 
-void FsalohaMac::NotifyReceptionEndOk (Ptr<Packet> p)
+void FsalohaMac::NotifyChannelReceptionEndOk (uint16_t channel, Ptr<Packet> p)
 {
-  NS_LOG_FUNCTION (this << p);
+  NS_LOG_FUNCTION (this << channel << p);
 
   if (p)
     {
@@ -502,6 +1315,42 @@ void FsalohaMac::NotifyReceptionEndOk (Ptr<Packet> p)
           p->RemoveHeader (header);
           NS_LOG_LOGIC ("packet " << header.GetSrcAddr () << " --> " << header.GetDstAddr () << " (here: " << m_addr << ")");
 
+          FsalohaHeader fsaHdr;
+          p->RemoveHeader (fsaHdr);
+
+          if (m_dev->GetType () == CapillaryNetDevice::END_DEVICE
+              && (header.GetFrameType () == CapillaryMacHeader::CAPILLARY_MAC_RFD
+                  || header.GetFrameType () == CapillaryMacHeader::CAPILLARY_MAC_FBP))
+            {
+              UpdateLinkQuality (fsaHdr.GetCellId (), header.GetSrcAddr ());
+              if (header.GetFrameType () == CapillaryMacHeader::CAPILLARY_MAC_RFD)
+                {
+                  CheckHandover (fsaHdr.GetCellId ());
+                }
+            }
+
+          if (fsaHdr.GetCellId () != m_config->cellId)
+            {
+              MAC_DEBUG ("Ignoring frame of cell " << fsaHdr.GetCellId ());
+              return;
+            }
+
+          FsalohaDownlinkHeader downlink;
+          FsalohaReservationHeader reservations;
+          FsalohaReplicaHeader replicas;
+          if (header.GetFrameType () == CapillaryMacHeader::CAPILLARY_MAC_DATA && fsaHdr.IsFlagSet (FsalohaHeader::REPLICA))
+            {
+              p->RemoveHeader (replicas);
+            }
+          if (header.GetFrameType () == CapillaryMacHeader::CAPILLARY_MAC_RFD)
+            {
+              p->RemoveHeader (downlink);
+              if (m_config->reservation || m_config->alarmSlots > 0)
+                {
+                  p->RemoveHeader (reservations);
+                }
+            }
+
           LlcSnapHeader llc;
           p->RemoveHeader (llc);
 
@@ -513,12 +1362,25 @@ void FsalohaMac::NotifyReceptionEndOk (Ptr<Packet> p)
                 {
                 case CapillaryMacHeader::CAPILLARY_MAC_DATA:
                   {
-                    m_slotStatus[m_currSlot] = OK;
+                    SetSlotState (channel, OK);
+
+                    if (m_config->reservation && !m_splitting)
+                      {
+                        UpdateReservation (channel * m_config->nSlots + m_currSlot, header.GetSrcAddr (), fsaHdr.IsFlagSet (FsalohaHeader::RELEASE));
+                      }
 
-                    if (!m_fwdUp.IsNull ())
+                    if (fsaHdr.IsFlagSet (FsalohaHeader::REPLICA))
                       {
-                        m_fwdUp (p, llc, header.GetSrcAddr (), header.GetDstAddr ());
+                        // cancelled from the slots of its twins at the end of the frame
+                        GetCoordinatorState ().sicDecoded.push_back (std::make_pair (p->GetUid (), replicas));
+                        if (!GetCoordinatorState ().sicDelivered.insert (p->GetUid ()).second)
+                          {
+                            MAC_DEBUG ("Replica already received");
+                            break;
+                          }
                       }
+
+                    DeliverData (p, llc, header, fsaHdr);
                   }
                   break;
 
@@ -546,11 +1408,33 @@ void FsalohaMac::NotifyReceptionEndOk (Ptr<Packet> p)
                       break;
 
                     case CapillaryMacHeader::CAPILLARY_MAC_RFD:
+                      m_coordinator = header.GetSrcAddr ();
+                      m_downlinkSlots = downlink.GetNSlots ();
+                      m_downlinkPending = downlink.GetSlot (m_addr, m_downlinkIndex);
+
+                      m_reservationMap = reservations;
+                      if (m_config->reservation)
+                        {
+                          // a slot missing from the map, or kept for another device, is not ours
+                          m_reserved = m_reserved && reservations.IsReservedTo (m_reservedIndex, m_addr);
+                          m_reservationConfirmed = m_reserved;
+                        }
                       if (m_activeDCR == CapillaryMac::ACTIVE_START)
                         {
                           MAC_DEBUG ("Aborting Previous DCR.");
                           NotifyActivePeriodAborted ();
                         }
+                      else if (m_handover && GetLinkQuality (m_config->cellId) < m_minRxPower)
+                        {
+                          // keep the data for a better cell, asleep up to the next RFD
+                          MAC_DEBUG ("Marginal link, skipping the DCR");
+                          Time off = m_nextDCR - Simulator::Now () - m_phy->GetSwitchingTime ();
+                          if (off.IsStrictlyPositive ())
+                            {
+                              ForceSleep ();
+                              Simulator::Schedule (off, &FsalohaMac::WakeUp, this);
+                            }
+                        }
                       else
                         {
                           StartActivePeriod ();
@@ -559,32 +1443,82 @@ void FsalohaMac::NotifyReceptionEndOk (Ptr<Packet> p)
 
                     case CapillaryMacHeader::CAPILLARY_MAC_FBP:
                       {
-                        if (m_activeDCR == CapillaryMac::ACTIVE_START)
+                        if (fsaHdr.IsFlagSet (FsalohaHeader::ACK))
+                          {
+                            ReceiveAck (p);
+                          }
+                        else if (m_activeDCR == CapillaryMac::ACTIVE_START)
                           {
                             m_nFramesDCR++;
 
                             uint8_t payload[p->GetSize ()];
                             p->CopyData (payload, p->GetSize ());
 
-                            DeserializeFBP (payload, p->GetSize ());
+                            if (m_acked)
+                              {
+                                // the outcome came with the ACK
+                                m_acked = false;
+                                UpdateSplit (payload, fsaHdr.IsFlagSet (FsalohaHeader::SPLIT) ? p->GetSize () : 0, OK);
+                                if (fsaHdr.IsFlagSet (FsalohaHeader::END))
+                                  {
+                                    NotifyActivePeriodStopped ();
+                                  }
+                                else
+                                  {
+                                    StartFrame ();
+                                  }
+                                break;
+                              }
+
+                            if (m_splitWait)
+                              {
+                                // no transmission in the splitting frame
+                                UpdateSplit (payload, fsaHdr.IsFlagSet (FsalohaHeader::SPLIT) ? p->GetSize () : 0, EMPTY);
+                                StartFrame ();
+                                break;
+                              }
+
+                            if (m_backoffWait)
+                              {
+                                // the packet waits for the next DCR if this one ends
+                                UpdateSplit (payload, fsaHdr.IsFlagSet (FsalohaHeader::SPLIT) ? p->GetSize () : 0, EMPTY);
+                                if (fsaHdr.IsFlagSet (FsalohaHeader::END))
+                                  {
+                                    NotifyActivePeriodStopped ();
+                                  }
+                                else
+                                  {
+                                    // an alarm does not wait for the backoff
+                                    PreemptByAlarm ();
+                                    StartFrame ();
+                                  }
+                                break;
+                              }
+
+                            SlotState state = GetOwnState (payload, p->GetSize ());
 
-                            MAC_DEBUG ("Slots Status" << m_slotStatus);
-                            MAC_DEBUG ("Current Slot: " << m_rndSlot);
-                            MAC_DEBUG ("Current Slot Status: " << m_slotStatus[m_rndSlot]);
+                            MAC_DEBUG ("Current Slot: " << m_rndSlot << ", channel: " << m_rndChannel);
+                            MAC_DEBUG ("Current Slot Status: " << state);
+
+                            UpdateSplit (payload, fsaHdr.IsFlagSet (FsalohaHeader::SPLIT) ? p->GetSize () : 0, state);
 
                             if (m_currentPkt)
                               {
-                                switch (m_slotStatus[m_rndSlot])
+                                m_txOutcomeTrace (state);
+
+                                if (m_config->reservation && !m_splitting)
+                                  {
+                                    UpdateOwnReservation (state);
+                                  }
+
+                                switch (state)
                                   {
                                   case OK:
                                     MAC_DEBUG ("Transmission: [SUCCESS]");
+                                    NotifyAccessDelay ();
                                     m_currentPkt = 0;
-                                    if (!m_TxQueue->IsEmpty ())
+                                    if (!fsaHdr.IsFlagSet (FsalohaHeader::END) && DequeueNext ())
                                       {
-                                        Ptr<QueueItem> item = m_TxQueue->Dequeue ();
-                                        NS_ASSERT (item);
-                                        m_currentPkt = item->GetPacket ();
-
                                         StartFrame ();
                                       }
                                     else
@@ -601,14 +1535,35 @@ void FsalohaMac::NotifyReceptionEndOk (Ptr<Packet> p)
                                   case ERROR:
                                     MAC_DEBUG ("Transmission: [ERROR]");
 
-                                    CapillaryMacTrailer trailer;
-                                    m_currentPkt->RemoveTrailer (trailer);
-
                                     CapillaryMacHeader header;
                                     m_currentPkt->RemoveHeader (header);
 
                                     header.SetRetry (true);
                                     m_currentPkt->AddHeader (header);
+
+                                    m_retries++;
+                                    if (m_retryLimit > 0 && m_retries >= m_retryLimit)
+                                      {
+                                        MAC_DEBUG ("Retry limit reached, the Packet was dropped");
+                                        m_macTxDropTrace (m_currentPkt);
+                                        m_nRetryDrops++;
+                                        if (DequeueNext ())
+                                          {
+                                            StartFrame ();
+                                          }
+                                        else
+                                          {
+                                            NotifyActivePeriodStopped ();
+                                          }
+                                        break;
+                                      }
+                                    if (m_config->backoff == FRAME_SKIP && m_config->splittingFactor == 0)
+                                      {
+                                        // the splitting frames resolve the collision otherwise
+                                        m_backoffFrames = m_random->GetInteger (0, (1u << std::min<uint32_t> (m_retries, m_config->backoffExponent)) - 1);
+                                      }
+
+                                    PreemptByAlarm ();
                                     StartFrame ();
                                     break;
                                   }
@@ -655,35 +1610,180 @@ void FsalohaMac::SerializeFBP (uint8_t *payload, uint32_t length)
           break;
         }
 
-      payload[positionVector] |= (m_slotStatus[i] << position) & (0x03 << position);
+      payload[positionVector] |= (m_slotStatus[i] << position) & (0x03 << position);
+    }
+}
+FsalohaMac::SlotState FsalohaMac::DeserializeFBP (const uint8_t *payload, uint32_t length, uint32_t index) const
+{
+  NS_LOG_FUNCTION (this << index);
+
+  uint16_t positionVector = (index / 4);
+  if (positionVector >= length)
+    {
+      return EMPTY;
+    }
+
+  // the first slot in the most significant bits
+  uint8_t position = 6 - 2 * (index - (positionVector * 4));
+
+  return static_cast<SlotState> (( payload[positionVector] >> position) & 0x03);
+}
+
+uint32_t FsalohaMac::CountFBP (const uint8_t *payload, uint32_t end, SlotState state) const
+{
+  NS_LOG_FUNCTION (this << end << state);
+
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < end; i++)
+    {
+      if (DeserializeFBP (payload, (end + 3) / 4, i) == state)
+        {
+          count++;
+        }
+    }
+  return count;
+}
+
+void FsalohaMac::UpdateSplit (const uint8_t *payload, uint32_t length, SlotState state)
+{
+  NS_LOG_FUNCTION (this << length << state);
+
+  // the collided slots of the FBP, in order, make the next frame
+  uint32_t nSlots = CountFBP (payload, length * 4, ERROR) * m_config->splittingFactor;
+  if (length == 0 || nSlots == 0 || nSlots > 0xffff)
+    {
+      m_splitSlots = 0;
+      m_splitWait = false;
+      return;
+    }
+
+  m_splitSlots = nSlots;
+
+  if (m_dev->GetType () == CapillaryNetDevice::END_DEVICE)
+    {
+      m_splitWait = (state != ERROR);
+      if (state == ERROR)
+        {
+          uint32_t index = m_replicas.empty () ? 0 : m_replicas.front ();
+          m_splitIndex = CountFBP (payload, index, ERROR) * m_config->splittingFactor;
+          if (!m_splitting)
+            {
+              // a new tree: split by the address digits
+              uint8_t addr[8];
+              m_addr.CopyTo (addr);
+              m_splitKey = 0;
+              for (uint32_t i = 0; i < 8; i++)
+                {
+                  m_splitKey = (m_splitKey << 8) | addr[i];
+                }
+            }
+        }
+    }
+}
+
+FsalohaMac::SlotState FsalohaMac::GetOwnState (const uint8_t *payload, uint32_t length) const
+{
+  NS_LOG_FUNCTION (this << length);
+
+  // received if any replica was
+  SlotState state = EMPTY;
+  for (uint32_t i = 0; i < m_replicas.size (); i++)
+    {
+      SlotState replica = DeserializeFBP (payload, length, m_replicas[i]);
+      if (replica == OK)
+        {
+          return OK;
+        }
+      if (replica == ERROR)
+        {
+          state = ERROR;
+        }
+    }
+  return state;
+}
+
+void FsalohaMac::CancelInterference (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  CoordinatorState &coordinator = GetCoordinatorState ();
+
+  // the list grows with the signals recovered
+  for (uint32_t i = 0; i < coordinator.sicDecoded.size (); i++)
+    {
+      uint64_t uid = coordinator.sicDecoded[i].first;
+      FsalohaReplicaHeader replicas = coordinator.sicDecoded[i].second;
+
+      for (uint32_t r = 0; r < replicas.GetNReplicas (); r++)
+        {
+          uint32_t index = replicas.GetReplica (r);
+          Ptr<const Packet> residual = coordinator.sic.Cancel (index, uid);
+
+          if (index < m_slotStatus.size () && m_slotStatus[index] == ERROR && coordinator.sic.IsResolved (index))
+            {
+              m_slotStatus[index] = OK;
+            }
+
+          if (residual)
+            {
+              ReceiveResidual (residual);
+            }
+        }
+    }
+
+  MAC_DEBUG ("Signals left after the cancellation: " << coordinator.sic.GetNSignals ());
+}
+
+void FsalohaMac::ReceiveResidual (Ptr<const Packet> signal)
+{
+  NS_LOG_FUNCTION (this << signal);
+
+  Ptr<Packet> p = signal->Copy ();
+
+  CapillaryMacTrailer trailer;
+  p->RemoveTrailer (trailer);
+  CapillaryMacHeader header;
+  p->RemoveHeader (header);
+  FsalohaHeader fsaHdr;
+  p->RemoveHeader (fsaHdr);
+
+  if (header.GetFrameType () != CapillaryMacHeader::CAPILLARY_MAC_DATA
+      || fsaHdr.GetCellId () != m_config->cellId
+      || !fsaHdr.IsFlagSet (FsalohaHeader::REPLICA))
+    {
+      return;
+    }
+
+  FsalohaReplicaHeader replicas;
+  p->RemoveHeader (replicas);
+  LlcSnapHeader llc;
+  p->RemoveHeader (llc);
+
+  MAC_DEBUG ("Recovered by interference cancellation: " << header.GetSrcAddr ());
+  CoordinatorState &coordinator = GetCoordinatorState ();
+  coordinator.sicDecoded.push_back (std::make_pair (signal->GetUid (), replicas));
+  if (coordinator.sicDelivered.insert (signal->GetUid ()).second)
+    {
+      DeliverData (p, llc, header, fsaHdr);
     }
 }
-void FsalohaMac::DeserializeFBP (uint8_t *payload, uint32_t length)
+
+void FsalohaMac::DeliverData (Ptr<Packet> p, const LlcSnapHeader &llc, const CapillaryMacHeader &header, const FsalohaHeader &fsaHdr)
 {
-  NS_LOG_FUNCTION (this);
+  NS_LOG_FUNCTION (this << p);
 
-  for (size_t i = 0; i < m_slotStatus.size (); i++)
+  if (fsaHdr.IsFlagSet (FsalohaHeader::MORE))
     {
-      uint16_t positionVector = (i / 4);
-      uint8_t position = 0;
-
-      switch (i - (positionVector * 4))
-        {
-        case 0x00:
-          position = 6;
-          break;
-        case 0x01:
-          position = 4;
-          break;
-        case 0x02:
-          position = 2;
-          break;
-        case 0x03:
-          position = 0;
-          break;
-        }
+      GetCoordinatorState ().backlogged.insert (header.GetSrcAddr ());
+    }
+  else
+    {
+      GetCoordinatorState ().backlogged.erase (header.GetSrcAddr ());
+    }
 
-      m_slotStatus[i] = static_cast<SlotState> (( payload[positionVector] >> position) & 0x03);
+  if (!m_fwdUp.IsNull ())
+    {
+      m_fwdUp (p, llc, header.GetSrcAddr (), header.GetDstAddr ());
     }
 }
 
@@ -697,6 +1797,7 @@ void FsalohaMac::StartActivePeriod (void)
 
       MAC_DEBUG ("Is starting a new DCR.");
       m_activeDCR = CapillaryMac::ACTIVE_START;
+      CAPILLARY_TP_DCR_START (m_dev->GetNode ()->GetId ());
       m_controller->NotifyActivePeriodStart ();
 
       if (!startDCRCallback.IsNull ())
@@ -705,6 +1806,10 @@ void FsalohaMac::StartActivePeriod (void)
         }
       m_nFramesDCR = 0;
       m_nFrames = m_nFramesDCR;
+      m_splitSlots = 0;
+      GetCoordinatorState ().backlogged.clear ();
+      GetCoordinatorState ().collidedFrames = 0;
+      m_backoffHold = 0;
       FsalohaMac::SendRequestForData ();
 
       break;
@@ -720,6 +1825,7 @@ void FsalohaMac::StartActivePeriod (void)
         {
           MAC_DEBUG ("Is starting a new DCR.");
           m_activeDCR = CapillaryMac::ACTIVE_START;
+          CAPILLARY_TP_DCR_START (m_dev->GetNode ()->GetId ());
 
           if (!startDCRCallback.IsNull ())
             {
@@ -727,18 +1833,146 @@ void FsalohaMac::StartActivePeriod (void)
             }
           m_nFramesDCR = 0;
           m_nFrames = m_nFramesDCR;
-          StartFrame ();
+          m_splitSlots = 0;
+          m_splitWait = false;
+          m_acked = false;
+
+          if (m_downlinkSlots == 0)
+            {
+              StartFrame ();
+            }
+          else
+            {
+              // the first frame follows the downlink slots
+              SleepDuringDownlink ();
+              Simulator::Schedule (m_downlinkSlots * GetSlotDuration (), &FsalohaMac::StartFrame, this);
+            }
+        }
+      else if (m_downlinkPending)
+        {
+          SleepDuringDownlink ();
+          Simulator::Schedule (m_downlinkSlots * GetSlotDuration (), &FsalohaMac::SleepFrame, this);
         }
       else
         {
           ForceSleep ();
-          Simulator::Schedule (m_nSlots * GetSlotDuration () - m_phy->GetSwitchingTime (), &FsalohaMac::WakeUp, this);
+          Simulator::Schedule ((m_downlinkSlots + m_config->nSlots) * GetSlotDuration () - m_phy->GetSwitchingTime (), &FsalohaMac::WakeUp, this);
         }
 
       break;
     }
 }
 
+void FsalohaMac::SleepFrame (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  ForceSleep ();
+  Simulator::Schedule (m_config->nSlots * GetSlotDuration () - m_phy->GetSwitchingTime (), &FsalohaMac::WakeUp, this);
+}
+
+FsalohaDownlinkHeader FsalohaMac::SelectDownlink (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  CoordinatorState &coordinator = GetCoordinatorState ();
+
+  FsalohaDownlinkHeader announcement;
+
+  // a DCR aborted mid-burst: the packets not sent yet go first
+  if (coordinator.downlinkSlot < coordinator.downlinkBurst.size ())
+    {
+      coordinator.downlinkQueue.insert (coordinator.downlinkQueue.begin (), coordinator.downlinkBurst.begin () + coordinator.downlinkSlot, coordinator.downlinkBurst.end ());
+    }
+  coordinator.downlinkBurst.clear ();
+  coordinator.downlinkSlot = 0;
+
+  std::list<Ptr<Packet> >::iterator it = coordinator.downlinkQueue.begin ();
+  while (it != coordinator.downlinkQueue.end () && coordinator.downlinkBurst.size () < m_maxDownlinkSlots)
+    {
+      CapillaryMacHeader header;
+      (*it)->PeekHeader (header);
+
+      // one packet per end device and DCR
+      uint16_t slot;
+      if (announcement.GetSlot (header.GetDstAddr (), slot))
+        {
+          it++;
+          continue;
+        }
+
+      announcement.AddDestination (header.GetDstAddr ());
+      coordinator.downlinkBurst.push_back (*it);
+      it = coordinator.downlinkQueue.erase (it);
+    }
+
+  return announcement;
+}
+
+void FsalohaMac::StartDownlinkSlot (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  CoordinatorState &coordinator = GetCoordinatorState ();
+
+  if (m_activeDCR != CapillaryMac::ACTIVE_START)
+    {
+      return;
+    }
+
+  if (coordinator.downlinkSlot < coordinator.downlinkBurst.size ())
+    {
+      MAC_DEBUG ("Downlink Slot: " << coordinator.downlinkSlot);
+
+      Ptr<Packet> p = coordinator.downlinkBurst[coordinator.downlinkSlot];
+      if (!ForwardDown (p))
+        {
+          m_macTxDropTrace (p);
+        }
+
+      coordinator.downlinkSlot++;
+      Simulator::Schedule (GetSlotDuration (), &FsalohaMac::StartDownlinkSlot, this);
+      return;
+    }
+
+  coordinator.downlinkBurst.clear ();
+  StartFrame ();
+}
+
+void FsalohaMac::SleepDuringDownlink (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  Time slot = GetSlotDuration ();
+  Time switching = m_phy->GetSwitchingTime ();
+  Time downlink = m_downlinkSlots * slot;
+
+  if (!m_downlinkPending)
+    {
+      if (downlink > 2 * switching)
+        {
+          m_phy->ForceSleep ();
+          Simulator::Schedule (downlink - switching, &CapillaryPhy::WakeUp, m_phy);
+        }
+      return;
+    }
+
+  // awake only during the own downlink slot
+  Time before = m_downlinkIndex * slot;
+  if (before > 2 * switching)
+    {
+      m_phy->ForceSleep ();
+      Simulator::Schedule (before - switching, &CapillaryPhy::WakeUp, m_phy);
+    }
+
+  Time after = downlink - before - slot;
+  if (after > 2 * switching)
+    {
+      Simulator::Schedule (before + slot, &CapillaryPhy::ForceSleep, m_phy);
+      Simulator::Schedule (downlink - switching, &CapillaryPhy::WakeUp, m_phy);
+    }
+}
+
 void FsalohaMac::NotifyActivePeriodStopped (void)
 {
   NS_LOG_FUNCTION (this);
@@ -750,6 +1984,7 @@ void FsalohaMac::NotifyActivePeriodStopped (void)
   if (m_activeDCR == CapillaryMac::ACTIVE_START)
     {
       m_activeDCR = CapillaryMac::ACTIVE_STOP;
+      CAPILLARY_TP_DCR_STOP (m_dev->GetNode ()->GetId (), m_nFramesDCR);
 
       if (!stopDCRCallback.IsNull ())
         {
@@ -767,6 +2002,9 @@ void FsalohaMac::NotifyActivePeriodAborted (void)
 
   m_nFrames = m_nFramesDCR;
 
+  // the current packet, acknowledged or not, is sent again in the next DCR
+  m_acked = false;
+
   if (m_activeDCR == CapillaryMac::ACTIVE_START)
     {
       m_activeDCR = CapillaryMac::ACTIVE_ABORT;
@@ -816,16 +2054,127 @@ FsalohaMac::ResetFrame (void)
   NS_LOG_FUNCTION (this);
 
   m_currSlot = 0;
+  m_splitting = (m_splitSlots > 0);
+  m_frameSlots = m_splitting ? m_splitSlots : m_config->nSlots;
+  m_splitSlots = 0;
+  m_backoffWait = false;
 
-  if (m_dev->GetType () == CapillaryNetDevice::END_DEVICE)
+  if (m_dev->GetType () == CapillaryNetDevice::END_DEVICE && m_splitting)
+    {
+      // the splitting frame is on the signalling channel only
+      m_rndChannel = 0;
+      if (m_splitWait)
+        {
+          // past the last slot: asleep up to the FBP
+          m_rndSlot = m_frameSlots;
+        }
+      else
+        {
+          m_rndSlot = m_splitIndex + m_splitKey % m_config->splittingFactor;
+          m_splitKey /= m_config->splittingFactor;
+        }
+      m_replicas.assign (m_splitWait ? 0 : 1, m_rndSlot);
+      MAC_DEBUG ("Splitting Slot: " << m_rndSlot << " of " << m_frameSlots);
+    }
+  else if (m_dev->GetType () == CapillaryNetDevice::END_DEVICE)
+    {
+      uint32_t rnd = 0;
+      uint32_t nFree = m_reservationMap.GetNSlots () - m_reservationMap.GetNReserved ();
+      if (m_reserved && m_reservationConfirmed)
+        {
+          // the slot kept from the previous DCRs
+          rnd = m_reservedIndex;
+        }
+      else if (m_config->alarmSlots > 0 && IsAlarm (m_currentPkt))
+        {
+          // uniform over the alarm slots
+          rnd = m_random->GetInteger (0, std::min<uint32_t> (m_config->alarmSlots, m_config->nSlots) - 1);
+        }
+      else if ((m_config->reservation || m_config->alarmSlots > 0) && nFree > 0)
+        {
+          // uniform over the (channel, slot) pairs left for contention
+          uint32_t free = m_random->GetInteger (0, nFree - 1);
+          for (rnd = 0; m_reservationMap.IsReserved (rnd) || free > 0; rnd++)
+            {
+              if (!m_reservationMap.IsReserved (rnd))
+                {
+                  free--;
+                }
+            }
+        }
+      else
+        {
+          // uniform over the (channel, slot) pairs
+          rnd = m_random->GetInteger ();
+        }
+
+      m_replicas.assign (1, rnd);
+      if (m_config->replicas > 1 && !m_config->reservation && rnd >= m_config->alarmSlots)
+        {
+          // the twins in distinct slots, on any channel but the alarm slots, kept in slot order
+          uint32_t nSlots = m_config->nSlots;
+          if (m_config->nChannels == 1)
+            {
+              nSlots -= std::min<uint32_t> (m_config->alarmSlots, nSlots - 1);
+            }
+          while (m_replicas.size () < std::min<uint32_t> (m_config->replicas, nSlots))
+            {
+              uint32_t twin = m_random->GetInteger ();
+              if (twin < m_config->alarmSlots)
+                {
+                  continue;
+                }
+              std::vector<uint32_t>::iterator it = m_replicas.begin ();
+              while (it != m_replicas.end () && *it % m_config->nSlots < twin % m_config->nSlots)
+                {
+                  it++;
+                }
+              if (it == m_replicas.end () || *it % m_config->nSlots != twin % m_config->nSlots)
+                {
+                  m_replicas.insert (it, twin);
+                }
+            }
+          rnd = m_replicas.front ();
+        }
+
+      m_rndChannel = rnd / m_config->nSlots;
+      m_rndSlot = rnd % m_config->nSlots;
+      MAC_DEBUG ("Random Slot: " << m_rndSlot << ", channel: " << m_rndChannel);
+
+      if (!(m_reserved && m_reservationConfirmed) && Backoff ())
+        {
+          // past the last slot: asleep up to the FBP
+          MAC_DEBUG ("Backoff after " << m_retries << " collisions");
+          m_backoffWait = true;
+          m_replicas.clear ();
+          m_rndChannel = 0;
+          m_rndSlot = m_frameSlots;
+        }
+    }
+  else
     {
-      m_rndSlot = m_random->GetInteger ();
-      MAC_DEBUG ("Random Slot: " << m_rndSlot);
+      // only the coordinator keeps the status of the frame
+      m_slotStatus.assign (m_splitting ? m_frameSlots : m_config->nChannels * m_config->nSlots, EMPTY);
+      CoordinatorState &coordinator = GetCoordinatorState ();
+      coordinator.sic.Clear ();
+      coordinator.sicDecoded.clear ();
+      coordinator.sicDelivered.clear ();
     }
+}
+
+void
+FsalohaMac::SetSlotState (uint16_t channel, SlotState state)
+{
+  NS_LOG_FUNCTION (this << channel << state);
 
-  for (uint32_t i = 0; i < m_slotStatus.size (); i++)
+  uint32_t index = channel * m_config->nSlots + m_currSlot;
+  if (m_splitting && channel != 0)
+    {
+      return;
+    }
+  if (index < m_slotStatus.size ())
     {
-      m_slotStatus[i] = EMPTY;
+      m_slotStatus[index] = state;
     }
 }
 
@@ -852,7 +2201,7 @@ void FsalohaMac::StartFrame (void)
           break;
         }
 
-      Simulator::Schedule (m_maxDelay, &FsalohaMac::StartSlot, this);
+      Simulator::Schedule (m_config->maxDelay, &FsalohaMac::StartSlot, this);
 
       //StartSlot();
     }
@@ -867,16 +2216,27 @@ FsalohaMac::StartSlot (void)
 
   if (m_activeDCR == CapillaryMac::ACTIVE_START)
     {
+      CAPILLARY_TP_SLOT_START (m_dev->GetNode ()->GetId (), m_currSlot);
+
       switch (m_dev->GetType ())
         {
         case CapillaryNetDevice::COORDINATOR:
+          if (m_config->immediateAck)
+            {
+              Simulator::Schedule (m_config->GetAckOffset (m_phy->GetRate ()), &FsalohaMac::SendAck, this);
+            }
           break;
         case CapillaryNetDevice::END_DEVICE:
 
-          if (m_currSlot == m_rndSlot)
+          if (m_currSlot == m_rndSlot && !m_acked)
             {
-              MAC_DEBUG ("TX on Slot: " << m_currSlot);
-              ForwardDown (m_currentPkt);
+              MAC_DEBUG ("TX on Slot: " << m_currSlot << ", channel: " << m_rndChannel);
+              if (m_rndChannel != 0)
+                {
+                  TuneChannel (m_rndChannel);
+                }
+              // a copy, the packet stays as enqueued for its retries
+              ForwardDown (m_currentPkt->Copy ());
             }
           break;
         }
@@ -894,16 +2254,40 @@ FsalohaMac::StopSlot (void)
 
   if (m_activeDCR == CapillaryMac::ACTIVE_START)
     {
+      CAPILLARY_TP_SLOT_STOP (m_dev->GetNode ()->GetId (), m_currSlot);
+
       switch (m_dev->GetType ())
         {
         case CapillaryNetDevice::COORDINATOR:
           break;
         case CapillaryNetDevice::END_DEVICE:
-          if ((m_currSlot == m_rndSlot) && (m_nSlots - 1 - m_rndSlot) * GetSlotDuration () > 2 * m_phy->GetSwitchingTime ())
+          if ((m_currSlot == m_rndSlot) && (m_rndChannel != 0))
             {
-              m_phy->ForceSleep ();
+              // back on the signalling channel for the FBP
+              TuneChannel (0);
+            }
+
+          if (m_currSlot == m_rndSlot)
+            {
+              // up to the next replica, or to the FBP
+              uint16_t next = m_frameSlots;
+              for (uint32_t i = 0; i < m_replicas.size (); i++)
+                {
+                  if (m_replicas[i] % m_config->nSlots > m_currSlot)
+                    {
+                      next = m_replicas[i] % m_config->nSlots;
+                      m_rndChannel = m_replicas[i] / m_config->nSlots;
+                      m_rndSlot = next;
+                      break;
+                    }
+                }
+
+              if ((next - 1 - m_currSlot) * GetSlotDuration () > 2 * m_phy->GetSwitchingTime ())
+                {
+                  m_phy->ForceSleep ();
 
-              Simulator::Schedule ((m_nSlots - 1 - m_rndSlot) * GetSlotDuration () - m_phy->GetSwitchingTime (), &CapillaryPhy::WakeUp, m_phy);
+                  Simulator::Schedule ((next - 1 - m_currSlot) * GetSlotDuration () - m_phy->GetSwitchingTime (), &CapillaryPhy::WakeUp, m_phy);
+                }
             }
           break;
         }
@@ -911,7 +2295,7 @@ FsalohaMac::StopSlot (void)
       m_currSlot++;
 
 
-      if (m_currSlot < m_nSlots)
+      if (m_currSlot < m_frameSlots)
         {
           FsalohaMac::StartSlot ();
         }
@@ -932,7 +2316,7 @@ void FsalohaMac::StopFrame (void)
       switch (m_dev->GetType ())
         {
         case CapillaryNetDevice::COORDINATOR:
-          Simulator::Schedule (m_maxDelay, &FsalohaMac::SendFeedback, this);
+          Simulator::Schedule (m_config->maxDelay, &FsalohaMac::SendFeedback, this);
           break;
         case CapillaryNetDevice::END_DEVICE:
           break;
@@ -955,6 +2339,12 @@ bool FsalohaMac::SendRequestForData (void)
   LlcSnapHeader llc;
   llc.SetType (NetDevice::PACKET_BROADCAST);
   p->AddHeader (llc);
+  if (m_config->reservation || m_config->alarmSlots > 0)
+    {
+      p->AddHeader (BuildReservationMap ());
+    }
+  p->AddHeader (SelectDownlink ());
+  p->AddHeader (FsalohaHeader (m_config->cellId));
 
   p->AddHeader (macHdr);
 
@@ -963,6 +2353,11 @@ bool FsalohaMac::SendRequestForData (void)
       return true;
     }
 
+  // announced again by the next RFD
+  CoordinatorState &coordinator = GetCoordinatorState ();
+  coordinator.downlinkQueue.insert (coordinator.downlinkQueue.begin (), coordinator.downlinkBurst.begin (), coordinator.downlinkBurst.end ());
+  coordinator.downlinkBurst.clear ();
+
   Simulator::Schedule (m_phy->GetSwitchingTime (), &FsalohaMac::WakeUp, this);
   return false;
 }
@@ -979,17 +2374,26 @@ bool FsalohaMac::SendFeedback (void)
   macHdr.SetSrcAddr (Mac64Address::ConvertFrom (GetAddress ()));
   macHdr.SetDstAddr (Mac64Address::ConvertFrom (GetBroadcast ()));
 
+  if (m_config->replicas > 1)
+    {
+      CancelInterference ();
+    }
+
   int length = 0;
 
-  if ((m_nSlots * 2) % 8)
+  uint32_t nStates = m_slotStatus.size ();
+
+  if ((nStates * 2) % 8)
     {
-      length = (m_nSlots * 2 / 8) + 1;
+      length = (nStates * 2 / 8) + 1;
     }
   else
     {
-      length = (m_nSlots * 2 / 8);
+      length = (nStates * 2 / 8);
     }
 
+  m_slotStatusTrace (m_slotStatus);
+
   uint8_t payload[length];
   SerializeFBP (payload, length);
 
@@ -999,11 +2403,140 @@ bool FsalohaMac::SendFeedback (void)
   llc.SetType (NetDevice::PACKET_BROADCAST);
   p->AddHeader (llc);
 
+  FsalohaHeader fsaHdr (m_config->cellId);
+  UpdateSplit (payload, m_config->splittingFactor > 0 ? length : 0, EMPTY);
+  if (m_splitSlots > 0)
+    {
+      fsaHdr.SetFlag (FsalohaHeader::SPLIT);
+    }
+
+  // over once no device collided or announced more packets
+  bool collided = (std::find (m_slotStatus.begin (), m_slotStatus.end (), ERROR) != m_slotStatus.end ());
+  bool received = (std::find (m_slotStatus.begin (), m_slotStatus.end (), OK) != m_slotStatus.end ());
+  if (collided && m_config->backoff == FRAME_SKIP && m_config->splittingFactor == 0)
+    {
+      // the colliding devices may skip up to the window of their retries,
+      // one at most per collided frame of the DCR; with PERSISTENCE there
+      // is no bound to wait for
+      CoordinatorState &coordinator = GetCoordinatorState ();
+      coordinator.collidedFrames++;
+      m_backoffHold = 1u << std::min<uint32_t> (coordinator.collidedFrames, m_config->backoffExponent);
+    }
+  else if (m_backoffHold > 0)
+    {
+      m_backoffHold--;
+    }
+  m_endDCR = !collided && m_backoffHold == 0 && (m_config->nPackets == 1 || !received || GetCoordinatorState ().backlogged.empty ());
+  if (m_endDCR)
+    {
+      fsaHdr.SetFlag (FsalohaHeader::END);
+    }
+  p->AddHeader (fsaHdr);
+
+  p->AddHeader (macHdr);
+
+  return ForwardDown (p);
+}
+
+bool FsalohaMac::SendAck (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  if (m_activeDCR != CapillaryMac::ACTIVE_START)
+    {
+      return false;
+    }
+
+  // one bit per channel, the first channel in the most significant bit
+  uint32_t length = (m_config->nChannels + 7) / 8;
+  uint8_t payload[length];
+  memset (payload, 0x00, length);
+
+  bool received = false;
+  for (uint16_t channel = 0; channel < m_config->nChannels; channel++)
+    {
+      uint32_t index = channel * m_config->nSlots + m_currSlot;
+      if ((m_splitting && channel != 0) || index >= m_slotStatus.size () || m_slotStatus[index] != OK)
+        {
+          continue;
+        }
+      payload[channel / 8] |= 0x80 >> (channel % 8);
+      received = true;
+    }
+
+  if (!received)
+    {
+      return false;
+    }
+
+  MAC_DEBUG ("Try to send ACK");
+
+  CapillaryMacHeader macHdr (CapillaryMacHeader::CAPILLARY_MAC_FBP);
+  macHdr.SetSeqNum (m_SigSeqNum);
+  m_SigSeqNum++;
+  macHdr.SetSrcAddr (Mac64Address::ConvertFrom (GetAddress ()));
+  macHdr.SetDstAddr (Mac64Address::ConvertFrom (GetBroadcast ()));
+
+  Ptr<Packet> p = Create<Packet> (payload, length);
+
+  LlcSnapHeader llc;
+  llc.SetType (NetDevice::PACKET_BROADCAST);
+  p->AddHeader (llc);
+
+  FsalohaHeader fsaHdr (m_config->cellId);
+  fsaHdr.SetFlag (FsalohaHeader::ACK);
+  p->AddHeader (fsaHdr);
+
   p->AddHeader (macHdr);
 
   return ForwardDown (p);
 }
 
+void FsalohaMac::ReceiveAck (Ptr<Packet> p)
+{
+  NS_LOG_FUNCTION (this << p);
+
+  if (m_activeDCR != CapillaryMac::ACTIVE_START || !m_currentPkt || m_acked || m_currSlot != m_rndSlot)
+    {
+      return;
+    }
+
+  uint8_t payload[p->GetSize ()];
+  p->CopyData (payload, p->GetSize ());
+  if (m_rndChannel / 8u >= p->GetSize () || !(payload[m_rndChannel / 8] & (0x80 >> (m_rndChannel % 8))))
+    {
+      return;
+    }
+
+  MAC_DEBUG ("Transmission: [ACK]");
+  m_txOutcomeTrace (OK);
+  NotifyAccessDelay ();
+
+  if (m_config->reservation && !m_splitting)
+    {
+      UpdateOwnReservation (OK);
+    }
+
+  if (DequeueNext ())
+    {
+      // sent from the frame after the FBP
+      m_acked = true;
+    }
+  else
+    {
+      NotifyActivePeriodStopped ();
+    }
+}
+
+void FsalohaMac::TuneChannel (uint16_t channel)
+{
+  NS_LOG_FUNCTION (this << channel);
+
+  Ptr<CapillaryPhyIdeal> phy = DynamicCast<CapillaryPhyIdeal> (m_phy);
+  NS_ASSERT_MSG (phy && channel < phy->GetNChannels (), "The PHY has no channel " << channel);
+  phy->SetCurrentChannel (channel);
+}
+
 bool FsalohaMac::ForwardDown (Ptr<Packet> p)
 {
   NS_LOG_FUNCTION (this);
@@ -1029,8 +2562,39 @@ bool FsalohaMac::ForwardDown (Ptr<Packet> p)
         }
       break;
     case CapillaryNetDevice::END_DEVICE:
-      Time Toff = m_controller->GetOffTime ();
-      macHdr.SetEnergyValue ((uint8_t)Toff.GetSeconds ());
+      {
+        Time Toff = m_controller->GetOffTime ();
+        macHdr.SetEnergyValue ((uint8_t)Toff.GetSeconds ());
+
+        if (currentFrameType == CapillaryMacHeader::CAPILLARY_MAC_DATA)
+          {
+            FsalohaHeader fsaHdr;
+            p->RemoveHeader (fsaHdr);
+            if (m_releaseReservation)
+              {
+                fsaHdr.SetFlag (FsalohaHeader::RELEASE);
+              }
+
+            // the backlog of this DCR
+            fsaHdr.ClearFlag (FsalohaHeader::MORE);
+            if (!m_TxQueue->IsEmpty () || !m_alarmQueue->IsEmpty () || m_preemptedPkt)
+              {
+                fsaHdr.SetFlag (FsalohaHeader::MORE);
+              }
+
+            if (m_replicas.size () > 1)
+              {
+                FsalohaReplicaHeader replicas;
+                for (uint32_t i = 0; i < m_replicas.size (); i++)
+                  {
+                    replicas.AddReplica (m_replicas[i]);
+                  }
+                p->AddHeader (replicas);
+                fsaHdr.SetFlag (FsalohaHeader::REPLICA);
+              }
+            p->AddHeader (fsaHdr);
+          }
+      }
       break;
     }
 
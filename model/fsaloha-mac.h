@@ -24,17 +24,30 @@
 #include <ns3/mac64-address.h>
 #include <ns3/capillary-controller.h>
 #include <ns3/capillary-net-device.h>
+#include <ns3/fsaloha-downlink-header.h>
+#include <ns3/fsaloha-mac-config.h>
+#include <ns3/fsaloha-reservation-header.h>
+#include <ns3/fsaloha-replica-header.h>
+#include <ns3/capillary-sic-buffer.h>
 #include <ns3/nstime.h>
 #include <ns3/ptr.h>
 #include <ns3/queue.h>
 #include <ns3/random-variable-stream.h>
+#include <ns3/simple-ref-count.h>
+#include <ns3/traced-callback.h>
 #include <iostream>
+#include <list>
+#include <map>
+#include <set>
 #include <vector>
 
 
 namespace ns3 {
 
 class CapillaryPhy;
+class CapillaryMacHeader;
+class FsalohaHeader;
+class LlcSnapHeader;
 class Packet;
 
 /*
@@ -50,6 +63,49 @@ public:
     ERROR = 0x02
   } SlotState;
 
+  /**
+   * The backoff of an end device after its collisions, k being the
+   * collisions of the packet bounded by the BackoffExponent:
+   * FRAME_SKIP skips uniform [0, 2^k - 1] frames, PERSISTENCE
+   * contends in a frame with probability 2^-k. A coordinator keeps
+   * the DCR open for the FRAME_SKIP window only.
+   */
+  typedef enum
+  {
+    BACKOFF_NONE,
+    FRAME_SKIP,
+    PERSISTENCE
+  } BackoffPolicy;
+
+  /**
+   * TracedCallback signature for the frame slot status.
+   *
+   * @param status the status of every slot of the frame just ended
+   */
+  typedef void (* SlotStatusTracedCallback)(const std::vector<SlotState> &status);
+
+  /**
+   * TracedCallback signature for the outcome of a transmission.
+   *
+   * @param state the status of the slot used by the device
+   */
+  typedef void (* TxOutcomeTracedCallback)(SlotState state);
+
+  /**
+   * TracedCallback signature for the handover of an end device.
+   *
+   * @param oldCell the cell left
+   * @param newCell the cell joined
+   */
+  typedef void (* CellChangeTracedCallback)(uint16_t oldCell, uint16_t newCell);
+
+  /**
+   * TracedCallback signature for the access delay of a DATA.
+   *
+   * @param delay the time from the queueing to the successful transmission
+   * @param priority the CapillaryPriorityTag::Priority of the DATA
+   */
+  typedef void (* AccessDelayTracedCallback)(Time delay, uint8_t priority);
 
   FsalohaMac ();
   virtual ~FsalohaMac ();
@@ -58,6 +114,81 @@ public:
 
   Time GetSlotDuration (void) const;
   uint16_t GetNSlots (void) const;
+  Time GetMaxDelay (void) const;
+  uint32_t GetNPackets (void) const;
+
+  /**
+   * @return the configuration, shared with the MACs having the same attributes
+   */
+  Ptr<const FsalohaMacConfig> GetConfig (void) const;
+
+  /**
+   * @return the cell of the device
+   */
+  uint16_t GetCellId (void) const;
+
+  /**
+   * @param cellId a cell
+   * @return the smoothed power, in dBm, of the RFD and FBP heard from
+   *         the coordinator of the cell, -inf if none was heard
+   */
+  double GetLinkQuality (uint16_t cellId) const;
+
+  /**
+   * @return the number of channels of a frame
+   */
+  uint16_t GetNChannels (void) const;
+
+  /**
+   * Add a receiver to a coordinator; the i-th receiver added listens on
+   * the channel i + 1, the PHY of the device on the channel 0.
+   *
+   * @param phy the receiver, already tuned on its channel
+   */
+  void AddReceiver (Ptr<CapillaryPhy> phy);
+
+  /**
+   * @return the number of packets waiting in the data queue
+   */
+  uint32_t GetQueueLength (void) const;
+
+  /**
+   * @return the number of packets waiting in the transmission queue
+   */
+  uint32_t GetTxQueueLength (void) const;
+
+  /**
+   * Give back the reserved slot of an end device: the release is
+   * signalled with its next DATA.
+   */
+  void ReleaseReservation (void);
+
+  /**
+   * @return the number of slots reserved in the cell for a coordinator,
+   *         1 if an end device holds a reservation, 0 otherwise
+   */
+  uint32_t GetNReservations (void) const;
+
+  /**
+   * @return the number of packets a coordinator holds for its end devices
+   */
+  uint32_t GetDownlinkQueueLength (void) const;
+
+  /**
+   * @return the number of packets an end device dropped at the retry limit
+   */
+  uint32_t GetNRetryDrops (void) const;
+
+  /**
+   * @return the bytes allocated for the slot status of the device
+   */
+  uint32_t GetSlotStatusSize (void) const;
+
+  /**
+   * @return the bytes of the state kept only by a coordinator, 0 on the
+   *         end devices
+   */
+  uint32_t GetCoordinatorStateSize (void) const;
 
   /** Inherited Methods*/
   virtual void SetDevice (Ptr<NetDevice> d);
@@ -81,6 +212,24 @@ protected:
   virtual void DoDispose (void);
 
   void SetNSlots (const uint16_t nSlots);
+  void SetNChannels (const uint16_t nChannels);
+  void SetMaxDelay (const Time maxDelay);
+  void SetNPackets (const uint32_t nPackets);
+  void SetCellId (const uint16_t cellId);
+  void SetReservation (const bool reservation);
+  bool GetReservation (void) const;
+  void SetSplittingFactor (const uint16_t splittingFactor);
+  uint16_t GetSplittingFactor (void) const;
+  void SetImmediateAck (const bool immediateAck);
+  bool GetImmediateAck (void) const;
+  void SetReplicas (const uint16_t replicas);
+  uint16_t GetReplicas (void) const;
+  void SetAlarmSlots (const uint16_t alarmSlots);
+  uint16_t GetAlarmSlots (void) const;
+  void SetBackoff (const BackoffPolicy backoff);
+  BackoffPolicy GetBackoff (void) const;
+  void SetBackoffExponent (const uint16_t backoffExponent);
+  uint16_t GetBackoffExponent (void) const;
   void SetRandomStream (Ptr<UniformRandomVariable> random);
   Ptr<UniformRandomVariable> GetRandomStream (void) const;
 
@@ -117,8 +266,33 @@ protected:
    */
   void NotifyReceptionEndOk (Ptr<Packet> p);
 
+  /**
+   * Notify the MAC that a receiver finished a reception with an error
+   *
+   * @param channel the channel of the receiver
+   */
+  void NotifyChannelReceptionEndError (uint16_t channel);
+
+  /**
+   * Notify the MAC that a receiver finished a reception successfully
+   *
+   * @param channel the channel of the receiver
+   * @param p the received packet
+   */
+  void NotifyChannelReceptionEndOk (uint16_t channel, Ptr<Packet> p);
+
+  static void ReceiverEndError (FsalohaMac *mac, uint16_t channel);
+  static void ReceiverEndOk (FsalohaMac *mac, uint16_t channel, Ptr<Packet> p);
+
   void SerializeFBP (uint8_t *payload, uint32_t length);
-  void DeserializeFBP (uint8_t *payload, uint32_t length);
+
+  /**
+   * @param payload the FBP payload
+   * @param length the payload length
+   * @param index the (channel, slot) index
+   * @return the status of a single (channel, slot)
+   */
+  SlotState DeserializeFBP (const uint8_t *payload, uint32_t length, uint32_t index) const;
 
   void StartActivePeriod (void);
   void NotifyActivePeriodStopped (void);
@@ -128,6 +302,28 @@ protected:
   void NotifyNonActivePeriodStopped (void);
 
   void ResetFrame (void);
+  void SetSlotState (uint16_t channel, SlotState state);
+
+  FsalohaReservationHeader BuildReservationMap (void) const;
+  void UpdateReservation (uint32_t index, Mac64Address owner, bool release);
+  void CheckReservations (void);
+  void UpdateOwnReservation (SlotState state);
+
+  uint32_t CountFBP (const uint8_t *payload, uint32_t end, SlotState state) const;
+  void UpdateSplit (const uint8_t *payload, uint32_t length, SlotState state);
+
+  SlotState GetOwnState (const uint8_t *payload, uint32_t length) const;
+  void CancelInterference (void);
+  void ReceiveResidual (Ptr<const Packet> signal);
+  void DeliverData (Ptr<Packet> p, const LlcSnapHeader &llc, const CapillaryMacHeader &header, const FsalohaHeader &fsaHdr);
+
+  FsalohaDownlinkHeader SelectDownlink (void);
+  void StartDownlinkSlot (void);
+  void SleepDuringDownlink (void);
+  void SleepFrame (void);
+
+  void UpdateLinkQuality (uint16_t cellId, Mac64Address coordinator);
+  void CheckHandover (uint16_t cellId);
   void StartFrame (void);
   void StopFrame (void);
 
@@ -136,9 +332,30 @@ protected:
 
   bool SendRequestForData (void);
   bool SendFeedback (void);
+  bool SendAck (void);
+  void ReceiveAck (Ptr<Packet> p);
+
+  /**
+   * Take the next DATA of the DCR, the alarms first.
+   *
+   * @return false if there is none
+   */
+  bool DequeueNext (void);
+
+  /**
+   * Put the current routine DATA aside for a waiting alarm.
+   *
+   * @return false if there is no alarm or the current DATA is one
+   */
+  bool PreemptByAlarm (void);
+  bool IsAlarm (Ptr<const Packet> p) const;
+  bool Backoff (void);
+  void NotifyAccessDelay (void);
 
   bool ForwardDown (Ptr<Packet> p);
 
+  void TuneChannel (uint16_t channel);
+
 private:
   Ptr<CapillaryNetDevice> m_dev;
 
@@ -148,27 +365,154 @@ private:
   Ptr<Queue> m_queue;
   Ptr<Queue> m_TxQueue;
 
-  uint32_t m_NPackets;
+  /** The alarms, sent ahead of the routine packets and out of the DCR quota */
+  Ptr<Queue> m_alarmQueue;
+
   Ptr<Packet> m_currentPkt;
 
   Mac64Address m_addr;
+
+  /** The coordinator of the cell, learned from its RFD */
+  Mac64Address m_coordinator;
+
+  struct LinkQuality
+  {
+    Mac64Address coordinator;
+    double rxPower;
+    Time lastHeard;
+  };
+
+  /** The link quality of the cells heard by an end device */
+  std::map<uint16_t, LinkQuality> m_links;
+
+  bool m_handover;
+  double m_linkAlpha;
+  double m_hysteresis;
+  double m_minRxPower;
+  Time m_linkTimeout;
+
   Ptr<CapillaryPhy> m_phy;
   Ptr<UniformRandomVariable> m_random;
 
   uint16_t m_rndSlot;
+  uint16_t m_rndChannel;
   uint16_t m_currSlot;
-  uint16_t m_nSlots;
 
-  uint16_t m_mtu;
+  /** The slots of the current frame: nSlots, or those of a splitting frame */
+  uint16_t m_frameSlots;
+  bool m_splitting;
+
+  /** The slots of the next frame when the last FBP announced a split, 0 otherwise */
+  uint16_t m_splitSlots;
+
+  /** The first sub-slot of an end device in the splitting frame */
+  uint16_t m_splitIndex;
+
+  /** An end device out of the collisions waits for the end of the splitting frames */
+  bool m_splitWait;
+
+  /** The address digits choosing the sub-slot, one per splitting level */
+  uint64_t m_splitKey;
+
+  uint32_t m_retryLimit;
+
+  /** The collisions of the current packet, and the frames still to skip */
+  uint32_t m_retries;
+  uint32_t m_backoffFrames;
+
+  /** A routine packet preempted by an alarm, sent first after it with its collisions */
+  Ptr<Packet> m_preemptedPkt;
+  uint32_t m_preemptedRetries;
+
+  /** An end device out of the contention of the current frame */
+  bool m_backoffWait;
+  uint32_t m_nRetryDrops;
+
+  /** The configuration shared by the cell */
+  Ptr<const FsalohaMacConfig> m_config;
+
+  /** The DATA of a coordinator waiting for an RFD, and the slots of a burst */
+  uint32_t m_downlinkQueueSize;
+  uint16_t m_maxDownlinkSlots;
+
+  /** The downlink slots announced to an end device, and its own one */
+  uint16_t m_downlinkSlots;
+  bool m_downlinkPending;
+  uint16_t m_downlinkIndex;
+
+  /** The frames a coordinator keeps the DCR open for the end devices backing off */
+  uint32_t m_backoffHold;
+
+  /** The (channel, slot) indices of the copies of an end device DATA, by slot */
+  std::vector<uint32_t> m_replicas;
+
+  /** An end device acknowledged in its slot, waiting for the FBP to go on */
+  bool m_acked;
+
+  /** Whether the last FBP of a coordinator ends the DCR */
+  bool m_endDCR;
+
+  /** The empty DCRs in a row a reserved slot survives */
+  uint32_t m_maxMissedDcrs;
+
+  /** The reserved slot of an end device, confirmed by the last RFD */
+  bool m_reserved;
+  uint32_t m_reservedIndex;
+  bool m_reservationConfirmed;
+  bool m_releaseReservation;
+
+  /** The reservation map of the last RFD heard by an end device */
+  FsalohaReservationHeader m_reservationMap;
+
+  /**
+   * The state only a coordinator keeps, allocated on its first DCR,
+   * DATA or receiver, so that the end devices do not carry it.
+   */
+  struct CoordinatorState : public SimpleRefCount<CoordinatorState>
+  {
+    CoordinatorState ();
+
+    /** The DATA waiting for an RFD, and those announced by the last one, one per downlink slot */
+    std::list<Ptr<Packet> > downlinkQueue;
+    std::vector<Ptr<Packet> > downlinkBurst;
+    uint16_t downlinkSlot;
+
+    /** The end devices announcing more packets in the DCR */
+    std::set<Mac64Address> backlogged;
+
+    /** The frames with collisions in the DCR, a bound on the retries of the colliders */
+    uint32_t collidedFrames;
+
+    /** The collided slots of the frame */
+    CapillarySicBuffer sic;
+
+    /** The replicas decoded in the frame, still to cancel from their twins */
+    std::vector<std::pair<uint64_t, FsalohaReplicaHeader> > sicDecoded;
+    std::set<uint64_t> sicDelivered;
+
+    /** The owner of every reserved (channel, slot), and the empty DCRs it missed */
+    std::map<uint32_t, Mac64Address> reservations;
+    std::map<uint32_t, uint32_t> missedDcrs;
+
+    /** The receivers of the channels 1..K-1 */
+    std::vector<Ptr<CapillaryPhy> > receivers;
+  };
+
+  /**
+   * @return the state of the coordinator, allocated on the first call
+   */
+  CoordinatorState & GetCoordinatorState (void);
+
+  Ptr<CoordinatorState> m_coordinatorState;
+
   uint8_t m_SigSeqNum;
   uint8_t m_DataSeqNum;
 
-  Time m_maxDelay;
-
   Time m_startFrame;
 
   Time m_nextDCR;
 
+  /** The status of every (channel, slot), channel major; coordinator only */
   std::vector<SlotState> m_slotStatus;
 
   /** Controller */
@@ -182,6 +526,18 @@ private:
 
   /** Trace*/
   TracedValue<int> m_nFrames;
+
+  /** The slots status of a frame, fired by the coordinator before the FBP */
+  TracedCallback<const std::vector<SlotState> &> m_slotStatusTrace;
+
+  /** The outcome of a transmission, fired by an end device on the FBP */
+  TracedCallback<SlotState> m_txOutcomeTrace;
+
+  /** The handovers of an end device */
+  TracedCallback<uint16_t, uint16_t> m_cellChangeTrace;
+
+  /** The access delay of a DATA, fired by an end device on its success */
+  TracedCallback<Time, uint8_t> m_accessDelayTrace;
 };
 
 std::ostream& operator<< (std::ostream& os, std::vector<FsalohaMac::SlotState> states);
@@ -0,0 +1,116 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include "fsaloha-replica-header.h"
+
+#include <ns3/assert.h>
+#include <ns3/log.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("FsalohaReplicaHeader");
+
+NS_OBJECT_ENSURE_REGISTERED (FsalohaReplicaHeader);
+
+FsalohaReplicaHeader::FsalohaReplicaHeader ()
+{
+}
+
+FsalohaReplicaHeader::~FsalohaReplicaHeader ()
+{
+}
+
+TypeId
+FsalohaReplicaHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::FsalohaReplicaHeader")
+    .SetParent<Header> ()
+    .SetGroupName ("m2m-capillary")
+    .AddConstructor<FsalohaReplicaHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+FsalohaReplicaHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+void
+FsalohaReplicaHeader::AddReplica (uint32_t index)
+{
+  NS_ASSERT (m_replicas.size () < 0xff);
+  NS_ASSERT (index <= 0xffff);
+  m_replicas.push_back (index);
+}
+
+uint32_t
+FsalohaReplicaHeader::GetNReplicas (void) const
+{
+  return m_replicas.size ();
+}
+
+uint32_t
+FsalohaReplicaHeader::GetReplica (uint32_t i) const
+{
+  NS_ASSERT (i < m_replicas.size ());
+  return m_replicas[i];
+}
+
+void
+FsalohaReplicaHeader::Print (std::ostream &os) const
+{
+  os << "replicas=" << m_replicas.size ();
+  for (uint32_t i = 0; i < m_replicas.size (); i++)
+    {
+      os << " " << m_replicas[i];
+    }
+}
+
+uint32_t
+FsalohaReplicaHeader::GetSerializedSize (void) const
+{
+  return 1 + 2 * m_replicas.size ();
+}
+
+void
+FsalohaReplicaHeader::Serialize (Buffer::Iterator start) const
+{
+  start.WriteU8 (m_replicas.size ());
+  for (uint32_t i = 0; i < m_replicas.size (); i++)
+    {
+      start.WriteHtonU16 (m_replicas[i]);
+    }
+}
+
+uint32_t
+FsalohaReplicaHeader::Deserialize (Buffer::Iterator start)
+{
+  uint8_t n = start.ReadU8 ();
+  m_replicas.resize (n);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      m_replicas[i] = start.ReadNtohU16 ();
+    }
+  return GetSerializedSize ();
+}
+
+} /* namespace ns3 */
@@ -0,0 +1,71 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+#ifndef MODEL_FSALOHA_REPLICA_HEADER_H_
+#define MODEL_FSALOHA_REPLICA_HEADER_H_
+
+#include <ns3/header.h>
+#include <stdint.h>
+#include <iostream>
+#include <vector>
+
+namespace ns3 {
+
+/*
+ * Replica pointers, carried by a DATA sent in several slots of a frame
+ * right after the FsalohaHeader (flag REPLICA).
+ *
+ * It lists the (channel, slot) indices of all the replicas of the
+ * packet, so that a coordinator decoding one of them can cancel the
+ * others from their slots.
+ */
+class FsalohaReplicaHeader : public Header
+{
+public:
+  FsalohaReplicaHeader ();
+  virtual ~FsalohaReplicaHeader ();
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  /**
+   * @param index the channel * nSlots + slot index of a replica
+   */
+  void AddReplica (uint32_t index);
+
+  uint32_t GetNReplicas (void) const;
+
+  /**
+   * @param i the replica, in [0, GetNReplicas ())
+   * @return the channel * nSlots + slot index of the replica
+   */
+  uint32_t GetReplica (uint32_t i) const;
+
+  virtual void Print (std::ostream &os) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+
+private:
+  std::vector<uint32_t> m_replicas;
+};
+
+} /* namespace ns3 */
+
+#endif /* MODEL_FSALOHA_REPLICA_HEADER_H_ */
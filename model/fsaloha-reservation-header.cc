@@ -0,0 +1,163 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+
+#include "fsaloha-reservation-header.h"
+
+#include <ns3/address-utils.h>
+#include <ns3/assert.h>
+#include <ns3/log.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("FsalohaReservationHeader");
+
+NS_OBJECT_ENSURE_REGISTERED (FsalohaReservationHeader);
+
+FsalohaReservationHeader::FsalohaReservationHeader ()
+  : m_nSlots (0)
+{
+}
+
+FsalohaReservationHeader::FsalohaReservationHeader (uint32_t nSlots)
+  : m_nSlots (nSlots),
+  m_bitmap ((nSlots + 7) / 8, 0)
+{
+}
+
+FsalohaReservationHeader::~FsalohaReservationHeader ()
+{
+}
+
+TypeId
+FsalohaReservationHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::FsalohaReservationHeader")
+    .SetParent<Header> ()
+    .SetGroupName ("m2m-capillary")
+    .AddConstructor<FsalohaReservationHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+FsalohaReservationHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+FsalohaReservationHeader::GetNSlots (void) const
+{
+  return m_nSlots;
+}
+
+void
+FsalohaReservationHeader::SetReserved (uint32_t index)
+{
+  NS_ASSERT (index < m_nSlots);
+  m_bitmap[index / 8] |= 0x80 >> (index % 8);
+}
+
+bool
+FsalohaReservationHeader::IsReserved (uint32_t index) const
+{
+  if (index >= m_nSlots)
+    {
+      return false;
+    }
+  return (m_bitmap[index / 8] & (0x80 >> (index % 8))) != 0;
+}
+
+void
+FsalohaReservationHeader::SetReserved (uint32_t index, Mac64Address owner)
+{
+  SetReserved (index);
+  m_owners[index] = owner;
+}
+
+bool
+FsalohaReservationHeader::IsReservedTo (uint32_t index, Mac64Address owner) const
+{
+  std::map<uint32_t, Mac64Address>::const_iterator it = m_owners.find (index);
+  return IsReserved (index) && it != m_owners.end () && it->second == owner;
+}
+
+uint32_t
+FsalohaReservationHeader::GetNReserved (void) const
+{
+  uint32_t n = 0;
+  for (uint32_t i = 0; i < m_nSlots; i++)
+    {
+      if (IsReserved (i))
+        {
+          n++;
+        }
+    }
+  return n;
+}
+
+void
+FsalohaReservationHeader::Print (std::ostream &os) const
+{
+  os << "reserved=" << GetNReserved () << "/" << m_nSlots;
+}
+
+uint32_t
+FsalohaReservationHeader::GetSerializedSize (void) const
+{
+  return 4 + m_bitmap.size () + 2 + (4 + 8) * m_owners.size ();
+}
+
+void
+FsalohaReservationHeader::Serialize (Buffer::Iterator start) const
+{
+  start.WriteHtonU32 (m_nSlots);
+  for (uint32_t i = 0; i < m_bitmap.size (); i++)
+    {
+      start.WriteU8 (m_bitmap[i]);
+    }
+  start.WriteHtonU16 (m_owners.size ());
+  for (std::map<uint32_t, Mac64Address>::const_iterator it = m_owners.begin (); it != m_owners.end (); it++)
+    {
+      start.WriteHtonU32 (it->first);
+      WriteTo (start, it->second);
+    }
+}
+
+uint32_t
+FsalohaReservationHeader::Deserialize (Buffer::Iterator start)
+{
+  m_nSlots = start.ReadNtohU32 ();
+  m_bitmap.resize ((m_nSlots + 7) / 8);
+  for (uint32_t i = 0; i < m_bitmap.size (); i++)
+    {
+      m_bitmap[i] = start.ReadU8 ();
+    }
+  m_owners.clear ();
+  uint16_t nOwners = start.ReadNtohU16 ();
+  for (uint16_t i = 0; i < nOwners; i++)
+    {
+      uint32_t index = start.ReadNtohU32 ();
+      ReadFrom (start, m_owners[index]);
+    }
+  return GetSerializedSize ();
+}
+
+} /* namespace ns3 */
@@ -0,0 +1,91 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 Universita' Mediterranea di Reggio Calabria (UNIRC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Orazio Briante <orazio.briante@unirc.it>
+ */
+#ifndef MODEL_FSALOHA_RESERVATION_HEADER_H_
+#define MODEL_FSALOHA_RESERVATION_HEADER_H_
+
+#include <ns3/header.h>
+#include <ns3/mac64-address.h>
+#include <stdint.h>
+#include <iostream>
+#include <map>
+#include <vector>
+
+namespace ns3 {
+
+/*
+ * Reservation map, carried by the RFD of the cells in reservation mode,
+ * right after the downlink announcement.
+ *
+ * One bit for each (channel, slot) of the frame, channel major: a set
+ * bit is a slot kept by the device that last succeeded in it, the
+ * others are left for contention. The bitmap is followed by the owner
+ * of each kept slot, so that a device only confirms its own.
+ */
+class FsalohaReservationHeader : public Header
+{
+public:
+  FsalohaReservationHeader ();
+
+  /**
+   * @param nSlots the number of (channel, slot) pairs of the frame
+   */
+  FsalohaReservationHeader (uint32_t nSlots);
+  virtual ~FsalohaReservationHeader ();
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  uint32_t GetNSlots (void) const;
+
+  void SetReserved (uint32_t index);
+  bool IsReserved (uint32_t index) const;
+
+  /**
+   * @param index the channel * slots + slot index
+   * @param owner the device the slot is kept for
+   */
+  void SetReserved (uint32_t index, Mac64Address owner);
+
+  /**
+   * @param index the channel * slots + slot index
+   * @param owner the device to check
+   * @return true if the slot is kept for owner
+   */
+  bool IsReservedTo (uint32_t index, Mac64Address owner) const;
+
+  /**
+   * @return the number of reserved slots
+   */
+  uint32_t GetNReserved (void) const;
+
+  virtual void Print (std::ostream &os) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+
+private:
+  uint32_t m_nSlots;
+  std::vector<uint8_t> m_bitmap;
+  std::map<uint32_t, Mac64Address> m_owners;
+};
+
+} /* namespace ns3 */
+
+#endif /* MODEL_FSALOHA_RESERVATION_HEADER_H_ */
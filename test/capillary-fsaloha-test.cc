@@ -18,7 +18,14 @@
  * Author: Orazio Briante <orazio.briante@unirc.it>
  */
 
+#include <algorithm>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#ifdef ENABLE_ZLIB
+#include <zlib.h>
+#endif
 
 #include <ns3/core-module.h>
 #include <ns3/mobility-module.h>
@@ -200,6 +207,2071 @@ void CapillaryFsalohaTestCase::DoRun (void)
   NS_LOG_UNCOND ("Stop.");
 }
 
+// ==============================================================================
+class CapillaryBinaryTraceTestCase : public TestCase
+{
+public:
+  CapillaryBinaryTraceTestCase ();
+  virtual ~CapillaryBinaryTraceTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+};
+
+CapillaryBinaryTraceTestCase::CapillaryBinaryTraceTestCase () :
+  TestCase ("Test the binary trace writer and reader")
+{
+}
+
+CapillaryBinaryTraceTestCase::~CapillaryBinaryTraceTestCase ()
+{
+}
+
+void CapillaryBinaryTraceTestCase::DoRun (void)
+{
+  std::string fileName = CreateTempDirFilename ("capillary-binary-trace.bin");
+  uint32_t nRecords = 5;
+
+  {
+    // two full blocks and a partial one written by the destructor
+    Ptr<CapillaryBinaryTraceWriter> writer = Create<CapillaryBinaryTraceWriter> (fileName, 2);
+    for (uint32_t i = 0; i < nRecords; i++)
+      {
+        CapillaryTraceRecord record;
+        record.time = 1000 * i;
+        record.node = i;
+        record.event = CapillaryTraceRecord::REMAINING_ENERGY;
+        record.value = 0.5 * i;
+        writer->Write (record);
+      }
+  }
+
+  CapillaryBinaryTraceReader reader (fileName);
+  NS_TEST_ASSERT_MSG_EQ (reader.IsValid (), true, "Invalid trace file header");
+  NS_TEST_ASSERT_MSG_EQ (reader.GetTicksPerSecond (), Seconds (1).GetTimeStep (), "Wrong time resolution");
+
+  std::vector<CapillaryTraceRecord> records;
+  uint32_t nBlocks = 0;
+  uint32_t read = 0;
+  while (reader.ReadBlock (records))
+    {
+      for (size_t i = 0; i < records.size (); i++, read++)
+        {
+          NS_TEST_ASSERT_MSG_EQ (records[i].time, (int64_t)(1000 * read), "Wrong time column");
+          NS_TEST_ASSERT_MSG_EQ (records[i].node, read, "Wrong node column");
+          NS_TEST_ASSERT_MSG_EQ (records[i].event, CapillaryTraceRecord::REMAINING_ENERGY, "Wrong event column");
+          NS_TEST_ASSERT_MSG_EQ_TOL (records[i].value, 0.5 * read, 1e-9, "Wrong value column");
+        }
+      nBlocks++;
+    }
+
+  NS_TEST_ASSERT_MSG_EQ (nBlocks, 3, "Wrong number of blocks");
+  NS_TEST_ASSERT_MSG_EQ (read, nRecords, "Wrong number of records");
+}
+
+// ==============================================================================
+class CapillaryAsyncTraceTestCase : public TestCase
+{
+public:
+  CapillaryAsyncTraceTestCase ();
+  virtual ~CapillaryAsyncTraceTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+};
+
+CapillaryAsyncTraceTestCase::CapillaryAsyncTraceTestCase () :
+  TestCase ("Test the asynchronous trace writer past its ring capacity")
+{
+}
+
+CapillaryAsyncTraceTestCase::~CapillaryAsyncTraceTestCase ()
+{
+}
+
+void CapillaryAsyncTraceTestCase::DoRun (void)
+{
+  std::string fileName = CreateTempDirFilename ("capillary-async-trace.bin");
+  uint32_t nRecords = 1000;
+
+  // a ring of 4 records: the producer waits for the consumer many times
+  Ptr<CapillaryAsyncTraceWriter> writer = Create<CapillaryAsyncTraceWriter> (Create<CapillaryBinaryTraceWriter> (fileName, 64), 4);
+  for (uint32_t i = 0; i < nRecords; i++)
+    {
+      CapillaryTraceRecord record;
+      record.time = i;
+      record.node = i;
+      record.event = CapillaryTraceRecord::REMAINING_ENERGY;
+      record.value = i;
+      writer->Write (record);
+    }
+  writer->Flush ();
+
+  // everything is on the file before the writer is gone
+  CapillaryBinaryTraceReader reader (fileName);
+  NS_TEST_ASSERT_MSG_EQ (reader.IsValid (), true, "Invalid trace file header");
+
+  std::vector<CapillaryTraceRecord> records;
+  uint32_t read = 0;
+  while (reader.ReadBlock (records))
+    {
+      for (size_t i = 0; i < records.size (); i++, read++)
+        {
+          NS_TEST_ASSERT_MSG_EQ (records[i].node, read, "Record out of order");
+        }
+    }
+  NS_TEST_ASSERT_MSG_EQ (read, nRecords, "Wrong number of records");
+
+  writer = 0;
+}
+
+// ==============================================================================
+class CapillaryCompressedStreamTestCase : public TestCase
+{
+public:
+  CapillaryCompressedStreamTestCase ();
+  virtual ~CapillaryCompressedStreamTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  static void WriteLastLine (Ptr<OutputStreamWrapper> stream);
+};
+
+CapillaryCompressedStreamTestCase::CapillaryCompressedStreamTestCase () :
+  TestCase ("Test the compressed stream keeps the writes of the destroy events")
+{
+}
+
+CapillaryCompressedStreamTestCase::~CapillaryCompressedStreamTestCase ()
+{
+}
+
+void CapillaryCompressedStreamTestCase::WriteLastLine (Ptr<OutputStreamWrapper> stream)
+{
+  *stream->GetStream () << "last" << std::endl;
+}
+
+void CapillaryCompressedStreamTestCase::DoRun (void)
+{
+  std::string fileName = CreateTempDirFilename ("capillary-compressed.txt");
+  uint32_t nLines = 100;
+
+  CapillaryLogHelper logger;
+  Ptr<OutputStreamWrapper> stream = logger.CreateCompressedFileStream (fileName, 64);
+  for (uint32_t i = 0; i < nLines; i++)
+    {
+      *stream->GetStream () << "line " << i << std::endl;
+    }
+
+  // a final flush scheduled after the stream, like the energy downsamplers
+  Simulator::ScheduleDestroy (&CapillaryCompressedStreamTestCase::WriteLastLine, stream);
+  Simulator::Destroy ();
+
+  std::vector<std::string> lines;
+#ifdef ENABLE_ZLIB
+  gzFile file = gzopen ((fileName + ".gz").c_str (), "rb");
+  NS_TEST_ASSERT_MSG_NE (file, (gzFile) 0, "Compressed file not found");
+  char line[64];
+  while (gzgets (file, line, sizeof (line)) != 0)
+    {
+      lines.push_back (std::string (line, std::strlen (line) - 1));
+    }
+  gzclose (file);
+#else
+  std::ifstream file (fileName.c_str ());
+  std::string line;
+  while (std::getline (file, line))
+    {
+      lines.push_back (line);
+    }
+#endif
+
+  NS_TEST_ASSERT_MSG_EQ (lines.size (), nLines + 1, "Wrong number of lines");
+  NS_TEST_ASSERT_MSG_EQ (lines.front (), "line 0", "Wrong first line");
+  NS_TEST_ASSERT_MSG_EQ (lines.back (), "last", "Final flush lost");
+}
+
+// ==============================================================================
+class CapillaryStatsTestCase : public TestCase
+{
+public:
+  CapillaryStatsTestCase ();
+  virtual ~CapillaryStatsTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+};
+
+CapillaryStatsTestCase::CapillaryStatsTestCase () :
+  TestCase ("Test the streaming statistics and the quantile sketch")
+{
+}
+
+CapillaryStatsTestCase::~CapillaryStatsTestCase ()
+{
+}
+
+void CapillaryStatsTestCase::DoRun (void)
+{
+  CapillaryRunningStats stats;
+  CapillaryQuantileSketch sketch (1e-3, 1e3, 512);
+
+  for (uint32_t i = 1; i <= 1000; i++)
+    {
+      stats.Add (i);
+      sketch.Add (i);
+    }
+
+  NS_TEST_ASSERT_MSG_EQ (stats.GetCount (), 1000, "Wrong number of samples");
+  NS_TEST_ASSERT_MSG_EQ_TOL (stats.GetMean (), 500.5, 1e-9, "Wrong mean");
+  NS_TEST_ASSERT_MSG_EQ_TOL (stats.GetVariance (), 83416.6667, 1e-3, "Wrong variance");
+  NS_TEST_ASSERT_MSG_EQ_TOL (stats.GetMin (), 1, 1e-9, "Wrong minimum");
+  NS_TEST_ASSERT_MSG_EQ_TOL (stats.GetMax (), 1000, 1e-9, "Wrong maximum");
+
+  // bucket width is exp(ln(1e6) / 512) - 1, about 2.7%
+  NS_TEST_ASSERT_MSG_EQ_TOL (sketch.GetQuantile (0.5), 500, 500 * 0.03, "Wrong median");
+  NS_TEST_ASSERT_MSG_EQ_TOL (sketch.GetQuantile (0.9), 900, 900 * 0.03, "Wrong 90th percentile");
+  NS_TEST_ASSERT_MSG_EQ_TOL (sketch.GetQuantile (0.99), 990, 990 * 0.03, "Wrong 99th percentile");
+}
+
+// ==============================================================================
+class CapillaryTraceContextTestCase : public TestCase
+{
+public:
+  CapillaryTraceContextTestCase ();
+  virtual ~CapillaryTraceContextTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+};
+
+CapillaryTraceContextTestCase::CapillaryTraceContextTestCase () :
+  TestCase ("Test the numeric trace context")
+{
+}
+
+CapillaryTraceContextTestCase::~CapillaryTraceContextTestCase ()
+{
+}
+
+void CapillaryTraceContextTestCase::DoRun (void)
+{
+  std::ostringstream oss;
+
+  oss << CapillaryTraceContext (12, 0, CapillaryTraceContext::DCR_STATUS);
+  NS_TEST_ASSERT_MSG_EQ (oss.str (), "/NodeList/12/DeviceList/0/$ns3::CapillaryNetDevice/Mac/DcrStatus", "Wrong device context");
+
+  oss.str ("");
+  oss << CapillaryTraceContext (7, CapillaryTraceContext::NO_DEVICE, CapillaryTraceContext::REMAINING_ENERGY);
+  NS_TEST_ASSERT_MSG_EQ (oss.str (), "/NodeList/7/$ns3::EnergySource/RemainingEnergy", "Wrong node context");
+}
+
+// ==============================================================================
+class CapillaryEnergyDownsamplerTestCase : public TestCase
+{
+public:
+  CapillaryEnergyDownsamplerTestCase ();
+  virtual ~CapillaryEnergyDownsamplerTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+};
+
+CapillaryEnergyDownsamplerTestCase::CapillaryEnergyDownsamplerTestCase () :
+  TestCase ("Test the buckets and the threshold of the energy downsampler")
+{
+}
+
+CapillaryEnergyDownsamplerTestCase::~CapillaryEnergyDownsamplerTestCase ()
+{
+}
+
+void CapillaryEnergyDownsamplerTestCase::DoRun (void)
+{
+  std::ostringstream oss;
+  CapillaryTraceContext context (7, CapillaryTraceContext::NO_DEVICE, CapillaryTraceContext::REMAINING_ENERGY);
+  Ptr<CapillaryEnergyDownsampler> downsampler = Create<CapillaryEnergyDownsampler> (Create<OutputStreamWrapper> (&oss), context, Seconds (1), 0.05);
+
+  // two samples in the first bucket, one within the threshold in the second
+  Simulator::Schedule (MilliSeconds (100), &CapillaryEnergyDownsampler::Sink, downsampler, 0.0, 10.0);
+  Simulator::Schedule (MilliSeconds (500), &CapillaryEnergyDownsampler::Sink, downsampler, 10.0, 8.0);
+  Simulator::Schedule (MilliSeconds (1200), &CapillaryEnergyDownsampler::Sink, downsampler, 8.0, 7.99);
+  Simulator::Schedule (MilliSeconds (2300), &CapillaryEnergyDownsampler::Sink, downsampler, 7.99, 5.0);
+  Simulator::Run ();
+  downsampler->Flush ();
+  Simulator::Destroy ();
+
+  std::ostringstream expected;
+  expected << "* 0 " << context << " 8 8 10 9 2\n"
+           << "* 2 " << context << " 5 5 5 5 1\n";
+  NS_TEST_ASSERT_MSG_EQ (oss.str (), expected.str (), "Wrong downsampled trace");
+}
+
+// ==============================================================================
+class CapillaryFsalohaHeaderTestCase : public TestCase
+{
+public:
+  CapillaryFsalohaHeaderTestCase ();
+  virtual ~CapillaryFsalohaHeaderTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+};
+
+CapillaryFsalohaHeaderTestCase::CapillaryFsalohaHeaderTestCase () :
+  TestCase ("Test the FSA and relay headers serialization")
+{
+}
+
+CapillaryFsalohaHeaderTestCase::~CapillaryFsalohaHeaderTestCase ()
+{
+}
+
+void CapillaryFsalohaHeaderTestCase::DoRun (void)
+{
+  Ptr<Packet> p = Create<Packet> (10);
+  FsalohaHeader fsaHdr (0xbeef);
+  fsaHdr.SetFlag (FsalohaHeader::RELEASE);
+  fsaHdr.SetFlag (FsalohaHeader::MORE);
+  fsaHdr.ClearFlag (FsalohaHeader::MORE);
+  p->AddHeader (fsaHdr);
+  NS_TEST_ASSERT_MSG_EQ (p->GetSize (), 13, "Wrong packet size");
+
+  FsalohaHeader header;
+  p->RemoveHeader (header);
+  NS_TEST_ASSERT_MSG_EQ (header.GetCellId (), 0xbeef, "Wrong cell id");
+  NS_TEST_ASSERT_MSG_EQ (header.IsFlagSet (FsalohaHeader::RELEASE), true, "Wrong flags");
+  NS_TEST_ASSERT_MSG_EQ (header.IsFlagSet (FsalohaHeader::MORE), false, "Wrong flags");
+  NS_TEST_ASSERT_MSG_EQ (p->GetSize (), 10, "Wrong payload size");
+
+  // relay record
+  Ptr<Packet> record = Create<Packet> (5);
+  record->AddHeader (CapillaryAggregateHeader (Mac64Address ("00:00:00:00:00:00:00:2a"), MilliSeconds (1500), 5));
+
+  CapillaryAggregateHeader aggregate;
+  record->RemoveHeader (aggregate);
+  NS_TEST_ASSERT_MSG_EQ (aggregate.GetSource (), Mac64Address ("00:00:00:00:00:00:00:2a"), "Wrong source");
+  NS_TEST_ASSERT_MSG_EQ (aggregate.GetTimestamp (), MilliSeconds (1500), "Wrong timestamp");
+  NS_TEST_ASSERT_MSG_EQ (aggregate.GetLength (), record->GetSize (), "Wrong length");
+
+  // downlink announcement
+  FsalohaDownlinkHeader announcement;
+  announcement.AddDestination (Mac64Address ("00:00:00:00:00:00:00:01"));
+  announcement.AddDestination (Mac64Address ("00:00:00:00:00:00:00:02"));
+  Ptr<Packet> rfd = Create<Packet> (1);
+  rfd->AddHeader (announcement);
+  NS_TEST_ASSERT_MSG_EQ (rfd->GetSize (), 1 + 1 + 2 * 8, "Wrong RFD size");
+
+  FsalohaDownlinkHeader downlink;
+  rfd->RemoveHeader (downlink);
+  uint16_t slot = 0;
+  NS_TEST_ASSERT_MSG_EQ (downlink.GetNSlots (), 2, "Wrong number of downlink slots");
+  NS_TEST_ASSERT_MSG_EQ (downlink.GetSlot (Mac64Address ("00:00:00:00:00:00:00:02"), slot), true, "Destination not announced");
+  NS_TEST_ASSERT_MSG_EQ (slot, 1, "Wrong downlink slot");
+  NS_TEST_ASSERT_MSG_EQ (downlink.GetSlot (Mac64Address ("00:00:00:00:00:00:00:03"), slot), false, "Destination announced");
+
+  // reservation map
+  FsalohaReservationHeader map (20);
+  map.SetReserved (3);
+  map.SetReserved (17, Mac64Address ("00:00:00:00:00:00:00:05"));
+  Ptr<Packet> reserved = Create<Packet> ();
+  reserved->AddHeader (map);
+  NS_TEST_ASSERT_MSG_EQ (reserved->GetSize (), 4 + 3 + 2 + 4 + 8, "Wrong reservation map size");
+
+  FsalohaReservationHeader reservations;
+  reserved->RemoveHeader (reservations);
+  NS_TEST_ASSERT_MSG_EQ (reservations.GetNSlots (), 20, "Wrong number of slots");
+  NS_TEST_ASSERT_MSG_EQ (reservations.GetNReserved (), 2, "Wrong number of reserved slots");
+  NS_TEST_ASSERT_MSG_EQ (reservations.IsReserved (17), true, "Slot not reserved");
+  NS_TEST_ASSERT_MSG_EQ (reservations.IsReserved (4), false, "Slot reserved");
+  NS_TEST_ASSERT_MSG_EQ (reservations.IsReservedTo (17, Mac64Address ("00:00:00:00:00:00:00:05")), true, "Wrong slot owner");
+  NS_TEST_ASSERT_MSG_EQ (reservations.IsReservedTo (17, Mac64Address ("00:00:00:00:00:00:00:06")), false, "Slot kept for another device");
+  NS_TEST_ASSERT_MSG_EQ (reservations.IsReservedTo (3, Mac64Address ("00:00:00:00:00:00:00:05")), false, "Slot without owner");
+
+  // priority tag, kept by the copies
+  CapillaryPriorityTag alarm (CapillaryPriorityTag::ALARM);
+  alarm.SetEnqueueTime (MilliSeconds (250));
+  Ptr<Packet> data = Create<Packet> (4);
+  data->AddPacketTag (alarm);
+
+  CapillaryPriorityTag tag;
+  NS_TEST_ASSERT_MSG_EQ (data->Copy ()->PeekPacketTag (tag), true, "Priority tag lost");
+  NS_TEST_ASSERT_MSG_EQ (tag.GetPriority (), CapillaryPriorityTag::ALARM, "Wrong priority");
+  NS_TEST_ASSERT_MSG_EQ (tag.GetEnqueueTime (), MilliSeconds (250), "Wrong enqueue time");
+  NS_TEST_ASSERT_MSG_EQ (data->GetSize (), 4, "Wrong packet size");
+}
+
+// ==============================================================================
+class CapillaryMemoryBudgetTestCase : public TestCase
+{
+public:
+  CapillaryMemoryBudgetTestCase ();
+  virtual ~CapillaryMemoryBudgetTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+};
+
+CapillaryMemoryBudgetTestCase::CapillaryMemoryBudgetTestCase () :
+  TestCase ("Test the per device memory budget")
+{
+  SetDataDir (NS_TEST_SOURCEDIR);
+}
+
+CapillaryMemoryBudgetTestCase::~CapillaryMemoryBudgetTestCase ()
+{
+}
+
+void CapillaryMemoryBudgetTestCase::DoRun (void)
+{
+  // the sizes on LP64 plus a small headroom: raise them only for
+  // intended growth, with capillary-memory-reference.txt
+  const uint64_t macBudget = 504;
+  const uint64_t phyBudget = 704;
+
+  uint32_t nDevices = 4;
+  uint32_t nSlots = 16;
+
+  SpectrumChannelHelper channelHelper = SpectrumChannelHelper::Default ();
+  WifiSpectrumValue5MhzFactory sf;
+
+  CapillaryNetDeviceHelper deviceHelper = CapillaryNetDeviceHelper ();
+  deviceHelper.SetChannel (channelHelper.Create ());
+  deviceHelper.SetTxPowerSpectralDensity (sf.CreateTxPowerSpectralDensity (0.1, 1));
+  deviceHelper.SetNoisePowerSpectralDensity (sf.CreateConstant (1.381e-23 * 290));
+  deviceHelper.SetMacAttribute ("slots", UintegerValue (nSlots));
+
+  Ptr<ListPositionAllocator> layout = CreateObject<ListPositionAllocator> ();
+  layout->Add (Vector (0, 0, 0));
+
+  CapillaryCellHelper cells;
+  cells.SetDeviceHelper (deviceHelper);
+  cells.SetLayout (layout);
+  cells.SetEndDevices (nDevices);
+  NetDeviceContainer devices = cells.Install (1);
+
+  CapillaryMemoryReport memory;
+  memory.Account (devices);
+
+  // nothing allocated before the first frame
+  NS_TEST_ASSERT_MSG_EQ (memory.Get ("mac-slot-status"), 0, "Slot status allocated before the first frame");
+  NS_TEST_ASSERT_MSG_LT (memory.Get ("mac") / devices.GetN (), macBudget, "MAC over budget");
+  NS_TEST_ASSERT_MSG_LT (memory.Get ("phy") / devices.GetN (), phyBudget, "PHY over budget");
+
+  // the devices of a cell share a single configuration
+  Ptr<const FsalohaMacConfig> config = DynamicCast<FsalohaMac> (DynamicCast<CapillaryNetDevice> (devices.Get (0))->GetMac ())->GetConfig ();
+  for (uint32_t i = 1; i < devices.GetN (); i++)
+    {
+      Ptr<FsalohaMac> mac = DynamicCast<FsalohaMac> (DynamicCast<CapillaryNetDevice> (devices.Get (i))->GetMac ());
+      NS_TEST_ASSERT_MSG_EQ (mac->GetConfig (), config, "Configuration not shared");
+    }
+  NS_TEST_ASSERT_MSG_EQ (config->nSlots, nSlots, "Wrong number of slots");
+
+  // a new MTU gives a new slot duration, not the cached one
+  Ptr<FsalohaMac> coordinator = DynamicCast<FsalohaMac> (cells.GetCoordinator (0)->GetMac ());
+  Time duration = coordinator->GetSlotDuration ();
+  coordinator->SetMtu (2 * coordinator->GetMtu ());
+  NS_TEST_ASSERT_MSG_GT (coordinator->GetSlotDuration (), duration, "Stale slot duration");
+  coordinator->SetMtu (coordinator->GetMtu () / 2);
+  NS_TEST_ASSERT_MSG_EQ (coordinator->GetSlotDuration (), duration, "Wrong slot duration");
+
+  // only the coordinator keeps the slot status, once a frame has run
+  BasicEnergySourceHelper sourceHelper;
+  EnergySourceContainer sources = sourceHelper.Install (cells.GetAllNodes ());
+  CapillaryEnergyModelHelper energyHelper;
+  energyHelper.Install (devices, sources);
+
+  Simulator::Stop (Seconds (3));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (coordinator->GetSlotStatusSize (), nSlots * sizeof (FsalohaMac::SlotState), "Wrong coordinator slot status");
+  for (uint32_t i = 1; i < devices.GetN (); i++)
+    {
+      Ptr<FsalohaMac> mac = DynamicCast<FsalohaMac> (DynamicCast<CapillaryNetDevice> (devices.Get (i))->GetMac ());
+      NS_TEST_ASSERT_MSG_EQ (mac->GetSlotStatusSize (), 0, "Slot status kept by an end device");
+      NS_TEST_ASSERT_MSG_EQ (mac->GetCoordinatorStateSize (), 0, "Coordinator state allocated by an end device");
+    }
+  NS_TEST_ASSERT_MSG_GT (coordinator->GetCoordinatorStateSize (), 0, "Coordinator state not allocated");
+
+  // the per node sizes of this cell, tracked in the reference file
+  CapillaryMemoryReport after;
+  after.Account (devices);
+  std::ostringstream over;
+  NS_TEST_ASSERT_MSG_EQ (after.Check (CreateDataDirFilename ("capillary-memory-reference.txt"), devices.GetN (), 0.05, over), true,
+                         "Memory over the reference: " << over.str ());
+
+  Simulator::Destroy ();
+
+  // the shared configurations go with the simulation
+  NS_TEST_ASSERT_MSG_EQ (FsalohaMacConfig::GetNInterned (), 0, "Configurations kept after the simulation");
+  NS_TEST_ASSERT_MSG_EQ (coordinator->GetConfig ()->nSlots, nSlots, "Configuration released under a device");
+}
+
+// ==============================================================================
+/*
+ * A receiver counting the signals it gets.
+ */
+class CapillaryCountingPhy : public SpectrumPhy
+{
+public:
+  CapillaryCountingPhy () : m_nRx (0)
+  {
+  }
+
+  virtual void SetDevice (Ptr<NetDevice> d)
+  {
+  }
+  virtual Ptr<NetDevice> GetDevice (void) const
+  {
+    return 0;
+  }
+  virtual void SetMobility (Ptr<MobilityModel> m)
+  {
+    m_mobility = m;
+  }
+  virtual Ptr<MobilityModel> GetMobility (void)
+  {
+    return m_mobility;
+  }
+  virtual void SetChannel (Ptr<SpectrumChannel> c)
+  {
+  }
+  virtual Ptr<const SpectrumModel> GetRxSpectrumModel (void) const
+  {
+    return 0;
+  }
+  virtual Ptr<AntennaModel> GetRxAntenna (void)
+  {
+    return 0;
+  }
+  virtual void StartRx (Ptr<SpectrumSignalParameters> params)
+  {
+    m_nRx++;
+  }
+
+  uint32_t m_nRx;
+
+private:
+  Ptr<MobilityModel> m_mobility;
+};
+
+class CapillaryGridSpectrumChannelTestCase : public TestCase
+{
+public:
+  CapillaryGridSpectrumChannelTestCase ();
+  virtual ~CapillaryGridSpectrumChannelTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+CapillaryGridSpectrumChannelTestCase::CapillaryGridSpectrumChannelTestCase () :
+  TestCase ("Test the range culling of the grid spectrum channel")
+{
+}
+
+CapillaryGridSpectrumChannelTestCase::~CapillaryGridSpectrumChannelTestCase ()
+{
+}
+
+void CapillaryGridSpectrumChannelTestCase::DoRun (void)
+{
+  Ptr<CapillaryGridSpectrumChannel> channel = CreateObject<CapillaryGridSpectrumChannel> ();
+  channel->SetAttribute ("MaxDistance", DoubleValue (100));
+
+  // the transmitter, a receiver in range and one in a neighbour grid cell out of range
+  double x[3] = { 0, 50, 150 };
+  Ptr<CapillaryCountingPhy> phys[3];
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      Ptr<MobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+      mobility->SetPosition (Vector (x[i], 0, 0));
+      phys[i] = CreateObject<CapillaryCountingPhy> ();
+      phys[i]->SetMobility (mobility);
+      channel->AddRx (phys[i]);
+    }
+
+  WifiSpectrumValue5MhzFactory sf;
+  Ptr<SpectrumSignalParameters> params = Create<SpectrumSignalParameters> ();
+  params->psd = sf.CreateTxPowerSpectralDensity (0.1, 1);
+  params->duration = MilliSeconds (1);
+  params->txPhy = phys[0];
+
+  channel->StartTx (params);
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (phys[0]->m_nRx, 0, "Signal delivered to the transmitter");
+  NS_TEST_ASSERT_MSG_EQ (phys[1]->m_nRx, 1, "Signal not delivered in range");
+  NS_TEST_ASSERT_MSG_EQ (phys[2]->m_nRx, 0, "Signal delivered out of range");
+  NS_TEST_ASSERT_MSG_EQ (channel->GetDeliveries (), 1, "Wrong number of deliveries");
+  NS_TEST_ASSERT_MSG_EQ (channel->GetCulled (), 1, "Wrong number of culled receivers");
+
+  Simulator::Destroy ();
+}
+
+// ==============================================================================
+class CapillarySicBufferTestCase : public TestCase
+{
+public:
+  CapillarySicBufferTestCase ();
+  virtual ~CapillarySicBufferTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+CapillarySicBufferTestCase::CapillarySicBufferTestCase () :
+  TestCase ("Test the replica pointers and the interference cancellation")
+{
+}
+
+CapillarySicBufferTestCase::~CapillarySicBufferTestCase ()
+{
+}
+
+void CapillarySicBufferTestCase::DoRun (void)
+{
+  FsalohaReplicaHeader pointers;
+  pointers.AddReplica (3);
+  pointers.AddReplica (17);
+  Ptr<Packet> data = Create<Packet> (10);
+  data->AddHeader (pointers);
+  NS_TEST_ASSERT_MSG_EQ (data->GetSize (), 10 + 1 + 2 * 2, "Wrong DATA size");
+
+  FsalohaReplicaHeader replicas;
+  data->RemoveHeader (replicas);
+  NS_TEST_ASSERT_MSG_EQ (replicas.GetNReplicas (), 2, "Wrong number of replicas");
+  NS_TEST_ASSERT_MSG_EQ (replicas.GetReplica (1), 17, "Wrong replica");
+
+  // a and b collided in slot 3, c alone lost in slot 5
+  Ptr<const Packet> a = Create<Packet> (10);
+  Ptr<const Packet> b = Create<Packet> (10);
+  Ptr<const Packet> c = Create<Packet> (10);
+  std::vector<Ptr<const Packet> > signals;
+  signals.push_back (a);
+  signals.push_back (b);
+
+  CapillarySicBuffer sic;
+  sic.AddCollision (3, signals);
+  sic.AddCollision (5, std::vector<Ptr<const Packet> > (1, c));
+  NS_TEST_ASSERT_MSG_EQ (sic.GetNSignals (), 3, "Wrong number of buffered signals");
+
+  NS_TEST_ASSERT_MSG_EQ (sic.Cancel (5, a->GetUid ()), 0, "Signal decoded without a cancellation");
+  NS_TEST_ASSERT_MSG_EQ (sic.Cancel (3, a->GetUid ()), b, "Residual signal not decoded");
+  NS_TEST_ASSERT_MSG_EQ (sic.IsResolved (3), true, "Slot not resolved");
+  NS_TEST_ASSERT_MSG_EQ (sic.IsResolved (5), false, "Slot resolved");
+}
+
+// ==============================================================================
+/*
+ * A cell for the MAC behaviour tests: a coordinator and a few end
+ * devices close to it, sending the packets scheduled with SendAt.
+ */
+class CapillaryTestCell
+{
+public:
+  CapillaryTestCell ();
+
+  void SetMacAttribute (std::string name, const AttributeValue &value);
+
+  /**
+   * Place the cells on a line, the nodes hearing each other only within
+   * range; a single cell by default.
+   *
+   * @param nCells the number of cells
+   * @param spacing the distance between two coordinators (m)
+   * @param range the maximum distance of a reception (m)
+   */
+  void SetCells (uint32_t nCells, double spacing, double range);
+
+  /**
+   * @param nDevices the number of end devices of each cell
+   * @param nChannels the number of channels of the frames
+   */
+  void Install (uint32_t nDevices, uint16_t nChannels = 1);
+
+  Ptr<FsalohaMac> GetCoordinatorMac (uint32_t cell = 0) const;
+
+  /**
+   * @param cell the cell index
+   * @return the coordinator and the end devices
+   */
+  NetDeviceContainer GetDevices (uint32_t cell = 0) const;
+
+  /**
+   * @param i the end device index
+   * @param cell the cell index
+   * @return its MAC
+   */
+  Ptr<FsalohaMac> GetMac (uint32_t i, uint32_t cell = 0) const;
+
+  /**
+   * Make an end device always draw the same (channel, slot).
+   *
+   * @param i the end device index
+   * @param index the channel * slots + slot index
+   */
+  void PinSlot (uint32_t i, uint32_t index);
+
+  /**
+   * @param i the end device index
+   * @param at the time of the send
+   * @param alarm whether the packet is an alarm
+   */
+  void SendAt (uint32_t i, Time at, bool alarm = false);
+
+  /**
+   * @param i the end device addressed by the coordinator
+   * @param at the time of the send
+   */
+  void SendDownlinkAt (uint32_t i, Time at);
+
+private:
+  static void Send (Ptr<NetDevice> device, Address coordinator, bool alarm);
+
+  CapillaryNetDeviceHelper m_deviceHelper;
+  CapillaryCellHelper m_cells;
+  WifiSpectrumValue5MhzFactory m_sf;
+  Ptr<SpectrumValue> m_noisePsd;
+  uint32_t m_nCells;
+  double m_spacing;
+};
+
+CapillaryTestCell::CapillaryTestCell () :
+  m_nCells (1),
+  m_spacing (0)
+{
+  m_noisePsd = m_sf.CreateConstant (1.381e-23 * 290);
+
+  m_deviceHelper.SetChannel (SpectrumChannelHelper::Default ().Create ());
+  m_deviceHelper.SetTxPowerSpectralDensity (m_sf.CreateTxPowerSpectralDensity (0.1, 1));
+  m_deviceHelper.SetNoisePowerSpectralDensity (m_noisePsd);
+  m_deviceHelper.SetControllerTypeId ("ns3::BasicController");
+}
+
+void CapillaryTestCell::SetMacAttribute (std::string name, const AttributeValue &value)
+{
+  m_deviceHelper.SetMacAttribute (name, value);
+}
+
+void CapillaryTestCell::SetCells (uint32_t nCells, double spacing, double range)
+{
+  m_nCells = nCells;
+  m_spacing = spacing;
+
+  SpectrumChannelHelper channelHelper = SpectrumChannelHelper::Default ();
+  channelHelper.AddPropagationLoss ("ns3::RangePropagationLossModel", "MaxRange", DoubleValue (range));
+  Ptr<SpectrumChannel> channel = channelHelper.Create ();
+  // the signals out of range are not delivered at all
+  channel->SetAttribute ("MaxLossDb", DoubleValue (500));
+  m_deviceHelper.SetChannel (channel);
+}
+
+void CapillaryTestCell::Install (uint32_t nDevices, uint16_t nChannels)
+{
+  Ptr<ListPositionAllocator> layout = CreateObject<ListPositionAllocator> ();
+  for (uint32_t c = 0; c < m_nCells; c++)
+    {
+      layout->Add (Vector (c * m_spacing, 0, 0));
+    }
+
+  m_cells.SetDeviceHelper (m_deviceHelper);
+  m_cells.SetLayout (layout);
+  m_cells.SetEndDevices (nDevices);
+  m_cells.SetCellRadius (5);
+  NetDeviceContainer devices = m_cells.Install (m_nCells);
+
+  if (nChannels > 1)
+    {
+      // 5 channel numbers apart, not overlapping
+      CapillaryMultiChannelHelper channels;
+      channels.SetNoisePowerSpectralDensity (m_noisePsd);
+      for (uint16_t c = 1; c < nChannels; c++)
+        {
+          channels.AddChannel (m_sf.CreateTxPowerSpectralDensity (0.1, 1 + 5 * c));
+        }
+      channels.Install (devices);
+    }
+
+  BasicEnergySourceHelper sourceHelper;
+  EnergySourceContainer sources = sourceHelper.Install (m_cells.GetAllNodes ());
+  CapillaryEnergyModelHelper energyHelper;
+  energyHelper.Install (devices, sources);
+}
+
+Ptr<FsalohaMac> CapillaryTestCell::GetCoordinatorMac (uint32_t cell) const
+{
+  return DynamicCast<FsalohaMac> (m_cells.GetCoordinator (cell)->GetMac ());
+}
+
+NetDeviceContainer CapillaryTestCell::GetDevices (uint32_t cell) const
+{
+  return m_cells.GetDevices (cell);
+}
+
+Ptr<FsalohaMac> CapillaryTestCell::GetMac (uint32_t i, uint32_t cell) const
+{
+  Ptr<CapillaryNetDevice> device = DynamicCast<CapillaryNetDevice> (m_cells.GetDevices (cell).Get (i + 1));
+  return DynamicCast<FsalohaMac> (device->GetMac ());
+}
+
+void CapillaryTestCell::PinSlot (uint32_t i, uint32_t index)
+{
+  Ptr<UniformRandomVariable> random = CreateObject<UniformRandomVariable> ();
+  GetMac (i)->SetAttribute ("RandomStream", PointerValue (random));
+  random->SetAttribute ("Min", DoubleValue (index));
+  random->SetAttribute ("Max", DoubleValue (index));
+}
+
+void CapillaryTestCell::SendAt (uint32_t i, Time at, bool alarm)
+{
+  Simulator::Schedule (at, &CapillaryTestCell::Send, m_cells.GetDevices (0).Get (i + 1), m_cells.GetCoordinator (0)->GetAddress (), alarm);
+}
+
+void CapillaryTestCell::SendDownlinkAt (uint32_t i, Time at)
+{
+  Simulator::Schedule (at, &CapillaryTestCell::Send, m_cells.GetDevices (0).Get (0), m_cells.GetDevices (0).Get (i + 1)->GetAddress (), false);
+}
+
+void CapillaryTestCell::Send (Ptr<NetDevice> device, Address coordinator, bool alarm)
+{
+  Ptr<Packet> p = Create<Packet> (20);
+  if (alarm)
+    {
+      p->AddPacketTag (CapillaryPriorityTag (CapillaryPriorityTag::ALARM));
+    }
+  device->Send (p, coordinator, 0x88b6);
+}
+
+/** A slot stream cycling through fixed (channel, slot) indexes */
+class CapillarySlotSequence : public UniformRandomVariable
+{
+public:
+  CapillarySlotSequence ();
+
+  /**
+   * @param index the next (channel, slot) index of the sequence
+   */
+  void Add (uint32_t index);
+
+  using UniformRandomVariable::GetInteger;
+  virtual uint32_t GetInteger (void);
+
+private:
+  std::vector<uint32_t> m_indexes;
+  uint32_t m_next;
+};
+
+CapillarySlotSequence::CapillarySlotSequence () :
+  m_next (0)
+{
+}
+
+void CapillarySlotSequence::Add (uint32_t index)
+{
+  m_indexes.push_back (index);
+}
+
+uint32_t CapillarySlotSequence::GetInteger (void)
+{
+  NS_ASSERT (!m_indexes.empty ());
+  return m_indexes[m_next++ % m_indexes.size ()];
+}
+
+/** Collects the sources of the DATA forwarded up by a MAC */
+static void
+ForwardUpSink (std::vector<Mac64Address> *sources, Ptr<Packet> p, LlcSnapHeader &llc, Mac64Address src, Mac64Address dst)
+{
+  sources->push_back (src);
+}
+
+/** Collects the TxOutcome of an end device */
+static void
+TxOutcomeSink (std::vector<FsalohaMac::SlotState> *outcomes, FsalohaMac::SlotState state)
+{
+  outcomes->push_back (state);
+}
+
+/** Collects the PHY state of an end device when the FBP of a successful frame is built */
+static void
+PhyStateSink (std::vector<CapillaryPhy::State> *states, Ptr<CapillaryPhy> phy, const std::vector<FsalohaMac::SlotState> &status)
+{
+  if (std::find (status.begin (), status.end (), FsalohaMac::OK) != status.end ())
+    {
+      states->push_back (phy->GetStatus ());
+    }
+}
+
+/** Puts an end device to sleep after its first ACK, through the FBP */
+static void
+MissFeedbackSink (std::vector<FsalohaMac::SlotState> *outcomes, Ptr<CapillaryPhy> phy, FsalohaMac::SlotState state)
+{
+  outcomes->push_back (state);
+  if (outcomes->size () == 1)
+    {
+      Simulator::ScheduleNow (&CapillaryPhy::ForceSleep, phy);
+      Simulator::Schedule (MilliSeconds (300), &CapillaryPhy::WakeUp, phy);
+    }
+}
+
+/** The downlink DATA forwarded up by an end device, with the PHY state of the others */
+struct DownlinkProbe
+{
+  std::vector<Ptr<CapillaryPhy> > others;
+  std::vector<Mac64Address> sources;
+  std::vector<CapillaryPhy::State> states;
+};
+
+static void
+DownlinkSink (DownlinkProbe *probe, Ptr<Packet> p, LlcSnapHeader &llc, Mac64Address src, Mac64Address dst)
+{
+  probe->sources.push_back (src);
+  for (uint32_t i = 0; i < probe->others.size (); i++)
+    {
+      probe->states.push_back (probe->others[i]->GetStatus ());
+    }
+}
+
+/** Queues an alarm on the first end device after its first collision */
+static void
+AlarmOnCollisionSink (CapillaryTestCell *cell, Time *enqueued, FsalohaMac::SlotState state)
+{
+  if (state == FsalohaMac::ERROR && enqueued->IsZero ())
+    {
+      *enqueued = Simulator::Now ();
+      cell->SendAt (0, Seconds (0), true);
+    }
+}
+
+/** Collects the time and the priority of the packets delivered by an end device */
+static void
+AccessDelaySink (std::vector<std::pair<Time, uint8_t> > *deliveries, Time delay, uint8_t priority)
+{
+  deliveries->push_back (std::make_pair (Simulator::Now (), priority));
+}
+
+/** Collects the number of frames of the DCRs of a coordinator */
+static void
+FramesSink (std::vector<int> *frames, int oldValue, int newValue)
+{
+  if (newValue > 0)
+    {
+      frames->push_back (newValue);
+    }
+}
+
+/** Collects the handovers of an end device */
+static void
+CellChangeSink (std::vector<std::pair<uint16_t, uint16_t> > *changes, uint16_t oldCell, uint16_t newCell)
+{
+  changes->push_back (std::make_pair (oldCell, newCell));
+}
+
+/** Collects the size and the records of the aggregated frames of a relay */
+static void
+AggregateSink (std::vector<std::pair<uint32_t, uint32_t> > *frames, Ptr<const Packet> packet, uint32_t records)
+{
+  frames->push_back (std::make_pair (packet->GetSize (), records));
+}
+
+/** Collects the source, the delay and the time of the packets reaching the sink */
+static void
+RelayRxSink (std::vector<Mac64Address> *sources, std::vector<std::pair<Time, Time> > *delays, Ptr<const Packet> packet, Mac64Address source, Time delay)
+{
+  sources->push_back (source);
+  delays->push_back (std::make_pair (Simulator::Now (), delay));
+}
+
+/** Collects the time of the successful transmissions of an end device */
+static void
+DeliveryTimeSink (std::vector<Time> *times, FsalohaMac::SlotState state)
+{
+  if (state == FsalohaMac::OK)
+    {
+      times->push_back (Simulator::Now ());
+    }
+}
+
+/** Collects the slot status of the frames of a coordinator */
+static void
+SlotStatusSink (std::vector<std::pair<Time, std::vector<FsalohaMac::SlotState> > > *frames, const std::vector<FsalohaMac::SlotState> &status)
+{
+  frames->push_back (std::make_pair (Simulator::Now (), status));
+}
+
+// ==============================================================================
+class CapillaryMultiChannelTestCase : public TestCase
+{
+public:
+  CapillaryMultiChannelTestCase ();
+  virtual ~CapillaryMultiChannelTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+};
+
+CapillaryMultiChannelTestCase::CapillaryMultiChannelTestCase () :
+  TestCase ("Test two end devices on distinct channels of the same slot")
+{
+}
+
+CapillaryMultiChannelTestCase::~CapillaryMultiChannelTestCase ()
+{
+}
+
+void CapillaryMultiChannelTestCase::DoRun (void)
+{
+  CapillaryTestCell cell;
+  cell.SetMacAttribute ("slots", UintegerValue (1));
+  cell.Install (2, 2);
+
+  // the same slot, channels 0 and 1
+  std::vector<FsalohaMac::SlotState> outcomes[2];
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      cell.PinSlot (i, i);
+      cell.SendAt (i, MilliSeconds (100));
+      cell.GetMac (i)->TraceConnectWithoutContext ("TxOutcome", MakeBoundCallback (&TxOutcomeSink, &outcomes[i]));
+    }
+
+  Simulator::Stop (Seconds (3));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (outcomes[i].size (), 1, "Wrong number of transmissions");
+      NS_TEST_ASSERT_MSG_EQ (outcomes[i].front (), FsalohaMac::OK, "Collision between distinct channels");
+    }
+}
+
+// ==============================================================================
+class CapillaryReservationTestCase : public TestCase
+{
+public:
+  CapillaryReservationTestCase ();
+  virtual ~CapillaryReservationTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+};
+
+CapillaryReservationTestCase::CapillaryReservationTestCase () :
+  TestCase ("Test the owner of a slot succeeded in by two end devices")
+{
+}
+
+CapillaryReservationTestCase::~CapillaryReservationTestCase ()
+{
+}
+
+void CapillaryReservationTestCase::DoRun (void)
+{
+  CapillaryTestCell cell;
+  cell.SetMacAttribute ("slots", UintegerValue (1));
+  cell.SetMacAttribute ("Reservation", BooleanValue (true));
+  cell.Install (2);
+
+  // one DCR a second: the first device takes the slot, the second one
+  // succeeds in it a DCR later, while its owner has nothing to send
+  std::vector<FsalohaMac::SlotState> outcomes[2];
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      cell.SendAt (i, MilliSeconds (100 + 1400 * i));
+      cell.GetMac (i)->TraceConnectWithoutContext ("TxOutcome", MakeBoundCallback (&TxOutcomeSink, &outcomes[i]));
+    }
+
+  // two more empty DCRs, within MaxMissedDcrs
+  Simulator::Stop (MilliSeconds (4500));
+  Simulator::Run ();
+
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (outcomes[i].size (), 1, "Wrong number of transmissions");
+      NS_TEST_ASSERT_MSG_EQ (outcomes[i].front (), FsalohaMac::OK, "Transmission failed");
+    }
+  NS_TEST_ASSERT_MSG_EQ (cell.GetCoordinatorMac ()->GetNReservations (), 1, "Reservation lost while its owner was idle");
+  NS_TEST_ASSERT_MSG_EQ (cell.GetMac (0)->GetNReservations (), 1, "The owner lost its slot");
+  NS_TEST_ASSERT_MSG_EQ (cell.GetMac (1)->GetNReservations (), 0, "Slot confirmed to a device other than its owner");
+
+  Simulator::Destroy ();
+}
+
+// ==============================================================================
+class CapillaryImmediateAckTestCase : public TestCase
+{
+public:
+  CapillaryImmediateAckTestCase ();
+  virtual ~CapillaryImmediateAckTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+};
+
+CapillaryImmediateAckTestCase::CapillaryImmediateAckTestCase () :
+  TestCase ("Test the immediate ACK of a single end device")
+{
+}
+
+CapillaryImmediateAckTestCase::~CapillaryImmediateAckTestCase ()
+{
+}
+
+void CapillaryImmediateAckTestCase::DoRun (void)
+{
+  // a single packet, acknowledged in its slot
+  {
+    CapillaryTestCell cell;
+    cell.SetMacAttribute ("ImmediateAck", BooleanValue (true));
+    cell.Install (1);
+
+    // an acknowledged device sleeps before the FBP
+    std::vector<FsalohaMac::SlotState> outcomes;
+    std::vector<CapillaryPhy::State> states;
+    Ptr<FsalohaMac> mac = cell.GetMac (0);
+    mac->TraceConnectWithoutContext ("TxOutcome", MakeBoundCallback (&TxOutcomeSink, &outcomes));
+    cell.GetCoordinatorMac ()->TraceConnectWithoutContext ("SlotStatus", MakeBoundCallback (&PhyStateSink, &states, mac->GetPhy ()));
+    cell.SendAt (0, MilliSeconds (100));
+
+    Simulator::Stop (Seconds (2));
+    Simulator::Run ();
+
+    CapillaryMacHeader header;
+    FsalohaHeader fsaHdr;
+    LlcSnapHeader llc;
+    CapillaryMacTrailer trailer;
+    uint32_t overhead = header.GetSerializedSize () + fsaHdr.GetSerializedSize () + trailer.GetSerializedSize () + llc.GetSerializedSize ();
+    double rate = mac->GetPhy ()->GetRate ().GetBitRate ();
+    Time maxDelay = mac->GetMaxDelay ();
+    Time ackOffset = 2 * maxDelay + Seconds ((mac->GetMtu () + overhead) * 8.0 / rate);
+    Time slot = ackOffset + 2 * maxDelay + Seconds ((overhead + (mac->GetNChannels () + 7) / 8) * 8.0 / rate);
+
+    NS_TEST_ASSERT_MSG_EQ (mac->GetConfig ()->GetAckOffset (mac->GetPhy ()->GetRate ()), ackOffset, "Wrong ACK offset");
+    NS_TEST_ASSERT_MSG_EQ (mac->GetSlotDuration (), slot, "Wrong slot duration");
+    NS_TEST_ASSERT_MSG_EQ (outcomes.size (), 1, "Wrong number of transmissions");
+    NS_TEST_ASSERT_MSG_EQ (outcomes.front (), FsalohaMac::OK, "Transmission not acknowledged");
+    NS_TEST_ASSERT_MSG_EQ (states.size (), 1, "Wrong number of FBP");
+    NS_TEST_ASSERT_MSG_EQ (states.front (), CapillaryPhy::SLEEP, "The end device waited for the FBP");
+
+    Simulator::Destroy ();
+  }
+
+  // an acknowledged device that misses the FBP keeps its next packet
+  {
+    CapillaryTestCell cell;
+    cell.SetMacAttribute ("ImmediateAck", BooleanValue (true));
+    cell.SetMacAttribute ("packets", UintegerValue (2));
+    cell.Install (1);
+
+    std::vector<FsalohaMac::SlotState> outcomes;
+    Ptr<FsalohaMac> mac = cell.GetMac (0);
+    mac->TraceConnectWithoutContext ("TxOutcome", MakeBoundCallback (&MissFeedbackSink, &outcomes, mac->GetPhy ()));
+    cell.SendAt (0, MilliSeconds (100));
+    cell.SendAt (0, MilliSeconds (100));
+
+    Simulator::Stop (Seconds (4));
+    Simulator::Run ();
+
+    NS_TEST_ASSERT_MSG_EQ (outcomes.size (), 2, "Packet lost with the FBP");
+    NS_TEST_ASSERT_MSG_EQ (outcomes.back (), FsalohaMac::OK, "Transmission failed");
+
+    Simulator::Destroy ();
+  }
+}
+
+// ==============================================================================
+class CapillaryAlarmSlotsTestCase : public TestCase
+{
+public:
+  CapillaryAlarmSlotsTestCase ();
+  virtual ~CapillaryAlarmSlotsTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+};
+
+CapillaryAlarmSlotsTestCase::CapillaryAlarmSlotsTestCase () :
+  TestCase ("Test the slots of the alarm and routine traffic")
+{
+}
+
+CapillaryAlarmSlotsTestCase::~CapillaryAlarmSlotsTestCase ()
+{
+}
+
+void CapillaryAlarmSlotsTestCase::DoRun (void)
+{
+  uint16_t alarmSlots = 2;
+  CapillaryTestCell cell;
+  cell.SetMacAttribute ("slots", UintegerValue (6));
+  cell.SetMacAttribute ("AlarmSlots", UintegerValue (alarmSlots));
+  cell.Install (6);
+
+  // the alarms and the routine packets in distinct DCRs, one a second
+  Time routine = MilliSeconds (1500);
+  std::vector<FsalohaMac::SlotState> outcomes[6];
+  for (uint32_t i = 0; i < 6; i++)
+    {
+      cell.SendAt (i, i < 3 ? MilliSeconds (100) : routine, i < 3);
+      cell.GetMac (i)->TraceConnectWithoutContext ("TxOutcome", MakeBoundCallback (&TxOutcomeSink, &outcomes[i]));
+    }
+  std::vector<std::pair<Time, std::vector<FsalohaMac::SlotState> > > frames;
+  cell.GetCoordinatorMac ()->TraceConnectWithoutContext ("SlotStatus", MakeBoundCallback (&SlotStatusSink, &frames));
+
+  Simulator::Stop (Seconds (4));
+  Simulator::Run ();
+
+  for (uint32_t i = 0; i < 6; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (outcomes[i].empty (), false, "Packet not sent");
+      NS_TEST_ASSERT_MSG_EQ (outcomes[i].back (), FsalohaMac::OK, "Packet not delivered");
+    }
+  for (uint32_t f = 0; f < frames.size (); f++)
+    {
+      for (uint32_t s = 0; s < frames[f].second.size (); s++)
+        {
+          bool used = frames[f].second[s] != FsalohaMac::EMPTY;
+          if (frames[f].first < routine)
+            {
+              NS_TEST_ASSERT_MSG_EQ (used && s >= alarmSlots, false, "Alarm out of the alarm slots");
+            }
+          else
+            {
+              NS_TEST_ASSERT_MSG_EQ (used && s < alarmSlots, false, "Routine packet in an alarm slot");
+            }
+        }
+    }
+
+  Simulator::Destroy ();
+}
+
+// ==============================================================================
+class CapillaryAlarmPreemptionTestCase : public TestCase
+{
+public:
+  CapillaryAlarmPreemptionTestCase ();
+  virtual ~CapillaryAlarmPreemptionTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+};
+
+CapillaryAlarmPreemptionTestCase::CapillaryAlarmPreemptionTestCase () :
+  TestCase ("Test an alarm preempting a routine packet backing off")
+{
+}
+
+CapillaryAlarmPreemptionTestCase::~CapillaryAlarmPreemptionTestCase ()
+{
+}
+
+void CapillaryAlarmPreemptionTestCase::DoRun (void)
+{
+  CapillaryTestCell cell;
+  cell.SetMacAttribute ("slots", UintegerValue (2));
+  cell.SetMacAttribute ("AlarmSlots", UintegerValue (1));
+  cell.SetMacAttribute ("Backoff", EnumValue (FsalohaMac::FRAME_SKIP));
+  cell.Install (2);
+
+  // a single routine slot: the routine packets collide and back off, and
+  // the alarm comes right after the first collision, alone in its slot
+  Time enqueued;
+  std::vector<std::pair<Time, uint8_t> > deliveries;
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      cell.SendAt (i, MilliSeconds (100));
+    }
+  cell.GetMac (0)->TraceConnectWithoutContext ("TxOutcome", MakeBoundCallback (&AlarmOnCollisionSink, &cell, &enqueued));
+  cell.GetMac (0)->TraceConnectWithoutContext ("AccessDelay", MakeBoundCallback (&AccessDelaySink, &deliveries));
+  std::vector<std::pair<Time, std::vector<FsalohaMac::SlotState> > > frames;
+  cell.GetCoordinatorMac ()->TraceConnectWithoutContext ("SlotStatus", MakeBoundCallback (&SlotStatusSink, &frames));
+
+  Simulator::Stop (Seconds (3));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (enqueued.IsZero (), false, "No collision");
+  NS_TEST_ASSERT_MSG_EQ (deliveries.size (), 2, "Packets not delivered");
+
+  // the alarm goes in the frame after the next FBP, whatever the backoff
+  // of the routine packet
+  uint32_t alarm = 0;
+  while (alarm < deliveries.size () && deliveries[alarm].second != CapillaryPriorityTag::ALARM)
+    {
+      alarm++;
+    }
+  NS_TEST_ASSERT_MSG_LT (alarm, deliveries.size (), "Alarm not delivered");
+  uint32_t waited = 0;
+  for (uint32_t f = 0; f < frames.size (); f++)
+    {
+      if (frames[f].first > enqueued && frames[f].first <= deliveries[alarm].first)
+        {
+          waited++;
+        }
+    }
+  NS_TEST_ASSERT_MSG_LT (waited, 3u, "Alarm held back by the backoff of the routine packet");
+
+  Simulator::Destroy ();
+}
+
+// ==============================================================================
+class CapillaryBackoffTestCase : public TestCase
+{
+public:
+  CapillaryBackoffTestCase ();
+  virtual ~CapillaryBackoffTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+};
+
+CapillaryBackoffTestCase::CapillaryBackoffTestCase () :
+  TestCase ("Test the retry limit and the backoff window of two colliding end devices")
+{
+}
+
+CapillaryBackoffTestCase::~CapillaryBackoffTestCase ()
+{
+}
+
+void CapillaryBackoffTestCase::DoRun (void)
+{
+  // always in the same slot, dropped after RetryLimit collisions
+  {
+    CapillaryTestCell cell;
+    cell.SetMacAttribute ("RetryLimit", UintegerValue (3));
+    cell.Install (2);
+
+    std::vector<FsalohaMac::SlotState> outcomes[2];
+    for (uint32_t i = 0; i < 2; i++)
+      {
+        cell.SendAt (i, MilliSeconds (100));
+        cell.GetMac (i)->TraceConnectWithoutContext ("TxOutcome", MakeBoundCallback (&TxOutcomeSink, &outcomes[i]));
+      }
+
+    Simulator::Stop (Seconds (3));
+    Simulator::Run ();
+
+    for (uint32_t i = 0; i < 2; i++)
+      {
+        NS_TEST_ASSERT_MSG_EQ (outcomes[i].size (), 3, "Wrong number of transmissions");
+        NS_TEST_ASSERT_MSG_EQ (std::count (outcomes[i].begin (), outcomes[i].end (), FsalohaMac::ERROR), 3, "Wrong number of collisions");
+        NS_TEST_ASSERT_MSG_EQ (cell.GetMac (i)->GetNRetryDrops (), 1, "Packet not dropped");
+      }
+
+    Simulator::Destroy ();
+  }
+
+  // the DCR stays open while the devices skip frames
+  {
+    CapillaryTestCell cell;
+    cell.SetMacAttribute ("Backoff", EnumValue (FsalohaMac::FRAME_SKIP));
+    cell.SetMacAttribute ("BackoffExponent", UintegerValue (2));
+    cell.Install (2);
+
+    std::vector<Time> delivered;
+    for (uint32_t i = 0; i < 2; i++)
+      {
+        cell.SendAt (i, MilliSeconds (100));
+        cell.GetMac (i)->TraceConnectWithoutContext ("TxOutcome", MakeBoundCallback (&DeliveryTimeSink, &delivered));
+      }
+
+    Simulator::Stop (Seconds (3));
+    Simulator::Run ();
+
+    // one DCR a second
+    NS_TEST_ASSERT_MSG_EQ (delivered.size (), 2, "Packet not delivered");
+    NS_TEST_ASSERT_MSG_LT (delivered.back () - delivered.front (), MilliSeconds (500), "Backing off device left for the next DCR");
+
+    Simulator::Destroy ();
+  }
+
+  // no window to wait for with PERSISTENCE: an empty frame ends the DCR
+  {
+    CapillaryTestCell cell;
+    cell.SetMacAttribute ("Backoff", EnumValue (FsalohaMac::PERSISTENCE));
+    cell.Install (2);
+
+    for (uint32_t i = 0; i < 2; i++)
+      {
+        cell.SendAt (i, MilliSeconds (100));
+      }
+    std::vector<std::pair<Time, std::vector<FsalohaMac::SlotState> > > frames;
+    cell.GetCoordinatorMac ()->TraceConnectWithoutContext ("SlotStatus", MakeBoundCallback (&SlotStatusSink, &frames));
+
+    Simulator::Stop (Seconds (3));
+    Simulator::Run ();
+
+    // one DCR a second, its frames some milliseconds apart
+    for (uint32_t f = 1; f < frames.size (); f++)
+      {
+        bool empty = std::count (frames[f - 1].second.begin (), frames[f - 1].second.end (), FsalohaMac::EMPTY) == (int) frames[f - 1].second.size ();
+        NS_TEST_ASSERT_MSG_EQ (empty && frames[f].first - frames[f - 1].first < MilliSeconds (500), false, "DCR held open after an empty frame");
+      }
+
+    Simulator::Destroy ();
+  }
+}
+
+// ==============================================================================
+class CapillaryInterferenceCancellationTestCase : public TestCase
+{
+public:
+  CapillaryInterferenceCancellationTestCase ();
+  virtual ~CapillaryInterferenceCancellationTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+};
+
+CapillaryInterferenceCancellationTestCase::CapillaryInterferenceCancellationTestCase () :
+  TestCase ("Test the delivery of collided replicas by interference cancellation")
+{
+}
+
+CapillaryInterferenceCancellationTestCase::~CapillaryInterferenceCancellationTestCase ()
+{
+}
+
+void CapillaryInterferenceCancellationTestCase::DoRun (void)
+{
+  CapillaryTestCell cell;
+  cell.SetMacAttribute ("slots", UintegerValue (4));
+  cell.SetMacAttribute ("Replicas", UintegerValue (2));
+  cell.Install (3);
+
+  // replicas in slots {0, 1}, {1, 2} and {2, 3}: the second device collides
+  // in both of its slots and is recovered once the others are cancelled
+  std::vector<FsalohaMac::SlotState> outcomes[3];
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      Ptr<CapillarySlotSequence> sequence = CreateObject<CapillarySlotSequence> ();
+      sequence->Add (i);
+      sequence->Add (i + 1);
+      cell.GetMac (i)->SetAttribute ("RandomStream", PointerValue (sequence));
+      cell.SendAt (i, MilliSeconds (100));
+      cell.GetMac (i)->TraceConnectWithoutContext ("TxOutcome", MakeBoundCallback (&TxOutcomeSink, &outcomes[i]));
+    }
+  std::vector<Mac64Address> sources;
+  cell.GetCoordinatorMac ()->SetAttribute ("ForwardUpCallback", CallbackValue (MakeBoundCallback (&ForwardUpSink, &sources)));
+  std::vector<std::pair<Time, std::vector<FsalohaMac::SlotState> > > frames;
+  cell.GetCoordinatorMac ()->TraceConnectWithoutContext ("SlotStatus", MakeBoundCallback (&SlotStatusSink, &frames));
+
+  Simulator::Stop (Seconds (2));
+  Simulator::Run ();
+
+  // the collided slots resolved before the FBP
+  uint32_t first = 0;
+  while (first < frames.size () && frames[first].second[0] == FsalohaMac::EMPTY)
+    {
+      first++;
+    }
+  NS_TEST_ASSERT_MSG_LT (first, frames.size (), "No frame with data");
+  for (uint32_t s = 0; s < 4; s++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (frames[first].second[s], FsalohaMac::OK, "Slot not resolved by the cancellation");
+    }
+
+  // every packet delivered once, although the replicas are recovered twice
+  NS_TEST_ASSERT_MSG_EQ (sources.size (), 3, "Wrong number of deliveries");
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      Mac64Address address = Mac64Address::ConvertFrom (cell.GetDevices ().Get (i + 1)->GetAddress ());
+      NS_TEST_ASSERT_MSG_EQ (std::count (sources.begin (), sources.end (), address), 1, "Packet not delivered exactly once");
+      NS_TEST_ASSERT_MSG_EQ (outcomes[i].size (), 1, "Wrong number of transmissions");
+      NS_TEST_ASSERT_MSG_EQ (outcomes[i].front (), FsalohaMac::OK, "Packet not acknowledged in the FBP");
+    }
+
+  Simulator::Destroy ();
+}
+
+// ==============================================================================
+class CapillaryEndOfDcrTestCase : public TestCase
+{
+public:
+  CapillaryEndOfDcrTestCase ();
+  virtual ~CapillaryEndOfDcrTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+};
+
+CapillaryEndOfDcrTestCase::CapillaryEndOfDcrTestCase () :
+  TestCase ("Test that the coordinator ends the DCR on END and keeps it open on MORE")
+{
+}
+
+CapillaryEndOfDcrTestCase::~CapillaryEndOfDcrTestCase ()
+{
+}
+
+void CapillaryEndOfDcrTestCase::DoRun (void)
+{
+  // up to 3 packets a DCR, but a single one queued: no trailing empty frame
+  {
+    CapillaryTestCell cell;
+    cell.SetMacAttribute ("slots", UintegerValue (4));
+    cell.SetMacAttribute ("packets", UintegerValue (3));
+    cell.Install (1);
+
+    std::vector<FsalohaMac::SlotState> outcomes;
+    cell.SendAt (0, MilliSeconds (100));
+    cell.GetMac (0)->TraceConnectWithoutContext ("TxOutcome", MakeBoundCallback (&TxOutcomeSink, &outcomes));
+    std::vector<int> frames;
+    cell.GetCoordinatorMac ()->TraceConnectWithoutContext ("Frames", MakeBoundCallback (&FramesSink, &frames));
+
+    Simulator::Stop (Seconds (3));
+    Simulator::Run ();
+
+    NS_TEST_ASSERT_MSG_EQ (outcomes.size (), 1, "Wrong number of transmissions");
+    NS_TEST_ASSERT_MSG_EQ (outcomes.front (), FsalohaMac::OK, "Packet not delivered");
+    NS_TEST_ASSERT_MSG_EQ (frames.empty (), false, "No DCR");
+    for (uint32_t i = 0; i < frames.size (); i++)
+      {
+        NS_TEST_ASSERT_MSG_EQ (frames[i], 1, "DCR not ended on END");
+      }
+
+    Simulator::Destroy ();
+  }
+
+  // 3 packets queued: the DCR stays open for the announced ones, and ends
+  // with the last of them
+  {
+    CapillaryTestCell cell;
+    cell.SetMacAttribute ("slots", UintegerValue (4));
+    cell.SetMacAttribute ("packets", UintegerValue (3));
+    cell.Install (1);
+
+    std::vector<Time> times;
+    for (uint32_t i = 0; i < 3; i++)
+      {
+        cell.SendAt (0, MilliSeconds (100));
+      }
+    cell.GetMac (0)->TraceConnectWithoutContext ("TxOutcome", MakeBoundCallback (&DeliveryTimeSink, &times));
+    std::vector<int> frames;
+    cell.GetCoordinatorMac ()->TraceConnectWithoutContext ("Frames", MakeBoundCallback (&FramesSink, &frames));
+
+    Simulator::Stop (Seconds (3));
+    Simulator::Run ();
+
+    NS_TEST_ASSERT_MSG_EQ (times.size (), 3, "Packets not delivered");
+    NS_TEST_ASSERT_MSG_LT (times.back () - times.front (), Seconds (1), "Packets not delivered in a single DCR");
+    NS_TEST_ASSERT_MSG_EQ (std::count (frames.begin (), frames.end (), 3), 1, "DCR not kept open on MORE");
+    NS_TEST_ASSERT_MSG_EQ (*std::max_element (frames.begin (), frames.end ()), 3, "Trailing frame after the last packet");
+
+    Simulator::Destroy ();
+  }
+}
+
+// ==============================================================================
+class CapillarySplittingTestCase : public TestCase
+{
+public:
+  CapillarySplittingTestCase ();
+  virtual ~CapillarySplittingTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+};
+
+CapillarySplittingTestCase::CapillarySplittingTestCase () :
+  TestCase ("Test that only the colliding end devices transmit in a splitting frame")
+{
+}
+
+CapillarySplittingTestCase::~CapillarySplittingTestCase ()
+{
+}
+
+void CapillarySplittingTestCase::DoRun (void)
+{
+  uint16_t splittingFactor = 2;
+  CapillaryTestCell cell;
+  cell.SetMacAttribute ("slots", UintegerValue (4));
+  cell.SetMacAttribute ("SplittingFactor", UintegerValue (splittingFactor));
+  cell.Install (3);
+
+  // the first two collide in slot 0, the third one is received in slot 1
+  // and has one more packet for the next frame
+  std::vector<Time> times[3];
+  std::vector<FsalohaMac::SlotState> outcomes[3];
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      cell.PinSlot (i, i < 2 ? 0 : 1);
+      cell.SendAt (i, MilliSeconds (100));
+      cell.GetMac (i)->TraceConnectWithoutContext ("TxOutcome", MakeBoundCallback (&TxOutcomeSink, &outcomes[i]));
+      cell.GetMac (i)->TraceConnectWithoutContext ("TxOutcome", MakeBoundCallback (&DeliveryTimeSink, &times[i]));
+    }
+  cell.SendAt (2, MilliSeconds (100));
+  std::vector<std::pair<Time, std::vector<FsalohaMac::SlotState> > > frames;
+  cell.GetCoordinatorMac ()->TraceConnectWithoutContext ("SlotStatus", MakeBoundCallback (&SlotStatusSink, &frames));
+
+  Simulator::Stop (Seconds (2));
+  Simulator::Run ();
+
+  uint32_t first = 0;
+  while (first < frames.size () && frames[first].second[0] == FsalohaMac::EMPTY)
+    {
+      first++;
+    }
+  NS_TEST_ASSERT_MSG_LT (first, frames.size (), "No frame with data");
+  NS_TEST_ASSERT_MSG_EQ (frames[first].second[0], FsalohaMac::ERROR, "No collision in the first frame");
+  NS_TEST_ASSERT_MSG_EQ (frames[first].second[1], FsalohaMac::OK, "Packet lost in the first frame");
+
+  // the splitting frames follow, one collided slot each, with the colliders only
+  uint32_t split = 0;
+  uint32_t received = 0;
+  for (uint32_t f = first + 1; f < frames.size () && frames[f].second.size () == splittingFactor; f++)
+    {
+      split++;
+      received += std::count (frames[f].second.begin (), frames[f].second.end (), FsalohaMac::OK);
+    }
+  NS_TEST_ASSERT_MSG_GT (split, 0, "No splitting frame");
+  NS_TEST_ASSERT_MSG_EQ (received, 2, "Colliders not resolved by the splitting frames");
+
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (outcomes[i].front (), FsalohaMac::ERROR, "No collision");
+      NS_TEST_ASSERT_MSG_EQ (outcomes[i].back (), FsalohaMac::OK, "Collider not delivered");
+      NS_TEST_ASSERT_MSG_EQ (times[i].size (), 1, "Collider delivered more than once");
+    }
+
+  // the third device sleeps through the splitting frames
+  NS_TEST_ASSERT_MSG_EQ (outcomes[2].size (), 2, "Wrong number of transmissions");
+  NS_TEST_ASSERT_MSG_EQ (times[2].size (), 2, "Packet not delivered");
+  for (uint32_t i = 0; i < 2 && times[i].size () == 1; i++)
+    {
+      NS_TEST_ASSERT_MSG_GT (times[2].back (), times[i].front (), "Transmission in a splitting frame");
+    }
+
+  Simulator::Destroy ();
+}
+
+// ==============================================================================
+class CapillaryDownlinkTestCase : public TestCase
+{
+public:
+  CapillaryDownlinkTestCase ();
+  virtual ~CapillaryDownlinkTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+};
+
+CapillaryDownlinkTestCase::CapillaryDownlinkTestCase () :
+  TestCase ("Test the downlink burst and the sleep of the end devices around it")
+{
+}
+
+CapillaryDownlinkTestCase::~CapillaryDownlinkTestCase ()
+{
+}
+
+void CapillaryDownlinkTestCase::DoRun (void)
+{
+  CapillaryTestCell cell;
+  cell.Install (3);
+
+  // two downlink slots, for the first two devices; the third one has
+  // uplink data only
+  DownlinkProbe probes[3];
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      for (uint32_t j = 0; j < 3; j++)
+        {
+          if (j != i)
+            {
+              probes[i].others.push_back (cell.GetMac (j)->GetPhy ());
+            }
+        }
+      cell.GetMac (i)->SetAttribute ("ForwardUpCallback", CallbackValue (MakeBoundCallback (&DownlinkSink, &probes[i])));
+    }
+  cell.SendDownlinkAt (0, MilliSeconds (100));
+  cell.SendDownlinkAt (1, MilliSeconds (100));
+  cell.SendAt (2, MilliSeconds (100));
+
+  std::vector<FsalohaMac::SlotState> outcomes;
+  cell.GetMac (2)->TraceConnectWithoutContext ("TxOutcome", MakeBoundCallback (&TxOutcomeSink, &outcomes));
+
+  Simulator::Stop (Seconds (2));
+  Simulator::Run ();
+
+  Mac64Address coordinator = Mac64Address::ConvertFrom (cell.GetDevices ().Get (0)->GetAddress ());
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (probes[i].sources.size (), 1, "Downlink DATA not received by its device");
+      NS_TEST_ASSERT_MSG_EQ (probes[i].sources.front (), coordinator, "Downlink DATA from a wrong source");
+
+      // in its own downlink slot, every other device is asleep
+      for (uint32_t j = 0; j < probes[i].states.size (); j++)
+        {
+          NS_TEST_ASSERT_MSG_EQ (probes[i].states[j], CapillaryPhy::SLEEP, "Awake in the downlink slot of another device");
+        }
+    }
+  NS_TEST_ASSERT_MSG_EQ (probes[2].sources.empty (), true, "Downlink DATA received by a device not addressed");
+  NS_TEST_ASSERT_MSG_EQ (cell.GetCoordinatorMac ()->GetDownlinkQueueLength (), 0, "Downlink DATA left in the queue");
+
+  // awake again for the frame after the burst
+  NS_TEST_ASSERT_MSG_EQ (outcomes.size (), 1, "Wrong number of transmissions");
+  NS_TEST_ASSERT_MSG_EQ (outcomes.front (), FsalohaMac::OK, "Uplink DATA lost after the downlink burst");
+
+  Simulator::Destroy ();
+}
+
+// ==============================================================================
+class CapillaryHandoverTestCase : public TestCase
+{
+public:
+  CapillaryHandoverTestCase ();
+  virtual ~CapillaryHandoverTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+};
+
+CapillaryHandoverTestCase::CapillaryHandoverTestCase () :
+  TestCase ("Test the marginal link and the handover of an end device")
+{
+}
+
+CapillaryHandoverTestCase::~CapillaryHandoverTestCase ()
+{
+}
+
+void CapillaryHandoverTestCase::DoRun (void)
+{
+  // a device on a marginal link sleeps through the DCR, keeping its packet
+  {
+    CapillaryTestCell cell;
+    cell.SetMacAttribute ("Handover", BooleanValue (true));
+    cell.Install (2);
+    cell.GetMac (1)->SetAttribute ("MinRxPower", DoubleValue (100));
+
+    std::vector<FsalohaMac::SlotState> outcomes[2];
+    for (uint32_t i = 0; i < 2; i++)
+      {
+        cell.SendAt (i, MilliSeconds (100));
+        cell.GetMac (i)->TraceConnectWithoutContext ("TxOutcome", MakeBoundCallback (&TxOutcomeSink, &outcomes[i]));
+      }
+    std::vector<CapillaryPhy::State> states;
+    cell.GetCoordinatorMac ()->TraceConnectWithoutContext ("SlotStatus", MakeBoundCallback (&PhyStateSink, &states, cell.GetMac (1)->GetPhy ()));
+
+    Simulator::Stop (Seconds (2));
+    Simulator::Run ();
+
+    NS_TEST_ASSERT_MSG_EQ (outcomes[0].size (), 1, "Wrong number of transmissions");
+    NS_TEST_ASSERT_MSG_EQ (outcomes[0].front (), FsalohaMac::OK, "Transmission failed");
+    NS_TEST_ASSERT_MSG_EQ (outcomes[1].empty (), true, "Transmission on a marginal link");
+    NS_TEST_ASSERT_MSG_EQ (cell.GetMac (1)->GetTxQueueLength () + cell.GetMac (1)->GetQueueLength () > 0, true, "Packet lost on a marginal link");
+    NS_TEST_ASSERT_MSG_EQ (states.size (), 1, "Wrong number of FBP");
+    NS_TEST_ASSERT_MSG_EQ (states.front (), CapillaryPhy::SLEEP, "Awake through the DCR on a marginal link");
+
+    Simulator::Destroy ();
+  }
+
+  // out of the range of its coordinator, a device joins the next cell
+  {
+    CapillaryTestCell cells;
+    cells.SetCells (2, 100, 60);
+    cells.SetMacAttribute ("Handover", BooleanValue (true));
+    cells.SetMacAttribute ("LinkTimeout", TimeValue (MilliSeconds (500)));
+    cells.Install (1);
+
+    Ptr<FsalohaMac> mover = cells.GetMac (0);
+    std::vector<FsalohaMac::SlotState> outcomes;
+    std::vector<std::pair<uint16_t, uint16_t> > changes;
+    mover->TraceConnectWithoutContext ("TxOutcome", MakeBoundCallback (&TxOutcomeSink, &outcomes));
+    mover->TraceConnectWithoutContext ("CellChange", MakeBoundCallback (&CellChangeSink, &changes));
+    std::vector<std::pair<Time, std::vector<FsalohaMac::SlotState> > > frames;
+    cells.GetCoordinatorMac (1)->TraceConnectWithoutContext ("SlotStatus", MakeBoundCallback (&SlotStatusSink, &frames));
+
+    // one DCR a second: a packet in each cell, moved in between
+    Time movedAt = MilliSeconds (2500);
+    Ptr<MobilityModel> mobility = cells.GetDevices (0).Get (1)->GetNode ()->GetObject<MobilityModel> ();
+    Simulator::Schedule (movedAt, &MobilityModel::SetPosition, mobility, Vector (95, 0, 0));
+    cells.SendAt (0, MilliSeconds (100));
+    cells.SendAt (0, MilliSeconds (4500));
+
+    Simulator::Stop (Seconds (7));
+    Simulator::Run ();
+
+    NS_TEST_ASSERT_MSG_EQ (changes.size (), 1, "Wrong number of handovers");
+    NS_TEST_ASSERT_MSG_EQ (changes.front ().first, 0, "Wrong old cell");
+    NS_TEST_ASSERT_MSG_EQ (changes.front ().second, 1, "Wrong new cell");
+    NS_TEST_ASSERT_MSG_EQ (mover->GetCellId (), 1, "Not attached to the next cell");
+    NS_TEST_ASSERT_MSG_EQ (outcomes.size (), 2, "Wrong number of transmissions");
+    NS_TEST_ASSERT_MSG_EQ (std::count (outcomes.begin (), outcomes.end (), FsalohaMac::OK), 2, "Transmission failed");
+
+    // the second packet, in the DCR of the next cell
+    uint32_t received = 0;
+    for (uint32_t f = 0; f < frames.size (); f++)
+      {
+        uint32_t ok = std::count (frames[f].second.begin (), frames[f].second.end (), FsalohaMac::OK);
+        NS_TEST_ASSERT_MSG_EQ (ok > 0 && frames[f].first < movedAt, false, "Next cell reached before the move");
+        received += ok;
+      }
+    NS_TEST_ASSERT_MSG_EQ (received, 1, "Packet not received by the next cell");
+
+    Simulator::Destroy ();
+  }
+}
+
+// ==============================================================================
+class CapillaryRelayTestCase : public TestCase
+{
+public:
+  CapillaryRelayTestCase ();
+  virtual ~CapillaryRelayTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+};
+
+CapillaryRelayTestCase::CapillaryRelayTestCase () :
+  TestCase ("Test the aggregation, the flattening and the sink of a cluster tree")
+{
+}
+
+CapillaryRelayTestCase::~CapillaryRelayTestCase ()
+{
+}
+
+void CapillaryRelayTestCase::DoRun (void)
+{
+  // three tiers, each one on its own channel: two records of 20 bytes
+  // fit in the upper MTU, three do not
+  uint16_t upperMtu = 2 * (20 + CapillaryAggregateHeader ().GetSerializedSize ()) + 4;
+
+  CapillaryTestCell lower;
+  lower.SetMacAttribute ("slots", UintegerValue (3));
+  lower.Install (3);
+
+  CapillaryTestCell middle;
+  middle.SetMacAttribute ("Mtu", UintegerValue (upperMtu));
+  middle.Install (1);
+
+  CapillaryTestCell upper;
+  upper.SetMacAttribute ("Mtu", UintegerValue (upperMtu));
+  upper.Install (1);
+
+  Ptr<CapillaryRelay> relay = CreateObject<CapillaryRelay> ();
+  relay->Install (DynamicCast<CapillaryNetDevice> (lower.GetDevices ().Get (0)), DynamicCast<CapillaryNetDevice> (middle.GetDevices ().Get (1)));
+  Ptr<CapillaryRelay> intermediate = CreateObject<CapillaryRelay> ();
+  intermediate->Install (DynamicCast<CapillaryNetDevice> (middle.GetDevices ().Get (0)), DynamicCast<CapillaryNetDevice> (upper.GetDevices ().Get (1)));
+  Ptr<CapillaryRelay> sink = CreateObject<CapillaryRelay> ();
+  sink->Install (DynamicCast<CapillaryNetDevice> (upper.GetDevices ().Get (0)), 0);
+
+  std::vector<std::pair<uint32_t, uint32_t> > relayFrames;
+  std::vector<std::pair<uint32_t, uint32_t> > intermediateFrames;
+  relay->TraceConnectWithoutContext ("Aggregate", MakeBoundCallback (&AggregateSink, &relayFrames));
+  intermediate->TraceConnectWithoutContext ("Aggregate", MakeBoundCallback (&AggregateSink, &intermediateFrames));
+  std::vector<Mac64Address> sources;
+  std::vector<std::pair<Time, Time> > delays;
+  sink->TraceConnectWithoutContext ("Rx", MakeBoundCallback (&RelayRxSink, &sources, &delays));
+
+  // the three packets in the same DCR of the lower cell
+  Time sentAt = MilliSeconds (100);
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      lower.PinSlot (i, i);
+      lower.SendAt (i, sentAt);
+    }
+
+  Simulator::Stop (Seconds (8));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (relayFrames.size (), 2, "Wrong number of aggregated frames");
+  NS_TEST_ASSERT_MSG_EQ (relayFrames[0].second, 2, "Records not aggregated");
+  NS_TEST_ASSERT_MSG_EQ (relayFrames[1].second, 1, "Wrong number of records in the last frame");
+
+  uint32_t records = 0;
+  for (uint32_t i = 0; i < intermediateFrames.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_LT (intermediateFrames[i].first, upperMtu + 1u, "Aggregated frame larger than the upper MTU");
+      records += intermediateFrames[i].second;
+    }
+  for (uint32_t i = 0; i < relayFrames.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_LT (relayFrames[i].first, upperMtu + 1u, "Aggregated frame larger than the upper MTU");
+    }
+  NS_TEST_ASSERT_MSG_EQ (records, 3, "Frames of the lower relay not flattened");
+
+  NS_TEST_ASSERT_MSG_EQ (sources.size (), 3, "Wrong number of packets at the sink");
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      Mac64Address source = Mac64Address::ConvertFrom (lower.GetDevices ().Get (i + 1)->GetAddress ());
+      NS_TEST_ASSERT_MSG_EQ (std::count (sources.begin (), sources.end (), source), 1, "Source lost across the tiers");
+    }
+  for (uint32_t i = 0; i < delays.size (); i++)
+    {
+      // from the reception by the lower coordinator, in the first DCR after the send
+      Time receivedAt = delays[i].first - delays[i].second;
+      NS_TEST_ASSERT_MSG_GT (delays[i].second, Seconds (0), "Wrong delay");
+      NS_TEST_ASSERT_MSG_GT (receivedAt, sentAt, "Delay from before the transmission");
+      NS_TEST_ASSERT_MSG_LT (receivedAt, sentAt + Seconds (2), "Delay not from the first coordinator");
+    }
+
+  Simulator::Destroy ();
+}
+
+// ==============================================================================
+class CapillaryMetricsExporterTestCase : public TestCase
+{
+public:
+  CapillaryMetricsExporterTestCase ();
+  virtual ~CapillaryMetricsExporterTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+};
+
+CapillaryMetricsExporterTestCase::CapillaryMetricsExporterTestCase () :
+  TestCase ("Test the snapshots of the metrics exporter")
+{
+}
+
+CapillaryMetricsExporterTestCase::~CapillaryMetricsExporterTestCase ()
+{
+}
+
+void CapillaryMetricsExporterTestCase::DoRun (void)
+{
+  std::string jsonName = CreateTempDirFilename ("capillary-metrics.jsonl");
+  std::string promName = CreateTempDirFilename ("capillary-metrics.prom");
+
+  CapillaryTestCell cell;
+  cell.Install (1);
+  cell.SendAt (0, MilliSeconds (100));
+
+  Ptr<CapillaryMetricsExporter> json = CreateObject<CapillaryMetricsExporter> ();
+  json->SetAttribute ("Interval", TimeValue (Seconds (1)));
+  json->AddCell (0, cell.GetDevices ());
+  json->Start (jsonName);
+  Simulator::Schedule (MilliSeconds (2500), &CapillaryMetricsExporter::Stop, json);
+
+  Ptr<CapillaryMetricsExporter> prom = CreateObject<CapillaryMetricsExporter> ();
+  prom->SetAttribute ("Format", EnumValue (CapillaryMetricsExporter::PROMETHEUS));
+  prom->SetAttribute ("Interval", TimeValue (Seconds (1)));
+  prom->AddCell (0, cell.GetDevices ());
+  prom->Start (promName);
+
+  Simulator::Stop (Seconds (4));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  // the snapshots at 1 s and 2 s, none after Stop
+  std::ifstream jsonFile (jsonName.c_str ());
+  std::vector<std::string> lines;
+  std::string line;
+  while (std::getline (jsonFile, line))
+    {
+      lines.push_back (line);
+    }
+  NS_TEST_ASSERT_MSG_EQ (lines.size (), 2, "Wrong number of snapshots");
+  NS_TEST_ASSERT_MSG_EQ (lines.back ().find ("{\"time\":2,\"cell\":0,\"nodes\":2,") , 0, "Wrong snapshot header");
+  NS_TEST_ASSERT_MSG_NE (lines.back ().find (",\"slotsOk\":1,"), std::string::npos, "Delivery not counted");
+
+  std::ifstream promFile (promName.c_str ());
+  std::stringstream prometheus;
+  prometheus << promFile.rdbuf ();
+  NS_TEST_ASSERT_MSG_NE (prometheus.str ().find ("capillary_sim_time_seconds 3\n"), std::string::npos, "Wrong last exposition");
+  NS_TEST_ASSERT_MSG_NE (prometheus.str ().find ("capillary_slots_ok_total{cell=\"0\"} 1\n"), std::string::npos, "Delivery not counted");
+}
+
+// ==============================================================================
+class CapillarySimulationTelemetryTestCase : public TestCase
+{
+public:
+  CapillarySimulationTelemetryTestCase ();
+  virtual ~CapillarySimulationTelemetryTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+};
+
+CapillarySimulationTelemetryTestCase::CapillarySimulationTelemetryTestCase () :
+  TestCase ("Test the telemetry of the profiling simulator")
+{
+}
+
+CapillarySimulationTelemetryTestCase::~CapillarySimulationTelemetryTestCase ()
+{
+}
+
+void CapillarySimulationTelemetryTestCase::DoRun (void)
+{
+  CapillarySimulationTelemetry::EnableProfiling ();
+
+  CapillaryTestCell cell;
+  cell.Install (1);
+  cell.SendAt (0, MilliSeconds (100));
+
+  std::ostringstream oss;
+  Ptr<CapillarySimulationTelemetry> telemetry = CreateObject<CapillarySimulationTelemetry> ();
+  telemetry->SetAttribute ("Interval", TimeValue (Seconds (1)));
+  telemetry->Start (Create<OutputStreamWrapper> (&oss));
+  Simulator::Schedule (MilliSeconds (2500), &CapillarySimulationTelemetry::Stop, telemetry);
+
+  Simulator::Stop (Seconds (4));
+  Simulator::Run ();
+
+  Ptr<CapillaryProfilingSimulatorImpl> profiler = DynamicCast<CapillaryProfilingSimulatorImpl> (Simulator::GetImplementation ());
+  NS_TEST_ASSERT_MSG_EQ ((profiler != 0), true, "Profiling simulator not selected");
+
+  uint64_t executed = 0;
+  uint64_t pending = 0;
+  for (uint32_t h = 0; h < CapillaryProfilingSimulatorImpl::N_HANDLERS; h++)
+    {
+      executed += profiler->GetExecutedEvents ((CapillaryProfilingSimulatorImpl::Handler) h);
+      pending += profiler->GetPendingEvents ((CapillaryProfilingSimulatorImpl::Handler) h);
+    }
+  NS_TEST_ASSERT_MSG_EQ (executed, profiler->GetExecutedEvents (), "Executed events lost by the handler classes");
+  NS_TEST_ASSERT_MSG_EQ (pending, profiler->GetPendingEvents (), "Pending events lost by the handler classes");
+  NS_TEST_ASSERT_MSG_GT (profiler->GetExecutedEvents (CapillaryProfilingSimulatorImpl::FSALOHA_MAC), 0, "No MAC event counted");
+
+  Simulator::Destroy ();
+  GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::DefaultSimulatorImpl"));
+
+  // the header and the reports at 1 s and 2 s, none after Stop
+  std::istringstream iss (oss.str ());
+  std::vector<std::string> lines;
+  std::string line;
+  while (std::getline (iss, line))
+    {
+      lines.push_back (line);
+    }
+  NS_TEST_ASSERT_MSG_EQ (lines.size (), 3, "Wrong number of reports");
+
+  std::istringstream report (lines.back ());
+  double wall, now, simRate, rss;
+  uint64_t events;
+  report >> wall >> now >> simRate >> rss >> events;
+  NS_TEST_ASSERT_MSG_EQ (report.fail (), false, "Event columns missing");
+  NS_TEST_ASSERT_MSG_EQ_TOL (now, 2, 1e-9, "Wrong report time");
+  NS_TEST_ASSERT_MSG_GT (events, 0, "No event reported");
+}
+
 // ==============================================================================
 class CapillaryFsalohaTestSuite : public TestSuite
 {
@@ -211,6 +2283,30 @@ CapillaryFsalohaTestSuite::CapillaryFsalohaTestSuite () :
   TestSuite ("capillary-fsaloha-test", UNIT)
 {
   AddTestCase (new CapillaryFsalohaTestCase, TestCase::QUICK);
+  AddTestCase (new CapillaryBinaryTraceTestCase, TestCase::QUICK);
+  AddTestCase (new CapillaryAsyncTraceTestCase, TestCase::QUICK);
+  AddTestCase (new CapillaryCompressedStreamTestCase, TestCase::QUICK);
+  AddTestCase (new CapillaryStatsTestCase, TestCase::QUICK);
+  AddTestCase (new CapillaryTraceContextTestCase, TestCase::QUICK);
+  AddTestCase (new CapillaryEnergyDownsamplerTestCase, TestCase::QUICK);
+  AddTestCase (new CapillaryFsalohaHeaderTestCase, TestCase::QUICK);
+  AddTestCase (new CapillaryMemoryBudgetTestCase, TestCase::QUICK);
+  AddTestCase (new CapillaryGridSpectrumChannelTestCase, TestCase::QUICK);
+  AddTestCase (new CapillarySicBufferTestCase, TestCase::QUICK);
+  AddTestCase (new CapillaryMultiChannelTestCase, TestCase::QUICK);
+  AddTestCase (new CapillaryReservationTestCase, TestCase::QUICK);
+  AddTestCase (new CapillaryImmediateAckTestCase, TestCase::QUICK);
+  AddTestCase (new CapillaryAlarmSlotsTestCase, TestCase::QUICK);
+  AddTestCase (new CapillaryAlarmPreemptionTestCase, TestCase::QUICK);
+  AddTestCase (new CapillaryBackoffTestCase, TestCase::QUICK);
+  AddTestCase (new CapillaryInterferenceCancellationTestCase, TestCase::QUICK);
+  AddTestCase (new CapillaryEndOfDcrTestCase, TestCase::QUICK);
+  AddTestCase (new CapillarySplittingTestCase, TestCase::QUICK);
+  AddTestCase (new CapillaryDownlinkTestCase, TestCase::QUICK);
+  AddTestCase (new CapillaryHandoverTestCase, TestCase::QUICK);
+  AddTestCase (new CapillaryRelayTestCase, TestCase::QUICK);
+  AddTestCase (new CapillaryMetricsExporterTestCase, TestCase::QUICK);
+  AddTestCase (new CapillarySimulationTelemetryTestCase, TestCase::QUICK);
 }
 
 static CapillaryFsalohaTestSuite CapillaryFsalohaTestSuite;